@@ -34,6 +34,20 @@ using std::endl;
 using std::string;
 using std::vector;
 using std::map;
+/*
+ * Slots in the argument matrix: lowercase short options come first,
+ * followed by the uppercase ones
+ */
+#define ARG_SLOTS 52
+
+/*
+ *  @brief Returns the slot of a short option in the argument matrix
+ *  @param c Short option ('a'-'z' or 'A'-'Z')
+ */
+static inline int arg_slot(char c) {
+  return (c >= 'a' && c <= 'z') ? c - 'a' : 26 + c - 'A';
+}
+
 /*
  *  @brief Parses arguments and returns (by reference) a matrix of their values.
  *  @param argc Number of arguments
@@ -0,0 +1,109 @@
+/******************************************************************************
+ * (C) Copyright 2017 AMIQ Consulting
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *******************************************************************************/
+
+#ifndef INCLUDES_ASSERT_CENSUS_HPP_
+#define INCLUDES_ASSERT_CENSUS_HPP_
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include "ucis.h"
+
+using std::string;
+using std::vector;
+using std::unordered_map;
+
+/*
+ * Counts of an assertion, summed over all UCISDBs
+ */
+typedef struct {
+  string name;        // hierarchical name
+  int64_t fails;
+  int64_t passes;
+  int64_t vacuous;
+  int64_t disabled;
+  int64_t attempts;
+} assert_stats_t;
+
+/*
+ * @brief Key of the assertion counter held by a cover item type, 0 for other types.
+ * @brief Counters are checked under <assertion>/a/<key>/ (see cl_check -t assert).
+ */
+char assert_counter_key(ucisCoverTypeT type);
+
+/*
+ * @brief Key of an assertion counter given by name (fails, passes, vacuous,
+ * @brief disabled, attempts), 0 if there is none
+ */
+char assert_counter_key(const string &name);
+
+/*
+ * @brief Name of an assertion counter given by key, NULL if there is none
+ */
+const char *assert_counter_name(char key);
+
+/*
+ * @brief Status of an assertion: "failed", "never" (attempted), "vacuous" (only
+ * @brief vacuous passes) or "passed"
+ */
+const char *assert_status(const assert_stats_t &a);
+
+/*
+ * @brief Per assertion table of counts, filled in one traversal of each UCISDB
+ */
+class assert_census {
+
+  vector<assert_stats_t> rows;
+  unordered_map<string, uint32_t> ids;
+
+  // The items of an assertion come together: skip the lookup while it stays the same
+  uint32_t last;
+
+public:
+
+  assert_census() :
+      last(UINT32_MAX) {
+  }
+
+  /*
+   * @brief Adds the count of a cover item to its assertion
+   * @param name Hierarchical name of the assertion
+   * @param type Cover item type, one of the assertion bins
+   * @param count Count of the item
+   */
+  void add(const string &name, ucisCoverTypeT type, int64_t count);
+
+  const vector<assert_stats_t> &list() const {
+    return rows;
+  }
+};
+
+/*
+ * @brief Collects the counts of every assertion over all UCISDBs and lists
+ * @brief the ones that have one of the statuses and one of the name substrings
+ * @brief given as filters (any, if none of a kind is given).
+ * @param dbs Paths to the UCISDBs
+ * @param filters Statuses (see assert_status) and name substrings
+ * @param file Where the assertions are listed
+ * @return 0 on success
+ */
+int census_main(const vector<string> &dbs, const vector<string> &filters, const string &file);
+
+#endif  // INCLUDES_ASSERT_CENSUS_HPP_
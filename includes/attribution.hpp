@@ -0,0 +1,123 @@
+/******************************************************************************
+ * (C) Copyright 2017 AMIQ Consulting
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *******************************************************************************/
+
+#ifndef INCLUDES_ATTRIBUTION_HPP_
+#define INCLUDES_ATTRIBUTION_HPP_
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include "ucis.h"
+
+using std::string;
+using std::vector;
+using std::unordered_map;
+
+/*
+ * Tests named in the tooltip of a check, the others are only counted
+ */
+#define ATTRIBUTION_MAX_LISTED 8
+
+/*
+ * @brief Tells which tests hit each bin, while the UCISDBs are searched.
+ * @brief Tests are numbered by name over all UCISDBs, so that checks keep
+ * @brief sorted lists of numbers. A bin with test data (UCIS_ASSOC_TESTHIT,
+ * @brief e.g. from a test associated merge) is hit by the tests it lists.
+ * @brief Other bins are hit by the tests of their UCISDB or, if it has no
+ * @brief test records, by the UCISDB itself: with one UCISDB per test, each
+ * @brief check gets the tests that hit it.
+ */
+class test_attribution {
+
+  vector<string> names;
+  unordered_map<string, uint32_t> ids;
+
+  // Of the UCISDB being searched
+  string db_file;
+  unordered_map<ucisHistoryNodeT, uint32_t> nodes;
+  vector<uint32_t> db_tests;
+
+  vector<uint32_t> bin;
+
+  // Bin being checked: its tests are only read once it hits a check
+  ucisT hit_db;
+  ucisScopeT hit_scope;
+  int hit_coverindex;
+  const vector<uint32_t> *hit_tests;
+
+  uint32_t id(const string &name);
+  uint32_t node_id(ucisT db, ucisHistoryNodeT node);
+
+public:
+
+  test_attribution() :
+      hit_db(NULL), hit_scope(NULL), hit_coverindex(0), hit_tests(NULL) {
+  }
+
+  /*
+   * @brief Starts a UCISDB, before it is traversed
+   */
+  void start_db(const string &file) {
+    db_file = file;
+    nodes.clear();
+    db_tests.clear();
+    set_bin(NULL, NULL, 0);
+  }
+
+  /*
+   * @brief Sets the bin being checked, a NULL db if its hits are not attributed
+   */
+  void set_bin(ucisT db, ucisScopeT scope, int coverindex) {
+    hit_db = db;
+    hit_scope = scope;
+    hit_coverindex = coverindex;
+    hit_tests = NULL;
+  }
+
+  /*
+   * @brief Tests that hit the bin being checked, read on the first call.
+   * @brief NULL if no bin is set.
+   */
+  const vector<uint32_t> *current_tests() {
+    if (hit_db && !hit_tests)
+      hit_tests = &bin_tests(hit_db, hit_scope, hit_coverindex);
+
+    return hit_tests;
+  }
+
+  /*
+   * @brief Tests that hit a bin, as sorted numbers
+   */
+  const vector<uint32_t> &bin_tests(ucisT db, ucisScopeT scope, int coverindex);
+
+  /*
+   * @brief Names of the tests, by number
+   */
+  const vector<string> &test_names() const {
+    return names;
+  }
+};
+
+/*
+ * @brief Adds tests to the sorted list of a check
+ */
+void merge_tests(vector<uint32_t> &tests, const vector<uint32_t> &add);
+
+#endif  // INCLUDES_ATTRIBUTION_HPP_
@@ -0,0 +1,102 @@
+/******************************************************************************
+ * (C) Copyright 2017 AMIQ Consulting
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *******************************************************************************/
+
+#ifndef INCLUDES_BATCH_CHECKER_HPP_
+#define INCLUDES_BATCH_CHECKER_HPP_
+
+#include <string>
+#include <vector>
+#include <unordered_set>
+
+#include "cl_checker.h"
+#include "node_info.hpp"
+#include "rules.hpp"
+
+using std::string;
+using std::vector;
+using std::unordered_set;
+
+/*
+ * Number of items handed to a batch checker in one call
+ */
+#define CL_CHECK_CHUNK 4096
+
+/*
+ * @brief Evaluates the checks, in batches.
+ * @brief Either a batch function (built in or loaded from a plugin) writes
+ * @brief one status code per item, or a legacy checker (see register_check)
+ * @brief is called for each item. Rules, if any, are tried first.
+ * @brief Results are pointers to class names owned by this object, with
+ * @brief negation already applied.
+ */
+class batch_checker {
+
+  checker f;
+  cl_check_batch_t batch;
+  void *lib;
+
+  // Status code => class name
+  vector<string> names;
+
+  // Class names returned by a legacy checker
+  unordered_set<string> legacy_names;
+
+  // Rules are tried first; their classes are also in names
+  const rule_set *rules;
+  vector<uint8_t> rule_codes;
+
+  // Reused between calls
+  vector<cl_leaf_t> views;
+  vector<uint8_t> codes;
+
+  void map_rules();
+
+  void run_batch(const node_info_t * const *infos, size_t n, const string **out);
+  void run_legacy(const node_info_t * const *infos, size_t n, const string **out);
+
+public:
+
+  /*
+   * @param f Legacy checker, NULL for the built in one
+   */
+  explicit batch_checker(checker f = NULL);
+
+  ~batch_checker();
+
+  /*
+   * @brief Uses the checker exported by a plugin instead
+   * @param path Shared library (see cl_checker.h)
+   * @return 0 on success
+   */
+  int load(const string &path);
+
+  /*
+   * @brief Rules tried, in order, before the checker
+   * @param r The rules, must outlive this object
+   */
+  void set_rules(const rule_set *r);
+
+  /*
+   * @brief Evaluates n checks
+   * @param infos The checked items
+   * @param out Receives the class name of each item
+   */
+  void run(const node_info_t * const *infos, size_t n, const string **out);
+
+};
+
+#endif  // INCLUDES_BATCH_CHECKER_HPP_
@@ -0,0 +1,116 @@
+/******************************************************************************
+ * (C) Copyright 2017 AMIQ Consulting
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *******************************************************************************/
+
+#ifndef INCLUDES_BITMAP_HPP_
+#define INCLUDES_BITMAP_HPP_
+
+#include <stdint.h>
+
+#include <vector>
+
+using std::vector;
+
+/*
+ * Containers with up to this many values are kept as sorted arrays
+ */
+#define BITMAP_ARRAY_MAX 4096
+
+/*
+ * Words of a bitset container (2^16 bits)
+ */
+#define BITMAP_WORDS 1024
+
+/*
+ * @brief Compressed bitmap of 32 bit values, roaring style.
+ * @brief Values are split by their upper 16 bits in containers. A container
+ * @brief holds its lower 16 bits as a sorted array while it is sparse and as
+ * @brief a 65536 bit bitset once it has more than BITMAP_ARRAY_MAX values.
+ * @brief Unions and intersections work container by container.
+ */
+class roaring_bitmap {
+
+  typedef struct {
+    uint16_t key;
+    uint32_t card;
+    vector<uint16_t> array;   // sorted, while card <= BITMAP_ARRAY_MAX
+    vector<uint64_t> bits;    // BITMAP_WORDS words, otherwise
+  } container_t;
+
+  vector<container_t> containers;   // sorted by key
+
+  container_t &get(uint16_t key);
+  const container_t *find(uint16_t key) const;
+
+  static void to_bits(container_t &c);
+  static void to_array(container_t &c);
+  static void unite(container_t &a, const container_t &b);
+  static void intersect(container_t &a, const container_t &b);
+
+public:
+
+  void add(uint32_t x);
+
+  bool contains(uint32_t x) const;
+
+  uint64_t cardinality() const;
+
+  void clear() {
+    containers.clear();
+  }
+
+  roaring_bitmap &operator|=(const roaring_bitmap &b);
+
+  roaring_bitmap &operator&=(const roaring_bitmap &b);
+
+  /*
+   * @brief Number of values whose bit is not set in a plain bitset (value x is
+   * @brief bit x & 63 of words[x >> 6]). words must cover all the containers.
+   */
+  uint64_t count_not_in(const vector<uint64_t> &words) const;
+
+  /*
+   * @brief Sets the bits of the values in a plain bitset, see count_not_in
+   */
+  void set_in(vector<uint64_t> &words) const;
+
+  /*
+   * @brief Calls f for each value, in increasing order
+   */
+  template<typename F>
+  void for_each(F f) const {
+    for (auto &c : containers) {
+      uint32_t high = (uint32_t) c.key << 16;
+
+      if (c.bits.empty()) {
+        for (uint16_t low : c.array)
+          f(high | low);
+        continue;
+      }
+
+      for (uint32_t w = 0; w < BITMAP_WORDS; ++w)
+        for (uint64_t word = c.bits[w]; word; word &= word - 1)
+          f(high | (w << 6) | __builtin_ctzll(word));
+    }
+  }
+
+  /*
+   * @brief Memory used by the containers, in bytes
+   */
+  size_t bytes() const;
+};
+
+#endif  // INCLUDES_BITMAP_HPP_
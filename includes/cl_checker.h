@@ -0,0 +1,84 @@
+/******************************************************************************
+ * (C) Copyright 2017 AMIQ Consulting
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *******************************************************************************/
+
+/*
+ * Interface of checker plugins, loaded with --checker <lib.so>.
+ * Plain C, so that plugins can be built with any compiler, without CL sources:
+ *
+ *   #include "cl_checker.h"
+ *
+ *   void cl_check_batch(const cl_leaf_t *leaves, size_t n, uint8_t *status) {
+ *     for (size_t i = 0; i < n; ++i)
+ *       status[i] = leaves[i].found ? CL_STATUS_DEFAULT : CL_STATUS_MISSING;
+ *   }
+ *
+ *   gcc -shared -fPIC -I<cl>/includes -o my_checker.so my_checker.c
+ */
+
+#ifndef INCLUDES_CL_CHECKER_H_
+#define INCLUDES_CL_CHECKER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Status codes. A plugin can name the codes from CL_STATUS_CUSTOM up by
+ * exporting cl_status_names; each name is the class of the row in reports.
+ */
+#define CL_STATUS_DEFAULT 0
+#define CL_STATUS_FAIL    1
+#define CL_STATUS_MISSING 2
+#define CL_STATUS_CUSTOM  3
+
+/*
+ * Read only view of a checked item. The strings belong to CL and are valid
+ * only during the call.
+ */
+typedef struct {
+  const char *type;
+  const char *name;
+  const char *location;
+  const char *comment;
+  uint32_t line;
+  int64_t hit_count;
+  uint8_t found;      // found in the UCISDB
+  uint8_t negated;    // for information only: CL switches fail/default itself
+} cl_leaf_t;
+
+/*
+ * Required: writes the status of leaves[i] in status[i], for i < n
+ */
+typedef void (*cl_check_batch_t)(const cl_leaf_t *leaves, size_t n, uint8_t *status);
+
+/*
+ * Optional: names of the codes CL_STATUS_CUSTOM, CL_STATUS_CUSTOM + 1, ...
+ * @param n Set to the number of names
+ */
+typedef const char *const *(*cl_status_names_t)(size_t *n);
+
+#define CL_CHECK_BATCH_SYMBOL "cl_check_batch"
+#define CL_STATUS_NAMES_SYMBOL "cl_status_names"
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // INCLUDES_CL_CHECKER_H_
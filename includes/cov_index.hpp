@@ -0,0 +1,212 @@
+/******************************************************************************
+ * (C) Copyright 2017 AMIQ Consulting
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *******************************************************************************/
+
+#ifndef INCLUDES_COV_INDEX_HPP_
+#define INCLUDES_COV_INDEX_HPP_
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+using std::string;
+using std::vector;
+using std::unordered_map;
+
+/*
+ * Bins of a coverpoint or covergroup, and how many of them were hit
+ * (at least option.at_least times)
+ */
+typedef struct {
+  uint32_t bins;
+  uint32_t hit_bins;
+} cov_stats_t;
+
+/*
+ * The options of a covergroup, coverpoint or cross that weigh in its score
+ */
+typedef struct {
+  int32_t weight;
+  int32_t goal;       // percent
+  int32_t at_least;   // hits for a bin to be covered
+} cov_options_t;
+
+/*
+ * What the scan knows about the scopes above a bin
+ */
+typedef struct {
+  vector<string> crossed;   // coverpoints of the cross, empty otherwise
+  cov_options_t group;
+  cov_options_t point;
+} cov_scope_t;
+
+typedef struct {
+  string name;
+  int64_t hits;
+  bool covered;             // hit at least at_least times, or its goal
+} cov_bin_t;
+
+typedef struct {
+  string name;              // <covergroup>/<coverpoint>
+  uint32_t group;
+  vector<string> crossed;   // coverpoints of a cross, empty otherwise
+  vector<uint32_t> bins;
+  cov_stats_t stats;
+  cov_options_t options;
+} cov_point_t;
+
+typedef struct {
+  string name;
+  vector<uint32_t> points;
+  cov_stats_t stats;
+  cov_options_t options;
+} cov_group_t;
+
+/*
+ * @brief Options of a scope that has none set in the UCISDB
+ */
+static inline cov_options_t cov_default_options() {
+  cov_options_t o = { 1, 100, 1 };
+
+  return o;
+}
+
+/*
+ * @brief Percent of hit bins
+ */
+static inline double cov_percent(const cov_stats_t &s) {
+  return s.bins ? 100.0 * s.hit_bins / s.bins : 0;
+}
+
+/*
+ * @brief Covergroups, coverpoints and bins of a UCISDB, built in one traversal.
+ * @brief Nodes are numbered in the order they are first seen and can be looked
+ * @brief up by that number (from 1, as -g takes them) or by hierarchical name.
+ * @brief Stats are kept up to date as bins are added.
+ */
+class cov_index {
+
+  vector<cov_group_t> groups;
+  vector<cov_point_t> points;
+  vector<cov_bin_t> bins;
+
+  unordered_map<string, uint32_t> group_ids;
+  unordered_map<string, uint32_t> point_ids;
+  unordered_map<string, uint32_t> bin_ids;    // <coverpoint>/<bin>
+
+  // Bins come grouped by coverpoint: skip the lookups while it stays the same
+  uint32_t last_point;
+
+  void map_names();
+
+public:
+
+  cov_index() :
+      last_point(UINT32_MAX) {
+  }
+
+  void clear();
+
+  /*
+   * @brief Adds a bin, and its coverpoint and covergroup if they are new
+   * @param group Hierarchical name of the covergroup
+   * @param point Name of the coverpoint in the covergroup
+   * @param bin Name of the bin
+   * @param hits Hit count of the bin
+   * @param covered True if the bin was hit at least at_least times
+   * @param scope Crossed coverpoints and options, used if the coverpoint is new
+   */
+  void add_bin(const string &group, const string &point, const string &bin, int64_t hits,
+      bool covered, const cov_scope_t &scope);
+
+  /*
+   * @brief Finds a node by number (from 1) or by name
+   * @return Position in groups()/points(), -1 if there is none
+   */
+  int64_t find_group(const string &key) const;
+  int64_t find_point(const string &key) const;
+
+  /*
+   * @brief Finds a bin of a coverpoint by number (from 1) or by name
+   * @return Position in bin_list(), -1 if there is none
+   */
+  int64_t find_bin(uint32_t point, const string &key) const;
+
+  const vector<cov_group_t> &group_list() const {
+    return groups;
+  }
+
+  const vector<cov_point_t> &point_list() const {
+    return points;
+  }
+
+  const vector<cov_bin_t> &bin_list() const {
+    return bins;
+  }
+
+  /*
+   * @brief Score of a coverpoint or cross: percent of covered bins
+   */
+  double point_score(uint32_t point) const {
+    return cov_percent(points[point].stats);
+  }
+
+  /*
+   * @brief Score of a covergroup: average of the scores of its coverpoints and
+   * @brief crosses, weighted by their option.weight
+   */
+  double group_score(uint32_t group) const;
+
+  /*
+   * @brief Score of the UCISDB: average of the covergroup scores, weighted by their
+   * @brief option.weight
+   */
+  double total_score() const;
+
+  /*
+   * @brief Stores the index, stamped with the UCISDB it was built from
+   */
+  bool store(const string &file, uint64_t mtime, uint64_t size) const;
+
+  /*
+   * @brief Loads an index stored for the UCISDB in its current state
+   * @return true on success
+   */
+  bool load(const string &file, uint64_t mtime, uint64_t size);
+};
+
+/*
+ * @brief Builds the index of a UCISDB, or loads it from cache_dir
+ * @param db_file Path to the UCISDB
+ * @param cache_dir Where indexes are kept, none if empty
+ * @param index Filled with the index
+ */
+void cov_build(const string &db_file, const string &cache_dir, cov_index &index);
+
+/*
+ * @brief Answers a -g query for each UCISDB.
+ * @brief The index of each UCISDB is built by a single traversal, or loaded
+ * @brief from cache_dir when the UCISDB did not change since it was stored.
+ * @param dbs Paths to the UCISDBs
+ * @param args Query and its arguments
+ * @param cache_dir Where indexes are kept, none if empty
+ * @return 0 on success
+ */
+int cov_main(const vector<string> &dbs, const vector<string> &args, const string &cache_dir);
+
+#endif  // INCLUDES_COV_INDEX_HPP_
@@ -0,0 +1,47 @@
+/******************************************************************************
+ * (C) Copyright 2017 AMIQ Consulting
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *******************************************************************************/
+
+#ifndef INCLUDES_CROSS_HOLES_HPP_
+#define INCLUDES_CROSS_HOLES_HPP_
+
+#include <string>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+/*
+ * Values listed per crossed coverpoint on stdout (the file gets all of them)
+ */
+#define CROSS_TOP_VALUES 10
+
+/*
+ * @brief Reports the bins of the crosses that no UCISDB hit.
+ * @brief For each UCISDB and cross, the hit bins are collected in a compressed
+ * @brief bitmap. The bitmaps of all UCISDBs are then joined (hit anywhere) and
+ * @brief intersected (hit everywhere). Holes are grouped by the value they
+ * @brief have for each crossed coverpoint.
+ * @param dbs Paths to the UCISDBs
+ * @param crosses Names (<covergroup>/<cross>) of the crosses to analyze, all if empty
+ * @param cache_dir Where coverage indexes are kept, none if empty
+ * @param file Where every hole is listed
+ * @return 0 on success
+ */
+int cross_main(const vector<string> &dbs, const vector<string> &crosses, const string &cache_dir,
+    const string &file);
+
+#endif  // INCLUDES_CROSS_HOLES_HPP_
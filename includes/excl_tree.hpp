@@ -24,9 +24,11 @@
 #include <iostream>
 #include <fstream>
 #include <vector>
+#include <utility>
 
 #include "formatter.hpp"
 #include "node_info.hpp"
+#include "summary.hpp"
 
 using std::string;
 using std::to_string;
@@ -34,6 +36,8 @@ using std::vector;
 using std::unordered_map;
 using std::map;
 using std::ofstream;
+using std::pair;
+using std::make_pair;
 
 /*
  * @brief The excl_tree class represents a variation of a prefix tree.
@@ -52,6 +56,19 @@ class excl_tree {
    */
   map<string, excl_tree*> children;
 
+  /*
+   * Bounds of the array bin indexes matched by this node, for paths like "3-97".
+   * range_first > range_last for all other nodes.
+   */
+  int64_t range_first;
+  int64_t range_last;
+
+  /*
+   * Children that are ranges, the only ones an array bin index can reach
+   * without an exact match
+   */
+  vector<excl_tree*> ranges;
+
   /*
    * Used to count the total number of exclusions
    */
@@ -77,6 +94,24 @@ class excl_tree {
    */
   void print_hit_map(const string &s, ofstream & out);
 
+  /*
+   * @brief Collects the checks under this node
+   * @param s current assembled path
+   * @param out pairs of path, node
+   */
+  void get_leaves(const string &s, vector<pair<string, excl_tree*> > &out);
+
+  /*
+   * @brief Aggregates the results of the checks under this node, bottom-up
+   * @param results results of the checks, in get_checks order
+   * @param next index of the next result to use
+   * @param depth number of path components down to this node
+   * @param s summary of this node, filled here
+   * @return location of one of the checks under this node, NULL if none
+   */
+  const string *summarize(const string * const *results, size_t &next, int depth,
+      summary_node_t &s) const;
+
 public:
 
   /*
@@ -106,6 +141,7 @@ public:
 
   excl_tree(string path) :
     path(path) {
+    parse_range(path, range_first, range_last);
     excluded = 0;
     times_hit = 0;
     found = false;
@@ -134,8 +170,9 @@ public:
    * @brief Adds a new node in the tree
    * @param s_to_add the string left to analyze
    * @param expanded mark subsequent nodes with this
+   * @return the node of the check
    */
-  void add(string s_to_add, const node_info_t& inf, bool expanded = false);
+  excl_tree* add(string s_to_add, const node_info_t& inf, bool expanded = false);
 
   /*
    *  @brief Searches for a node that matches the s_to_find path
@@ -144,6 +181,43 @@ public:
    */
   excl_tree* find(const string &s_to_find);
 
+  /*
+   * @brief Tells if find() can go past this node with the given path component
+   * @param name the path component
+   */
+  bool has_child(const string &name) const;
+
+  /*
+   * @brief Tells if an item of the given location can reach a check: there is a
+   * @brief check under the location, or a recursive check on the way to it
+   * @param location path of the location, without a trailing separator
+   */
+  bool reaches(const string &location) const;
+
+  /*
+   * @brief Counts the hits of an array bin on a range check
+   * @param query the query of the bin, ending in <index>/v/
+   * @param cov_val hit count of the bin
+   */
+  void count_bin(const string &query, int64_t cov_val);
+
+  /*
+   * @brief Sets the result of a check that depends on all its hits:
+   * @brief  -> a range check is hit only if all its bins are, the uncovered ones are
+   * @brief     listed as ranges in the name
+   * @brief  -> a check with a threshold is hit only if it reaches it
+   */
+  void close();
+
+  /*
+   * @brief Parses an array bin range
+   * @param s the range, as "first-last"
+   * @param first receives the first index
+   * @param last receives the last index
+   * @return true if s is a valid range
+   */
+  static bool parse_range(const string &s, int64_t &first, int64_t &last);
+
   /*
    *  @brief Public printing function
    *  @param out stream to which we print
@@ -158,11 +232,24 @@ public:
   void print_hit_map(ofstream& out);
 
   /*
-   * @brief Generic iterator over tests. Applies f to each leaf.
-   * @param f function that takes a node_info_t and returns a string
-   * @param out stream to print results
+   * @brief Collects the checks of the tree, children before their parent
+   * @param out the checked items
+   */
+  void get_checks(vector<const node_info_t*> &out) const;
+
+  /*
+   * @brief Aggregates the results of the checks under this node, bottom-up.
+   * @brief Nothing is formatted per check.
+   * @param results results of the checks, in get_checks order
+   * @param s summary of this node, filled here
+   */
+  void summarize(const string * const *results, summary_node_t &s) const;
+
+  /*
+   * @brief Collects the checks in the tree, with their paths (as given to add)
+   * @param out pairs of path, node
    */
-  void iterate(checker f, reporter& r) const;
+  void get_leaves(vector<pair<string, excl_tree*> > &out);
 
 };
 
@@ -18,11 +18,15 @@
 #ifndef INCLUDES_EXCLUDER_HPP_
 #define INCLUDES_EXCLUDER_HPP_
 
+#include <stdint.h>
+
 #include <string>
 #include <iostream>
+#include <vector>
 
 //using namespace std;
 using std::string;
+using std::vector;
 
 enum operations {
   smaller = 0, equals = 1, contains = 2, bigger = ~smaller, different = ~equals
@@ -43,7 +47,7 @@ class excluder {
    * @param val: value to check
    * @param ref: value stored as reference
    */
-  bool do_op(string val, string ref) {
+  bool do_op(const string &val, const string &ref) const {
     switch (op) {
     case smaller:  // int represented as string is smaller
       return val.size() <= ref.size() && (val.compare(ref) < 0);
@@ -59,7 +63,7 @@ class excluder {
   }
 
  public:
-  excluder(string field, string valid, int op, bool negated = false) :
+  excluder(const string &field, const string &valid, int op, bool negated = false) :
       field(field), valid(valid), op(op), negated(negated) {
   }
 
@@ -68,7 +72,7 @@ class excluder {
    * @param val: value that we want to check
    * @return : the result of the operation
    */
-  bool run_check(const string & val) {
+  bool run_check(const string & val) const {
     bool rez = do_op(val, valid);
 
     if (negated)
@@ -78,4 +82,63 @@ class excluder {
   }
 };
 
+/*
+ * Filter that aggregates all the comment filters.
+ * A comment passes if it equals every "equals" reference and contains every
+ * "contains" reference. The references to search for are compiled into a single
+ * Aho-Corasick automaton, so a comment is checked in one pass whatever their number.
+ */
+class comment_filter {
+
+  // References the comment must be equal to
+  vector<string> exact;
+
+  // References the comment must contain
+  vector<string> keywords;
+
+  // Automaton: 256 transitions per state, state 0 is the root
+  vector<int32_t> next;
+
+  // Keywords recognized in each state (including those of its suffixes)
+  vector<vector<uint32_t> > out;
+
+  /*
+   * Used to mark keywords found in the current comment without clearing
+   */
+  mutable vector<uint64_t> seen;
+  mutable uint64_t generation;
+
+ public:
+
+  comment_filter() :
+      generation(0) {
+  }
+
+  /*
+   * Adds a reference
+   * @param valid: the reference
+   * @param op: operations::equals or operations::contains
+   */
+  void add(const string &valid, int op);
+
+  /*
+   * Builds the automaton. Call it after the last add.
+   */
+  void compile();
+
+  /*
+   * @return : true if there are no references
+   */
+  bool empty() const {
+    return exact.empty() && keywords.empty();
+  }
+
+  /*
+   * Checks a comment against all references
+   * @param val: the comment
+   * @return : true if the comment passes
+   */
+  bool run_check(const string &val) const;
+};
+
 #endif  // INCLUDES_EXCLUDER_HPP_
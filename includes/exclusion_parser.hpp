@@ -23,6 +23,7 @@
 #include <vector>
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
 #include <map>
 
 #include "excluder.hpp"
@@ -36,6 +37,7 @@ using std::ifstream;
 using std::ofstream;
 using std::cout;
 using std::unordered_map;
+using std::unordered_set;
 using std::map;
 
 
@@ -43,13 +45,13 @@ using std::map;
  *  @brief Structure that aggregates different exclusion filters
  *  @var folders vPlan sections with code coverage mapped
  *  @var targeted_users Users whose exclusions are selected
- *  @var comment_workers Comment filters from cmd line
+ *  @var comments Comment filters from cmd line, compiled together
  *  @var negate If checks are negated globally
  */
 typedef struct {
   unordered_map<string, char> folders;
-  vector<string> targeted_users;
-  vector<excluder*> comment_workers;
+  unordered_set<string> targeted_users;
+  comment_filter comments;
   bool negate;
 } filters_t;
 
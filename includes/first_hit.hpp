@@ -0,0 +1,44 @@
+/******************************************************************************
+ * (C) Copyright 2017 AMIQ Consulting
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *******************************************************************************/
+
+#ifndef INCLUDES_FIRST_HIT_HPP_
+#define INCLUDES_FIRST_HIT_HPP_
+
+#include <string>
+#include <vector>
+
+#include "top_tree.hpp"
+
+using std::string;
+using std::vector;
+
+/*
+ * @brief Finds, for each check, the first UCISDB of a chronological list that hits it.
+ * @brief UCISDBs are searched in order, each one only for the checks that no earlier
+ * @brief UCISDB hit: the resolved checks are dropped from the trie searched next
+ * @brief (toggle bins are skipped once no toggle check is left). The search stops as
+ * @brief soon as every check was hit.
+ * @param trie Checks, populated by the parsers
+ * @param dbs Paths to the UCISDBs, oldest first
+ * @param refinement_flag How items are indexed (see search_callback)
+ * @param file Where the first hit of each check is listed
+ * @return 0 on success
+ */
+int first_hit_main(top_tree *trie, const vector<string> &dbs, bool refinement_flag,
+    const string &file);
+
+#endif  // INCLUDES_FIRST_HIT_HPP_
@@ -18,11 +18,17 @@
 #ifndef INCLUDES_FORMATTER_HPP_
 #define INCLUDES_FORMATTER_HPP_
 
+#include <stdint.h>
+#include <string.h>
+
 #include <string>
 #include <vector>
 #include <fstream>
 #include <iostream>
+#include <unordered_map>
+#include <utility>
 
+#include "gz_stream.hpp"
 #include "node_info.hpp"
 
 using std::ifstream;
@@ -30,12 +36,124 @@ using std::ofstream;
 using std::string;
 using std::to_string;
 using std::vector;
+using std::unordered_map;
+using std::pair;
 using std::endl;
 
+/*
+ * Size at which a report buffer is written out
+ */
+#define OUT_BUFFER_SIZE (1 << 16)
+
+/*
+ * Rows formatted by one task of a parallel report
+ */
+#define FORMAT_CHUNK 4096
+
+/*
+ * Rows on one page of a paginated HTML report
+ */
+#define HTML_ROWS_PER_PAGE 10000
+
+/*
+ * Reusable output buffer: reports format straight into it and it is written
+ * out in large blocks. Without a stream attached it just keeps the data.
+ */
+class out_buffer {
+
+  string buf;
+  std::ostream *out;
+
+public:
+
+  explicit out_buffer(std::ostream *out = NULL) :
+      out(out) {
+    buf.reserve(OUT_BUFFER_SIZE);
+  }
+
+  ~out_buffer() {
+    flush();
+  }
+
+  void attach(std::ostream *o) {
+    out = o;
+  }
+
+  bool attached() const {
+    return out != NULL;
+  }
+
+  out_buffer &put(const char *s, size_t n) {
+    buf.append(s, n);
+
+    if (out && buf.size() >= OUT_BUFFER_SIZE)
+      flush();
+
+    return *this;
+  }
+
+  out_buffer &put(const string &s) {
+    return put(s.data(), s.size());
+  }
+
+  out_buffer &put(const char *s) {
+    return put(s, strlen(s));
+  }
+
+  out_buffer &put(char c) {
+    return put(&c, 1);
+  }
+
+  out_buffer &put_int(int64_t x);
+
+  /*
+   * Writes s with the HTML special chars escaped
+   */
+  out_buffer &put_html(const string &s);
+
+  /*
+   * Writes s as a JSON string (quotes included)
+   */
+  out_buffer &put_json(const string &s);
+
+  /*
+   * Writes s as a CSV field, quoted only if needed
+   */
+  out_buffer &put_csv(const string &s);
+
+  /*
+   * Writes the content to the stream (if any) and empties the buffer
+   */
+  void flush() {
+    if (!out)
+      return;
+
+    out->write(buf.data(), buf.size());
+    buf.clear();
+  }
+
+  const string &data() const {
+    return buf;
+  }
+
+  void clear() {
+    buf.clear();
+  }
+};
+
+/*
+ * Reporters write to out_file: a file named *.gz is compressed on the fly
+ */
 class reporter {
 
 protected:
-  ofstream report;
+  out_file report;
+
+  // For reporters that don't write a file themselves
+  reporter() {
+    kind = 'd';
+    err_count = 0;
+  };
 
 public:
 
@@ -44,10 +162,7 @@ public:
 
   explicit reporter(string file, bool mode=true) {
 
-    if (mode)
-      report.open(file, std::ofstream::out | std::ofstream::app);
-    else
-      report.open(file, std::ofstream::out);
+    report.open(file, mode);
 
     kind = 'd';
     err_count = 0;
@@ -65,6 +180,32 @@ public:
 
   virtual void format(const node_info_t&, const string &class_name) {};
 
+  /*
+   * @brief Reports n rows. reporter_fanout formats them on worker threads.
+   */
+  virtual void format_batch(const node_info_t * const *infos, const string * const *results,
+      size_t n) {
+    for (size_t i = 0; i < n; ++i)
+      format(*infos[i], *results[i]);
+  };
+
+  /*
+   * Reporters that can format rows away from the main thread.
+   * format_rows writes rows in b, and the end of each of them in ends. It
+   * only reads the reporter: other threads format other rows meanwhile.
+   * append_rows then adds the rows to the report, in order, on the main
+   * thread. Together they must give the same output as format.
+   */
+  virtual bool parallel() const {
+    return false;
+  };
+
+  virtual void format_rows(out_buffer &b, vector<size_t> &ends, const node_info_t * const *infos,
+      const string * const *results, size_t n) const {};
+
+  virtual void append_rows(const out_buffer &b, const vector<size_t> &ends,
+      const node_info_t * const *infos, const string * const *results, size_t n) {};
+
   virtual void format_default(const node_info_t&) {};
   virtual void format_fail(const node_info_t&) {};
   virtual void format_missing(const node_info_t&) {};
@@ -74,16 +215,73 @@ public:
 
 };
 
+/*
+ * Checks of one location, as shown on the index of a paginated report
+ */
+typedef struct {
+  string location;
+  uint items;
+  uint failed;
+  uint missing;
+  uint first_page;
+  uint last_page;
+} scope_summary_t;
+
+/*
+ * HTML report.
+ * With rows_per_page set, rows go to pages of at most that many rows
+ * (<file>_p<N>.html) and <file> gets a summary of each location with links to
+ * its pages. A report that fits on a single page is written as one file.
+ */
 class reporter_html: public virtual reporter {
 
  vector<string> headers;
  string testname;
  string style_file = "./includes/style.css";
+ string style;
+
+ out_buffer out;
+
+ // Pagination
+ uint rows_per_page;
+ uint nof_pages;
+ uint rows_in_page;
+ bool in_table;
+ string tree_name;
+ string index_name;
+ string page_prefix;
+ string page_suffix;
+ out_file page_file;
+ out_buffer page;
+
+ vector<pair<string, vector<scope_summary_t> > > summaries;
+ unordered_map<string, size_t> summary_index;
+
+ // Names of the tests, if hits are attributed
+ const vector<string> *test_names;
+
+ void head(out_buffer &b);
+ void title(out_buffer &b);
+ void table_start(out_buffer &b);
+ void footer(out_buffer &b);
+
+ string page_name(uint n);
+ void open_page(out_buffer &b, uint n);
+ void close_page(bool last);
+ void next_page();
+ void add_summary(const node_info_t&, const string &class_name);
+ void write_index();
 
 public:
 
-  explicit reporter_html(string file, bool mode=false, string test="") :
-      reporter(file, mode), testname(test) {
+  explicit reporter_html(string file, bool mode=false, string test="", uint rows_per_page=0);
+
+  /*
+   * @brief Lists the tests that hit each check in its tooltip
+   * @param names Names of the tests, by number (see test_attribution)
+   */
+  void set_test_names(const vector<string> *names) {
+    test_names = names;
   }
 
   void start();
@@ -101,7 +299,17 @@ public:
   void format_default(const node_info_t&);
   void format_fail(const node_info_t&);
 
-  void add_row(const node_info_t&);
+  void add_row(out_buffer &b, const node_info_t&, const string &class_name) const;
+
+  bool parallel() const {
+    return true;
+  }
+
+  void format_rows(out_buffer &b, vector<size_t> &ends, const node_info_t * const *infos,
+      const string * const *results, size_t n) const;
+
+  void append_rows(const out_buffer &b, const vector<size_t> &ends,
+      const node_info_t * const *infos, const string * const *results, size_t n);
 
 };
 
@@ -132,8 +340,133 @@ public:
   void format_fail(const node_info_t&, const string &class_name);
 
 
-  string get_string_kind();
-  string assemble_info(const node_info_t&, const string &class_name);
+  string get_string_kind() const;
+  string assemble_info(const node_info_t&, const string &class_name) const;
+
+  bool parallel() const {
+    return true;
+  }
+
+  void format_rows(out_buffer &b, vector<size_t> &ends, const node_info_t * const *infos,
+      const string * const *results, size_t n) const;
+
+  void append_rows(const out_buffer &b, const vector<size_t> &ends,
+      const node_info_t * const *infos, const string * const *results, size_t n);
+
+};
+
+/*
+ * Base for the machine readable reports: one record per checked item
+ */
+class reporter_records: public virtual reporter {
+
+protected:
+
+ out_buffer out;
+
+ const char *get_string_kind() const;
+
+ /*
+  * Writes the record of one item
+  */
+ virtual void put_record(out_buffer &b, const node_info_t&, const string &class_name) const = 0;
+
+public:
+
+  explicit reporter_records(string file) :
+      reporter(file, false), out(&report) {
+  }
+
+  void end() {
+    out.flush();
+  }
+
+  void format(const node_info_t&, const string &class_name);
+
+  bool parallel() const {
+    return true;
+  }
+
+  void format_rows(out_buffer &b, vector<size_t> &ends, const node_info_t * const *infos,
+      const string * const *results, size_t n) const;
+
+  void append_rows(const out_buffer &b, const vector<size_t> &ends,
+      const node_info_t * const *infos, const string * const *results, size_t n);
+
+};
+
+/*
+ * JSON Lines report: one object per checked item
+ */
+class reporter_jsonl: public reporter_records {
+
+ void put_record(out_buffer &b, const node_info_t&, const string &class_name) const;
+
+public:
+
+  explicit reporter_jsonl(string file) :
+      reporter(file, false), reporter_records(file) {
+  }
+
+};
+
+/*
+ * CSV report: a header line and one row per checked item
+ */
+class reporter_csv: public reporter_records {
+
+ void put_record(out_buffer &b, const node_info_t&, const string &class_name) const;
+
+public:
+
+  explicit reporter_csv(string file) :
+      reporter(file, false), reporter_records(file) {
+  }
+
+  void start();
+
+};
+
+/*
+ * Forwards everything to a list of reporters, so that a single traversal
+ * (and a single checker call per item) feeds all of them.
+ * The sinks are not owned.
+ */
+class reporter_fanout: public virtual reporter {
+
+ vector<reporter*> sinks;
+ uint jobs;
+
+public:
+
+  reporter_fanout() :
+      jobs(1) {
+  }
+
+  /*
+   * @brief Number of threads formatting rows (1: everything on the calling thread)
+   */
+  void set_jobs(uint n) {
+    jobs = n ? n : 1;
+  }
+
+  void add_sink(reporter *r) {
+    sinks.push_back(r);
+  }
+
+  void start();
+  void title();
+
+  void tree_title(string);
+
+  void tree_start();
+  void tree_end();
+
+  void end();
+
+  void format(const node_info_t&, const string &class_name);
+
+  void format_batch(const node_info_t * const *infos, const string * const *results, size_t n);
 
 };
 
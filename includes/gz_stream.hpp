@@ -0,0 +1,145 @@
+/******************************************************************************
+ * (C) Copyright 2017 AMIQ Consulting
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *******************************************************************************/
+
+#ifndef INCLUDES_GZ_STREAM_HPP_
+#define INCLUDES_GZ_STREAM_HPP_
+
+#include <stdio.h>
+#include <zlib.h>
+
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+/*
+ * Size of the blocks handed to the compressor and the number of blocks that
+ * may wait for it before the writer blocks
+ */
+#define GZ_BLOCK_SIZE (1 << 18)
+#define GZ_QUEUE_BLOCKS 4
+
+/*
+ * @brief Stream buffer writing a gzip file.
+ * @brief Data is collected in blocks and full blocks are deflated on a
+ * @brief background thread, so the writer only waits for the compressor when
+ * @brief GZ_QUEUE_BLOCKS blocks are already pending.
+ * @brief In append mode a new gzip member is added at the end of the file,
+ * @brief gunzip reads all members as one stream.
+ */
+class gz_streambuf: public std::streambuf {
+
+  FILE *file;
+  z_stream zs;
+  bool failed;
+
+  string block;                 // put area
+  std::deque<string> queue;     // blocks waiting for the compressor
+  vector<string> spare;         // compressed blocks, reused as put areas
+  bool done;
+
+  std::mutex mtx;
+  std::condition_variable ready;
+  std::condition_variable space;
+  std::thread worker;
+
+  void hand_off();
+  void deflate_block(const char *data, size_t len, int flush, vector<char> &out);
+  void compress();
+
+protected:
+
+  int overflow(int c);
+  int sync();
+
+public:
+
+  gz_streambuf() :
+      file(NULL), failed(false), done(false) {
+  }
+
+  ~gz_streambuf() {
+    close();
+  }
+
+  /*
+   * @brief Opens file for writing and starts the compressor
+   * @return true on success
+   */
+  bool open(const string &name, bool append);
+
+  /*
+   * @brief Compresses what is left, ends the gzip member and closes the file
+   * @return true if everything was written
+   */
+  bool close();
+
+  bool is_open() const {
+    return file != NULL;
+  }
+};
+
+/*
+ * @brief Output file of a report. A name ending in ".gz" gives a gzip
+ * @brief compressed file, any other name a plain one.
+ */
+class out_file: public std::ostream {
+
+  std::filebuf plain;
+  gz_streambuf gz;
+  bool compressed;
+
+public:
+
+  out_file() :
+      std::ostream(NULL), compressed(false) {
+  }
+
+  explicit out_file(const string &name, bool append = false) :
+      std::ostream(NULL), compressed(false) {
+    open(name, append);
+  }
+
+  ~out_file() {
+    close();
+  }
+
+  void open(const string &name, bool append = false);
+
+  void close();
+
+  bool is_open() const {
+    return compressed ? gz.is_open() : plain.is_open();
+  }
+};
+
+/*
+ * @brief True if file is named as a gzip file
+ */
+static inline bool gz_name(const string &file) {
+  return file.size() > 3 && !file.compare(file.size() - 3, 3, ".gz");
+}
+
+#endif  // INCLUDES_GZ_STREAM_HPP_
@@ -0,0 +1,48 @@
+/******************************************************************************
+ * (C) Copyright 2017 AMIQ Consulting
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *******************************************************************************/
+
+#ifndef INCLUDES_INCREMENTAL_HPP_
+#define INCLUDES_INCREMENTAL_HPP_
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "top_tree.hpp"
+
+using std::string;
+using std::vector;
+
+/**
+ * @brief Checks the UCISDBs incrementally.
+ * @brief For each UCISDB, the items passed to run_check and the results of each check
+ * @brief are kept in cache_dir. As long as the UCISDB doesn't change, later runs don't
+ * @brief open it: results of known checks are reused and only new or changed checks are
+ * @brief evaluated, by replaying the stored items that can reach them.
+ * @param trie Checks, populated by the parsers
+ * @param dbs Paths to the UCISDBs
+ * @param cache_dir Directory holding the per UCISDB state
+ * @param refinement_flag How items are indexed (see search_callback)
+ * @param debug Generate debug info
+ * @param silent Don't generate stdout output
+ * @return 0 on success
+ */
+int inc_main(top_tree *trie, const vector<string> &dbs, const string &cache_dir,
+    bool refinement_flag, bool debug, bool silent);
+
+#endif  // INCLUDES_INCREMENTAL_HPP_
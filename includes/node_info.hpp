@@ -18,9 +18,29 @@
 #ifndef INCLUDES_NODE_INFO_HPP_
 #define INCLUDES_NODE_INFO_HPP_
 
+#include <stdint.h>
+
+#include <map>
 #include <string>
+#include <vector>
 
+using std::map;
 using std::string;
+using std::vector;
+
+/*
+ * Toggle state of a signal: bits 2 * i and 2 * i + 1 of words are set once bit i
+ * of the signal rose and fell. Only bits low to high were seen in the UCISDB.
+ */
+typedef struct toggle_bits_t {
+  int64_t low;
+  int64_t high;
+  vector<uint64_t> words;
+
+  toggle_bits_t() :
+      low(0), high(-1) {
+  }
+} toggle_bits_t;
 
 /*
  * All the information stored for an exclusion
@@ -30,6 +50,10 @@ using std::string;
  * Hit count: number of times the element was exercised
  * Found: set to true if the element was found
  * Expanded: set to true if CL generated the exclusion (see README)
+ * Bin hits: hit count of each index, for checks on a range of an array bin
+ * Min hits: hit count the item needs to pass, for checks with a threshold
+ * Toggle bits: toggle state of each signal matched by a toggle check
+ * Tests: tests that hit the element, when hits are attributed (see attribution.hpp)
  */
 typedef struct node_info_t {
 
@@ -51,6 +75,20 @@ public:
 
   string comment;   // comment if present
 
+  int64_t bin_first;          // first index of an array bin range
+  vector<int64_t> bin_hits;   // one count per index of the range, empty for other checks
+
+  int64_t min_hits;           // threshold, 0 if the check has none
+
+  map<string, toggle_bits_t> toggle_bits;   // per signal, empty for other checks
+
+  vector<uint32_t> tests;     // sorted test numbers, empty unless hits are attributed
+
+  node_info_t() :
+      line(0), hit_count(0), found(false), expanded(false), negated(false), generator_line(0),
+      bin_first(0), min_hits(0) {
+  }
+
   bool operator==(const node_info_t &a) const {
 
     return
@@ -119,6 +119,63 @@ typedef pair<string, vector<string> > flag;
  */
 typedef vector<map<string, vector<string>>> pu_results;
 
+/**
+ * @brief Read-only view over the flags of one command.
+ * @brief It points into buffers owned by the parser, which are reused from
+ * @brief one command to the next: it is only valid inside the consumer.
+ */
+class pu_cmd {
+
+  const flag *flags;
+  size_t count;
+
+public:
+
+  pu_cmd(const flag *flags, size_t count) :
+      flags(flags), count(count) {
+  }
+
+  /**
+   * @brief Returns the number of flags in the command
+   */
+  size_t size() const {
+    return count;
+  }
+
+  /**
+   * @brief Returns true if the command has the given flag
+   */
+  bool has(const char *f) const {
+    for (size_t i = 0; i < count; ++i)
+      if (flags[i].first == f)
+        return true;
+
+    return false;
+  }
+
+  /**
+   * @brief Returns the args of a flag (empty if the flag is missing).
+   * @brief If a flag is repeated, the last one wins.
+   */
+  const vector<string> &args(const char *f) const {
+    static const vector<string> none;
+
+    for (size_t i = count; i > 0; --i)
+      if (flags[i - 1].first == f)
+        return flags[i - 1].second;
+
+    return none;
+  }
+};
+
+/**
+ * @brief Receives each command as soon as it was parsed
+ * @param cmd The command
+ * @param line Line of the command in the parsed file
+ * @param data User data given to pu_set_consumer
+ */
+typedef void (*pu_consumer)(const pu_cmd &cmd, uint line, void *data);
+
 /**
  * @brief Generic parser for command files.
  * @brief Each file must be comprised of only one type of cmds
@@ -128,13 +185,20 @@ class pu {
   ifstream *fsp;
   int eof_flag;
 
+  // Flags of the current command; slots are reused between commands
   vector<flag> cmd_flags;
+  size_t nof_flags;
+
   vector<vector<flag> > commands;
 
+  pu_consumer consumer;
+  void *consumer_data;
+
   pu_config cfg;
   pu_args args;
 
   uint current_line;
+  uint cmd_line;
   vector<uint> cmd_lines;
 
   /**
@@ -144,6 +208,16 @@ class pu {
    */
   void pu_replace_line(string &line, size_t &pos);
 
+  /**
+   * @brief Returns a cleared flag slot for the current command
+   */
+  flag &pu_new_flag();
+
+  /**
+   * @brief Hands the current command to the consumer or stores it
+   */
+  void pu_end_cmd();
+
 public:
 
   bool silent; /**< don't output anything to stdout */
@@ -236,8 +310,21 @@ public:
    */
   int pu_goto_next_token(string &line, size_t &pos);
 
+  /**
+   * @brief Returns the stored commands (when no consumer is set)
+   */
   pu_results pu_get_results();
 
+  /**
+   * @brief Streams commands to f instead of storing them
+   * @param f Function called for each command
+   * @param data Passed to f
+   */
+  void pu_set_consumer(pu_consumer f, void *data) {
+    consumer = f;
+    consumer_data = data;
+  }
+
   pu(pu_config cfg, pu_args args, ifstream &f) :
       cfg(cfg), args(args) {
 
@@ -245,9 +332,13 @@ public:
 
     eof_flag = 0;
     cmd_flags.resize(0);
+    nof_flags = 0;
     commands.resize(0);
+    consumer = NULL;
+    consumer_data = NULL;
     silent = false;
     current_line = 0;
+    cmd_line = 0;
   }
   ;
 
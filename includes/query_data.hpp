@@ -37,16 +37,23 @@ using std::cerr;
 
 //using namespace std;
 
+/*
+ * @brief Forgets the scope handles of the UCISDB that was closed
+ */
+void reset_query_cache();
+
 /*
  *  @brief Returns params to construct a query for all types of trees (see top_tree.hpp)
  *  @param cbdata used to get DB handle
  *  @param sourceinfo used to get info about files
  *  @param coverdata used to get info about the item
  *  @param name item name in UCISDB
- *  @return a vector with three queries, one for each tree
+ *  @param trie checks, the DU query is left empty if none can match it
+ *  @return a vector with three queries, one for each tree, then the path of the
+ *  @return instance that holds the item
  */
 vector<string> get_query_array(ucisCBDataT *cbdata, ucisSourceInfoT sourceinfo,
-    ucisCoverDataT coverdata, char *name, node_info_t& inf);
+    ucisCoverDataT coverdata, char *name, node_info_t& inf, const top_tree *trie);
 
 /*
  *  @brief Returns a query for a type of tree (see top_tree.hpp)
@@ -58,4 +65,14 @@ vector<string> get_query_array(ucisCBDataT *cbdata, ucisSourceInfoT sourceinfo,
  */
 string get_query(ucisCBDataT *cbdata, ucisCoverDataT coverdata, char *name, bool &reset, node_info_t& inf, bool ref);
 
+/*
+ *  @brief Returns the queries of a toggle bin for all types of trees (see top_tree.hpp),
+ *  @brief as <location>/<signal>/<bit>/<edge>/o/. Toggles have no source file query.
+ *  @param cbdata used to get DB handle
+ *  @param name item name in UCISDB
+ *  @return a vector with three queries, then the location of the bin, all empty if the
+ *  @return bin is not a 0->1 or 1->0 toggle
+ */
+vector<string> get_toggle_queries(ucisCBDataT *cbdata, char *name, node_info_t& inf);
+
 #endif  // INCLUDES_QUERY_DATA_HPP_
@@ -0,0 +1,58 @@
+/******************************************************************************
+ * (C) Copyright 2017 AMIQ Consulting
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *******************************************************************************/
+
+#ifndef INCLUDES_RANK_HPP_
+#define INCLUDES_RANK_HPP_
+
+#include <string>
+#include <vector>
+
+#include "top_tree.hpp"
+
+using std::string;
+using std::vector;
+
+/*
+ * Ranked UCISDBs listed on stdout (the file gets all of them)
+ */
+#define RANK_TOP_TESTS 10
+
+/*
+ * Shards of the item dictionary, each with its own lock
+ */
+#define RANK_SHARDS 64
+
+/*
+ * @brief Orders the UCISDBs (one per test) so that the first ones reach the
+ * @brief coverage of all of them as soon as possible, and lists the ones needed.
+ * @brief The items are the checks of the trie or, if it has none, the code and
+ * @brief functional coverage bins under the given instances. Each UCISDB becomes
+ * @brief a compressed bitmap over a dictionary of items shared by all UCISDBs.
+ * @brief Tests are then picked greedily, by the number of items they add,
+ * @brief counted with popcounts against a plain bitset of the covered items.
+ * @param trie Checks, populated by the parsers
+ * @param dbs Paths to the UCISDBs
+ * @param scopes Instances whose bins are ranked, all if empty (without checks)
+ * @param refinement_flag How items are indexed (see search_callback)
+ * @param jobs Threads: one scans the UCISDBs, the others number their bins (without checks)
+ * @param file Where the ranked UCISDBs are listed
+ * @return 0 on success
+ */
+int rank_main(top_tree *trie, const vector<string> &dbs, const vector<string> &scopes,
+    bool refinement_flag, int jobs, const string &file);
+
+#endif  // INCLUDES_RANK_HPP_
@@ -0,0 +1,128 @@
+/******************************************************************************
+ * (C) Copyright 2017 AMIQ Consulting
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *******************************************************************************/
+
+#ifndef INCLUDES_RESULTS_DB_HPP_
+#define INCLUDES_RESULTS_DB_HPP_
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include "formatter.hpp"
+
+using std::string;
+using std::vector;
+using std::unordered_map;
+
+/*
+ * Results of a run, stored by column (one entry per checked item).
+ * All strings are dictionary encoded: columns hold indexes in dict.
+ * Status is kept both as a string (whatever the checker returned) and as
+ * bitmaps for the statuses queries care about.
+ */
+typedef struct {
+  uint64_t created;   // unix time
+
+  vector<string> dict;
+
+  vector<char> kind;
+  vector<uint32_t> type;
+  vector<uint32_t> name;
+  vector<uint32_t> location;
+  vector<uint32_t> line;
+  vector<int64_t> hit_count;
+  vector<uint32_t> status;
+  vector<uint32_t> generator;
+  vector<uint32_t> generator_line;
+  vector<uint32_t> comment;
+
+  // One bit per row
+  vector<uint64_t> fail;
+  vector<uint64_t> missing;
+} results_table_t;
+
+/*
+ * @brief Number of rows of a results table
+ */
+static inline size_t results_rows(const results_table_t &t) {
+  return t.kind.size();
+}
+
+/*
+ * @brief Collects the results in a table and stores it when the report ends
+ */
+class reporter_columns: public virtual reporter {
+
+  string file;
+  results_table_t table;
+  unordered_map<string, uint32_t> ids;
+
+  uint32_t get_id(const string &s);
+
+public:
+
+  explicit reporter_columns(const string &file);
+
+  void format(const node_info_t&, const string &class_name);
+
+  void end();
+
+  const results_table_t &results() const {
+    return table;
+  }
+
+};
+
+/*
+ * @brief Loads a results file
+ * @param file Path to the file
+ * @param t Table to fill
+ * @return 0 on success, -1 on error
+ */
+int results_load(const string &file, results_table_t &t);
+
+/*
+ * @brief Stores a results table
+ * @param file Path to the file
+ * @param t The table
+ * @return 0 on success, -1 on error
+ */
+int results_store(const string &file, const results_table_t &t);
+
+/*
+ * @brief Compares the results of two runs, check by check.
+ * @brief Checks are matched on kind, type, location, name and line.
+ * @param prev Results of the previous run
+ * @param cur Results of this run
+ * @param file Where the differences are written
+ * @param silent Don't print the totals
+ * @return Number of newly failing checks
+ */
+uint64_t results_diff(const results_table_t &prev, const results_table_t &cur, const string &file,
+    bool silent);
+
+/*
+ * @brief Implements "coverage_lens query [predicates] <results files>"
+ * @param argc Number of arguments after "query"
+ * @param argv Arguments after "query"
+ * @return 0 on success
+ */
+int query_main(int argc, char **argv);
+
+#endif  // INCLUDES_RESULTS_DB_HPP_
@@ -0,0 +1,95 @@
+/******************************************************************************
+ * (C) Copyright 2017 AMIQ Consulting
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *******************************************************************************/
+
+#ifndef INCLUDES_RULES_HPP_
+#define INCLUDES_RULES_HPP_
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "node_info.hpp"
+
+using std::string;
+using std::vector;
+
+/*
+ * One instruction of a compiled rule. Conditions set a single boolean
+ * register; && and || jump over their right side when it is not needed.
+ */
+typedef struct {
+  uint8_t op;       // rule_opcode
+  uint8_t field;    // rule_field
+  uint8_t cmp;      // rule_cmp
+  uint32_t arg;     // jump target or string index
+  int64_t num;      // constant of numeric comparisons
+} rule_op_t;
+
+/*
+ * A compiled rule: code[begin, end) and the class it assigns
+ */
+typedef struct {
+  uint32_t begin;
+  uint32_t end;
+  uint32_t target;
+} rule_t;
+
+/*
+ * @brief Ordered list of rules like "type==Statement && hit_count<10 => fail".
+ * @brief Rules are compiled once, the first one that holds for an item gives
+ * @brief its class.
+ */
+class rule_set {
+
+  vector<rule_op_t> code;
+  vector<rule_t> rules;
+  vector<string> strings;   // string constants
+  vector<string> names;     // classes assigned by the rules
+
+  bool eval(const rule_t &r, const node_info_t &inf) const;
+
+public:
+
+  /*
+   * @brief Compiles a rule and appends it to the set
+   * @param text The rule: <condition> => <class>
+   * @param err Receives a message if the rule is invalid
+   * @return 0 on success
+   */
+  int add(const string &text, string &err);
+
+  bool empty() const {
+    return rules.empty();
+  }
+
+  /*
+   * @brief Classes assigned by the rules, indexed by match() results
+   */
+  const vector<string> &targets() const {
+    return names;
+  }
+
+  /*
+   * @brief Finds the first rule that holds for an item
+   * @return Index of its class in targets(), -1 if no rule holds
+   */
+  int match(const node_info_t &inf) const;
+
+};
+
+#endif  // INCLUDES_RULES_HPP_
@@ -0,0 +1,78 @@
+/******************************************************************************
+ * (C) Copyright 2017 AMIQ Consulting
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *******************************************************************************/
+
+#ifndef INCLUDES_SUMMARY_HPP_
+#define INCLUDES_SUMMARY_HPP_
+
+#include <stdint.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+using std::map;
+using std::string;
+using std::vector;
+
+/*
+ * Check results aggregated over a subtree
+ */
+typedef struct {
+  uint64_t passed;
+  uint64_t failed;
+  uint64_t missing;
+  int64_t hits;
+} summary_count_t;
+
+/*
+ * @brief One scope (or design unit, or source directory) of a summary.
+ * @brief Children without checks are dropped and chains of scopes with a
+ * @brief single child are merged (name holds the whole chain).
+ */
+typedef struct summary_node_t {
+  string name;
+  summary_count_t total;
+  map<string, summary_count_t> types;   // per node_info_t.type
+  vector<summary_node_t> children;
+} summary_node_t;
+
+/*
+ * @brief Adds b to a
+ */
+void summary_add(summary_count_t &a, const summary_count_t &b);
+
+/*
+ * @brief Counts one check result in a node
+ */
+void summary_count(summary_node_t &s, const string &type, const string &result, int64_t hits);
+
+/*
+ * @brief Adds the totals of a child to its parent
+ * @param listed keep the child (if it is not empty) in the hierarchy
+ */
+void summary_add_child(summary_node_t &parent, summary_node_t &child, bool listed);
+
+/*
+ * @brief Writes the summary as a collapsible HTML hierarchy
+ * @param file Output file
+ * @param testname Name of the test, may be empty
+ * @param trees One root per tree, named after the tree
+ * @return 0 on success
+ */
+int summary_html(const string &file, const string &testname, const vector<summary_node_t> &trees);
+
+#endif  // INCLUDES_SUMMARY_HPP_
@@ -0,0 +1,161 @@
+/******************************************************************************
+ * (C) Copyright 2017 AMIQ Consulting
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *******************************************************************************/
+
+#ifndef INCLUDES_TOGGLE_MAP_HPP_
+#define INCLUDES_TOGGLE_MAP_HPP_
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <utility>
+
+#include "excl_tree.hpp"
+#include "attribution.hpp"
+
+using std::string;
+using std::vector;
+using std::unordered_map;
+using std::pair;
+
+/*
+ * Edges of a toggle bin, as they appear in its query:
+ *  <location>/<signal>/<bit>/<edge>/o/
+ */
+#define TOGGLE_RISE 'r'
+#define TOGGLE_FALL 'f'
+
+/*
+ * Untoggled bits listed in the name of a toggle check, as runs of bits
+ */
+#define TOGGLE_MAX_LISTED 16
+
+/*
+ * Bits above this one are ignored, it bounds the state kept for a signal
+ */
+#define TOGGLE_MAX_BIT (1 << 24)
+
+/*
+ * @brief Splits the scope of a toggle bin into the location of the signal, its name
+ * @brief and the bit: "top/dut/data[3]" and "top/dut/data/data[3]" give "top/dut",
+ * @brief "data", 3; scalars ("top/dut/en") are bit 0.
+ * @return false if the scope has no location
+ */
+bool toggle_split(const string &hier, string &location, string &signal, int64_t &bit);
+
+/*
+ * @brief Edge of a toggle bin, from its name: TOGGLE_RISE for 0->1 ("0L->1H", "0 -> 1",
+ * @brief "rise"), TOGGLE_FALL for 1->0 and 0 for the others (to or from Z and X)
+ */
+char toggle_edge(const char *name);
+
+/*
+ * @brief Parses the signal of a toggle check: "data", "data_*", "data[3]", "data[7:0]"
+ * @param pattern the signal, with an optional bit or part select
+ * @param glob receives the name, '*' and '?' match any chars and any char
+ * @param first receives the first bit checked
+ * @param last receives the last bit checked, first > last to check all the bits
+ * @return true if the pattern is valid
+ */
+bool toggle_parse_pattern(const string &pattern, string &glob, int64_t &first, int64_t &last);
+
+/*
+ * @brief Records a toggle bin in the state of its signal
+ * @param t state of the signal
+ * @param bit bit of the signal
+ * @param edge TOGGLE_RISE or TOGGLE_FALL
+ * @param hit true if the bin was hit
+ */
+void toggle_mark(toggle_bits_t &t, int64_t bit, char edge, bool hit);
+
+/*
+ * @brief Adds the toggles of b to a (as if both were seen in the same UCISDB)
+ */
+void toggle_merge(toggle_bits_t &a, const toggle_bits_t &b);
+
+/*
+ * @brief Returns true for the queries of toggle checks (<signal>/o/, O/ for all the
+ * @brief signals under a location) and of toggle bins
+ */
+bool toggle_query(const string &query);
+
+/*
+ * @brief Toggle checks, indexed by location.
+ * @brief Toggle bins are too many to be trie leaves: each check keeps the state of the
+ * @brief signals it matches as dense bitsets, 2 bits per bit of the signal (see
+ * @brief toggle_bits_t). A bin reaches the checks of its location whose signal pattern
+ * @brief it matches, and the checks on all the signals of one of the locations above.
+ */
+class toggle_map {
+
+  typedef struct {
+    string glob;        // signal name pattern, empty for all the signals
+    int64_t first;
+    int64_t last;       // bits checked, first > last for all
+    size_t depth;       // size of the location
+    excl_tree *node;
+  } toggle_check_t;
+
+  vector<toggle_check_t> checks;
+
+  // Per tree (see top_tree::run_check select): location => checks
+  unordered_map<string, vector<size_t> > locations[3];
+
+  // Bins of a location come together: keep the checks that can match the last one
+  string last_location[3];
+  vector<size_t> last_checks[3];
+
+  void lookup(int tree, const string &location);
+
+public:
+
+  /*
+   * @brief Returns true if there are no toggle checks
+   */
+  bool empty() const {
+    return checks.empty();
+  }
+
+  /*
+   * @brief Adds a toggle check
+   * @param tree 0 for instance, 1 for design unit and 2 for source file checks
+   * @param query query of the check, as given to top_tree::add
+   * @param node its node in the trie, where the results go
+   */
+  void add(int tree, const string &query, excl_tree *node);
+
+  /*
+   * @brief Passes a toggle bin to the checks that match it
+   * @param tree 0 for instance, 1 for design unit and 2 for source file queries
+   * @param query <location>/<signal>/<bit>/<edge>/o/
+   * @param cov_val hit count of the bin
+   * @param attribution tests of the bin, if hits are attributed
+   * @param hit if set, receives the nodes of the checks the bin matched
+   */
+  void run(int tree, const string &query, int64_t cov_val, test_attribution *attribution = NULL,
+      vector<excl_tree*> *hit = NULL);
+
+  /*
+   * @brief Sets the result of each check once all UCISDBs were searched: it is hit
+   * @brief only if every bit of its signals rose and fell. The number of toggled bits
+   * @brief and the untoggled ones are added to the name.
+   */
+  void close();
+};
+
+#endif  // INCLUDES_TOGGLE_MAP_HPP_
@@ -27,13 +27,49 @@
 #define AMIQ_UCIS_ADDITIONAL 6
 #define AMIQ_UCIS_HITCOUNT 7
 
+#include <set>
+
 #include "excl_tree.hpp"
+#include "batch_checker.hpp"
+#include "toggle_map.hpp"
+#include "attribution.hpp"
 
+using std::map;
 using std::ofstream;
+using std::set;
 using std::string;
+using std::unordered_map;
 using std::vector;
 
 
+/*
+ * @brief An item from the UCISDB, as it was passed to run_check.
+ * @brief select is 0 for items checked with a scope, du, src query triple.
+ */
+typedef struct {
+  int select;
+  string queries[3];
+  int64_t cov_val;
+  string name;
+  uint32_t line;
+  string type;
+} check_item_t;
+
+/*
+ * @brief Items passed to run_check that can reach a check, and the locations (see
+ * @brief excl_tree::reaches) of the ones left out, for the instance, DU and source
+ * @brief file trees. A check that one of those locations reaches needs a new search.
+ */
+typedef struct {
+  vector<check_item_t> items;
+  set<string> skipped[3];
+} item_record_t;
+
+/*
+ * @brief Hits of design unit checks per instance: check node -> instance path -> hit count
+ */
+typedef map<excl_tree*, map<string, int64_t> > du_instances_t;
+
 /*
  * @brief Wrapper over exclusion trees (see excl_tree.hpp)
  * @brief Since multiple types exclusion scopes are supported, we keep a tree for each one:
@@ -46,15 +82,80 @@ class top_tree {
   excl_tree* du_tr;
   excl_tree* scope_tr;
 
+  /*
+   * DU queries don't depend on the instance: every instance of a design unit
+   * repeats them, so each one is looked up in du_tr only once
+   */
+  unordered_map<string, excl_tree*> du_memo;
+
+  excl_tree* find_du(const string& query);
+
+  /*
+   * Items come grouped by scope: the last location looked up in each tree
+   */
+  string record_location[3];
+  bool record_reaches[3];
+
+  /*
+   * @brief Appends an item to the recorder if it can reach a check
+   */
+  void record(const check_item_t& item);
+
+  /*
+   * @brief Adds the hits of an item to the instance breakdown of the DU check it hit
+   */
+  void count_instance(excl_tree* leaf, const string& instance, int64_t cov_val) {
+    if (!instance.empty())
+      (*du_instances)[leaf][instance] += cov_val;
+  }
+
+  /*
+   * @brief Adds the tests of the current item to a check it hit
+   */
+  void attribute(node_info_t *inf, int64_t cov_val) {
+    const vector<uint32_t> *tests;
+
+    if (attribution && cov_val > 0 && (tests = attribution->current_tests()))
+      merge_tests(inf->tests, *tests);
+  }
+
 public:
 
   int excl_count;
 
+  /*
+   * If set, the items passed to run_check that can reach a check are also
+   * appended here, with the locations of the others
+   */
+  item_record_t *recorder;
+
+  /*
+   * Toggle checks are also kept here, by location: toggle bins don't go through the trees
+   */
+  toggle_map toggles;
+
+  /*
+   * If set, hits are attributed to tests: the tests of the bin being checked
+   * (see test_attribution::set_bin) are added to the checks it reaches
+   */
+  test_attribution *attribution;
+
+  /*
+   * If set, the hits of design unit checks are also collected per instance
+   */
+  du_instances_t *du_instances;
+
   top_tree() {
     src_tr = new excl_tree("");
     du_tr = new excl_tree("");
     scope_tr = new excl_tree("");
     excl_count = 0;
+    recorder = NULL;
+    attribution = NULL;
+    du_instances = NULL;
+
+    for (int i = 0; i < 3; ++i)
+      record_location[i] = "/";
   }
 
   ~top_tree() {
@@ -63,6 +164,24 @@ public:
     delete scope_tr;
   }
 
+  /*
+   * @brief Tells if the items of a design unit can reach a type check. While items
+   * @brief are recorded, their DU is also needed to tell where the ones left out are.
+   * @param du name of the design unit
+   */
+  bool du_checked(const string& du) const {
+    return recorder || du_tr->has_child(du);
+  }
+
+  /*
+   * @brief Tells if an item of a location can reach a check of a tree
+   * @param tree 0 for instance, 1 for design unit and 2 for source file checks
+   * @param location path of the location, see excl_tree::reaches
+   */
+  bool reaches(int tree, const string& location) const {
+    return (tree == 0 ? scope_tr : tree == 1 ? du_tr : src_tr)->reaches(location);
+  }
+
   /*
    * @brief Adds a new node in the tree
    * @param query the exclusion to be added
@@ -87,7 +206,7 @@ public:
 
   /*
    * @brief Gets all the needed info from the UCISDB and searches in all trees
-   * @param params all the info from UCISDB
+   * @param params a query for each tree, then the instance of the item, if it is known
    */
   void run_check(const vector<string>& params, const int64_t cov_val, const node_info_t& inf);
 
@@ -104,11 +223,38 @@ public:
   void print_hit_map(ofstream& out);
 
   /*
-   * @brief Generates a report using the given function and reporter
+   * @brief Lists the hits of each design unit check per instance, as collected
+   * @brief in du_instances
+   * @param out where to print
+   */
+  void print_du_instances(out_buffer& out);
+
+  /*
+   * @brief Collects the checks of all trees. Paths are prefixed with the
+   * @brief tree kind ('f', 'd' or 's').
+   * @param out pairs of path, node
+   */
+  void get_leaves(vector<pair<string, excl_tree*> > &out);
+
+  /*
+   * @brief Sets the results of the checks that depend on all their hits (ranges,
+   * @brief thresholds, toggles), once all UCISDBs were searched
+   */
+  void close_checks();
+
+  /*
+   * @brief Generates a report using the given checker and reporter
    * @param r Reporter class
-   * @param f Function applied on exclusions
+   * @param c Checker applied on exclusions
+   */
+  void gen_report(reporter &r, batch_checker &c);
+
+  /*
+   * @brief Aggregates the results per scope and per type, without formatting each check
+   * @param c Checker applied on exclusions
+   * @param out One root per non empty tree, named after it
    */
-  void gen_report(reporter &r, checker f);
+  void gen_summary(batch_checker &c, vector<summary_node_t> &out);
 };
 
 #endif  // INCLUDES_TOP_TREE_HPP_
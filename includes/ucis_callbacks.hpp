@@ -27,6 +27,8 @@
 #include "exclusion_parser.hpp"
 #include "vplan_parser.hpp"
 #include "query_data.hpp"
+#include "cov_index.hpp"
+#include "assert_census.hpp"
 
 
 using std::ostream;
@@ -53,17 +55,61 @@ ucisCBReturnT search_callback(void* userdata, ucisCBDataT* cbdata);
  */
 ucisCBReturnT map_callback(void* userdata, ucisCBDataT* cbdata);
 
+/* Private data of index_callback */
+typedef struct {
+  struct dustate du;
+  cov_index *index;
+  cov_scope_t scope;        // scopes above the bins being scanned
+} cov_scan_t;
+
 /*
- * @brief Callback that implementes functional coverage utilities
+ * @brief Callback that adds the covergroup bins to a cov_index
  */
-ucisCBReturnT functional_callback(void* userdata, ucisCBDataT* cbdata);
+ucisCBReturnT index_callback(void* userdata, ucisCBDataT* cbdata);
+
+/* Private data of census_callback */
+typedef struct {
+  struct dustate du;
+  assert_census *census;
+} census_scan_t;
+
+/*
+ * @brief Callback that adds the assertion counts to an assert_census
+ */
+ucisCBReturnT census_callback(void* userdata, ucisCBDataT* cbdata);
+
+/* Private data of rank_callback */
+typedef struct {
+  const vector<string> *scopes;   // instances whose bins are ranked, all if empty
+  vector<string> hits;            // names of the hit bins
+  uint64_t nof_bins;
+  ucisScopeT last;                // bins come grouped by scope: skip the name lookups
+  string hier;
+  bool wanted;
+  cov_scope_t scope;              // options of the covergroup scopes above the bins
+} rank_scan_t;
+
+/*
+ * @brief Callback that collects the names of the hit code and functional coverage bins
+ */
+ucisCBReturnT rank_callback(void* userdata, ucisCBDataT* cbdata);
 
 /**
  * @brief Iterates over the UCISDB using the given function
  * @param db_file Path to the UCISDB
  * @param iter Callback function
  * @param data Data to be passed to the callback
+ * @return 0 on success, 1 if the UCISDB can't be opened
+ */
+int iterate_db(const string &db_file, ucis_CBFuncT iter, void *data);
+
+/**
+ * @brief Searches a UCISDB for the checks of a trie (see search_callback)
+ * @param trie Checks
+ * @param db_file Path to the UCISDB
+ * @param refinement_flag How items are indexed
+ * @return 0 on success, 1 if the UCISDB can't be opened
  */
-void iterate_db(const string &db_file, ucis_CBFuncT iter, void *data);
+int search_db(top_tree *trie, const string &db_file, bool refinement_flag);
 
 #endif /* INCLUDES_UCIS_CALLBACKS_HPP_ */
@@ -20,6 +20,8 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
 #include <unistd.h>
 
 #include <iostream>
@@ -43,7 +45,9 @@ using std::cout;
  * @param folders Where we'll add a valid folder
  * @param debug Generate debug file
  * @param silent Don't generate console output
+ * @param cache_dir Where to keep the parsed folder maps (empty to disable)
  */
-int plan_parser_main(string vplan, unordered_map<string, char> &folders, bool debug, bool silent);
+int plan_parser_main(string vplan, unordered_map<string, char> &folders, bool debug, bool silent,
+    const string &cache_dir = "");
 
 #endif  // COVERAGELENS_INCLUDES_VPLAN_PARSER_HPP_
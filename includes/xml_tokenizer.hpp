@@ -0,0 +1,220 @@
+/******************************************************************************
+ * (C) Copyright 2017 AMIQ Consulting
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *******************************************************************************/
+
+#ifndef INCLUDES_XML_TOKENIZER_HPP_
+#define INCLUDES_XML_TOKENIZER_HPP_
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <istream>
+#include <string>
+#include <vector>
+#include <utility>
+
+using std::string;
+using std::vector;
+using std::pair;
+
+/*
+ * Size of the blocks read from disk and the maximum size of a text event
+ */
+#define XML_READ_CHUNK (1 << 16)
+#define XML_TEXT_CHUNK (1 << 12)
+
+/*
+ * @brief Attributes of the current element, in document order.
+ * @brief The buffers are reused between elements: copy what you need to keep.
+ */
+class xml_attrs {
+
+  friend class xml_tokenizer;
+
+  vector<pair<string, string> > slots;
+  size_t count;
+
+  /*
+   * @brief Returns a cleared slot for a new attribute name
+   */
+  string &add() {
+    if (count == slots.size())
+      slots.push_back(make_pair(string(), string()));
+
+    slots[count].first.clear();
+    slots[count].second.clear();
+
+    return slots[count++].first;
+  }
+
+  string &last_value() {
+    return slots[count - 1].second;
+  }
+
+public:
+
+  xml_attrs() :
+      count(0) {
+  }
+
+  size_t size() const {
+    return count;
+  }
+
+  const string &name(size_t i) const {
+    return slots[i].first;
+  }
+
+  const string &value(size_t i) const {
+    return slots[i].second;
+  }
+
+  /*
+   * @brief Returns the value of an attribute, or an empty string if missing
+   */
+  const string &get(const char *attr_name) const {
+    static const string none;
+
+    for (size_t i = 0; i < count; ++i)
+      if (slots[i].first == attr_name)
+        return slots[i].second;
+
+    return none;
+  }
+};
+
+/*
+ * @brief Receives the events produced by an xml_tokenizer
+ */
+class xml_handler {
+
+public:
+
+  /*
+   * @brief Called for <name ...> and for <name .../> (followed by end_element)
+   */
+  virtual void start_element(const string &name, const xml_attrs &attrs) {};
+
+  /*
+   * @brief Called for </name> and after the start of an empty element
+   */
+  virtual void end_element(const string &name) {};
+
+  /*
+   * @brief Decoded character data. Long texts are split in several calls.
+   */
+  virtual void text(const char *s, size_t len) {};
+
+  virtual ~xml_handler() {};
+};
+
+/*
+ * @brief Single pass, push style XML tokenizer.
+ * @brief Input can be fed in chunks of any size. Entities are decoded in text
+ * @brief and in attribute values. Memory is bounded by the longest tag since
+ * @brief text is handed to the handler in pieces.
+ */
+class xml_tokenizer {
+
+  enum xml_state {
+    XS_TEXT, XS_ENTITY, XS_LT, XS_START_NAME, XS_END_NAME, XS_END_TAIL, XS_IN_TAG,
+    XS_ATTR_NAME, XS_ATTR_EQ, XS_ATTR_QUOTE, XS_ATTR_VALUE, XS_EMPTY_CLOSE,
+    XS_BANG, XS_COMMENT, XS_CDATA, XS_DECL, XS_PI
+  };
+
+  xml_handler *handler;
+
+  int state;
+  int entity_ret;   // state to go back to after an entity
+  char quote;
+
+  string name;
+  string entity;
+  string text_buf;
+  string bang;      // "<!" prefix, to tell comments and CDATA apart
+
+  xml_attrs attrs;
+
+  uint64_t nof_bytes;
+  uint64_t nof_lines;
+  bool stopped;
+
+  void flush_text();
+  void decode_entity(string &out);
+  void emit_start(bool empty);
+  void step(char c);
+
+public:
+
+  explicit xml_tokenizer(xml_handler &h) :
+      handler(&h) {
+    reset();
+  }
+
+  /*
+   * @brief Parses the next block of input
+   * @param buf Input bytes
+   * @param len Number of bytes in buf
+   */
+  void feed(const char *buf, size_t len);
+
+  /*
+   * @brief Flushes pending text at the end of the input
+   */
+  void finish();
+
+  /*
+   * @brief Drops all state, the tokenizer can be reused for a new document
+   */
+  void reset();
+
+  /*
+   * @brief Makes feed() ignore any further input (used by handlers on errors)
+   */
+  void stop() {
+    stopped = true;
+  }
+
+  bool is_stopped() const {
+    return stopped;
+  }
+
+  uint64_t bytes() const {
+    return nof_bytes;
+  }
+
+  /*
+   * @brief Line of the input currently parsed, starting from 1
+   */
+  uint64_t line() const {
+    return nof_lines + 1;
+  }
+};
+
+/*
+ * @brief Feeds a whole stream to the tokenizer through a fixed size buffer
+ * @param in Input stream
+ * @param tok Tokenizer
+ * @return Number of bytes read
+ */
+uint64_t xml_feed_stream(std::istream &in, xml_tokenizer &tok);
+
+/*
+ * @brief Same as above, for a C stream (e.g. a pipe)
+ */
+uint64_t xml_feed_file(FILE *in, xml_tokenizer &tok);
+
+#endif  // INCLUDES_XML_TOKENIZER_HPP_
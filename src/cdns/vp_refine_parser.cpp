@@ -15,346 +15,385 @@
  *
  *******************************************************************************/
 
+#include <algorithm>
+#include <chrono>
+
 #include "exclusion_parser.hpp"
+#include "xml_tokenizer.hpp"
 
 // Debug
 static bool debug_switch;
 static ofstream debug_log;
-static int line_number;
 
-/**
- * @brief Tries to find rules related to code coverage in the refinement
- * @param vp_ref vpRefine file stream
- * @param folders Section in vplan mapped to code cov
- * @return Code cov type encoded as a char
+/*
+ * A vpRefine is an XML file in which each refinement block names a vPlan
+ * section (<metricsPortPath>) and carries its rules as an entity encoded XML
+ * document:
+ *
+ *   <metricsPortPath><elementName>a</elementName>...</metricsPortPath>
+ *   ...&lt;rules&gt; &lt;rule entityName=&quot;...&quot; .../&gt; &lt;/rules&gt;
+ *   &lt;cache-map&gt; &lt;cache-entry key=&quot;1&quot; value=&quot;user&quot;/&gt; ...
+ *
+ * The outer tokenizer decodes the text of the refinement and feeds it to an
+ * inner tokenizer, so rules are decoded and stored in a single pass.
  */
-static char get_to_rules(std::ifstream & vp_ref, unordered_map<string, char> folders) {
-  string line;
 
-  // Get exclusion type
-  while (line.find("<metricsPortPath") == string::npos) {
-    if (line.find("</vplanx:") != string::npos)
-      return 2;
+/**
+ * @brief Handles the embedded rules of one refinement block
+ */
+class rules_handler: public xml_handler {
 
-    getline(vp_ref, line);
-    line_number++;
-  }
+  // Exclusions waiting for the user map (only when users are targeted)
+  vector<pair<int, pair<node_info_t, string> > > pending;
+  // Each user gets paired with an int id
+  unordered_map<string, int> users;
 
-  string path_to_mapped_el = "";
+  bool in_rules;
 
-  size_t st;
-  size_t fn;
+public:
 
-  // Create path to exclusion group
-  while (1) {
-    getline(vp_ref, line);
-    line_number++;
+  top_tree *excl_tree;
+  const filters_t *fil;
+  const xml_tokenizer *inner;
 
-    if (line.find("</metricsPortPath") != string::npos)
-      break;
+  // Line in the vpRefine where the embedded document starts
+  uint64_t base_line;
 
-    st = line.find(">");
-    fn = line.find("</");
+  char default_type;
 
-    // Always append what's between <elementName>...</elementName>
-    path_to_mapped_el += "/" + string(line, st + 1, fn - st - 1);
+  rules_handler() :
+      in_rules(false), excl_tree(NULL), fil(NULL), inner(NULL), base_line(0), default_type(0) {
   }
 
-  // See if its mapped in the vplan
-  auto x = folders.find(path_to_mapped_el);
-
-  if (x == folders.end()) {
-    debug_log << "Nothing interesting @" << line_number << "! All good\n";
-    return 1;
+  uint64_t line() const {
+    return base_line + inner->line() - 1;
   }
 
-  // Found some good rules
-  while (line.find("&lt;rules&gt;") == string::npos) {
-    getline(vp_ref, line);
-    line_number++;
-  }
-
-  debug_log << "Found rules @" << line_number << " for " << x->second << ":" << x->first
-      << "! All good\n";
+  void start_element(const string &name, const xml_attrs &attrs);
+  void end_element(const string &name);
 
-  // Return rule type (L/X/S)
-  return x->second;
-}
+  void add_rule(const xml_attrs &attrs);
+  void flush();
+};
 
 /**
- * @brief Gets a string between XML quotes
- * @param line Line in vpRefine
- * @param field Indicator
- * @return <field>=&quot;<string>&quot; => <string>
+ * @brief Follows the refinement blocks and routes their rules
  */
-string get_field(string line, string field) {
+class refine_handler: public xml_handler {
 
-  // Find the indicator
-  size_t start = line.find(field);
-  string field_value;
+  // Path of the current refinement block
+  string path;
+  string element_text;
 
-  if (start == string::npos)
-    return field_value;
+  bool in_path;
 
-  size_t offset = field.size() + 7;
-  size_t finish = line.find("&quot;", start + offset);
+  // Rules of the current block are of interest
+  bool mapped;
 
-  // Gets from field=&quot to the next &quot
-  field_value = string(line, start + offset, finish - start - offset);
+public:
 
-  return field_value;
-}
+  const filters_t *fil;
 
-string read_rule(std::ifstream &vp_ref) {
+  rules_handler rules;
+  xml_tokenizer rules_tok;
 
-  string new_rule;
+  xml_tokenizer *outer;
 
-  string buff;
+  // Root element was checked
+  bool root_seen;
+  bool valid;
 
-  while (1) {
-    getline(vp_ref, buff);
-    line_number++;
+  refine_handler() :
+      in_path(false), mapped(false), fil(NULL), rules_tok(rules), outer(NULL), root_seen(false),
+      valid(true) {
+    rules.inner = &rules_tok;
+  }
+
+  void start_element(const string &name, const xml_attrs &attrs);
+  void end_element(const string &name);
+  void text(const char *s, size_t len);
 
-    new_rule += buff;
+  void end_block();
+};
 
-    if (buff.find("/&gt;") != string::npos)
-      break;
+/**
+ * @brief Parses an exclusion (a <rule .../> element) and stores it
+ * @param attrs Attributes of the rule
+ */
+void rules_handler::add_rule(const xml_attrs &attrs) {
+
+  // Run comment filtering
+  const string &comment = attrs.get("comment");
+
+  if (!fil->comments.run_check(comment))
+    return;
+
+  // Get scope fields
+  const string &new_top = attrs.get("entityName");
+
+  if (new_top.empty())
+    return;
+
+  const string &new_path = attrs.get("subEntityName");
+  const string &sub_entity_type = attrs.get("subEntityType");
+
+  char new_type = default_type;
+
+  /* Set new_type to internal codification
+   * 	 new_type:
+   *		F --> fsm
+   *		s --> state
+   *		t --> transition
+   *		b --> block
+   *		b --> case block
+   *		b --> true_block
+   *		b --> false_block
+   *		X --> top_expr
+   *		X --> expr
+   *		m --> min-term
+   *		o --> toggle of a signal
+   *		O --> every toggle (toggle folders in the vPlan)
+   */
+
+  // Slightly adjust the exclusion type
+  if (!sub_entity_type.empty())
+    new_type = sub_entity_type[0];
+
+  if (new_type == 't' && sub_entity_type.size() > 3 && sub_entity_type[3] == '-')
+    new_type = 'X';
+
+  if (new_type == 'e')
+    new_type = 'X';
+
+  if (new_type == 'f' && sub_entity_type.size() > 1 && sub_entity_type[1] == 's')
+    new_type ^= 32;  // Uppercase
+
+  if (new_type == 'i')
+    new_type = default_type;
+
+  // Toggles of a signal, or of everything under the entity
+  if (!sub_entity_type.compare(0, 6, "toggle") || sub_entity_type == "signal")
+    new_type = 'O';
+
+  if (new_type == 'O' && !new_path.empty())
+    new_type = 'o';
+
+  // Get user id
+  int key = atoi(attrs.get("user").c_str());
+
+  string query = new_top + "/";
+
+  if (!new_path.empty())
+    query += new_path + "/";
+
+  // Populate the info structure
+  node_info_t inf;
+
+  inf.location = query;
+  inf.name = sub_entity_type;
+
+  switch (new_type) {
+  case 'b':
+  case 'L':
+    inf.type = "Block";
+    break;
+  case 't':
+    inf.type = "Transition";
+    break;
+  case 's':
+    inf.type = "State";
+    break;
+  case 'F':
+    inf.type = "FSM";
+    break;
+  case 'X':
+  case 'm':
+    inf.type = "Expression";
+    break;
+  case 'o':
+  case 'O':
+    inf.type = "Toggle";
+    inf.name = new_path.empty() ? "*" : new_path;
+    break;
+  default:
+    inf.type = "Default: " + new_type;
+    debug_log << "*CL_ERR: vpRefine type solved to [" << new_type << "]\n";
+    break;
   }
 
-  return new_rule;
+  inf.negated = fil->negate;
+  inf.line = line();
+  inf.hit_count = 0;
+  inf.found = 0;
+  inf.generator = "";
+  inf.expanded = false;
+  inf.generator_line = 0;
+  inf.comment = comment;
+
+  query.push_back(new_type);
+  query.push_back('/');
+
+  debug_log << "Found exclusion [" << new_type << ":" << new_top + "/" + new_path + "/" << "] "
+      << "by user: " << key << " @" << inf.line << "! All good\n";
+
+  // No targeted users so we add it right away
+  if (fil->targeted_users.empty()) {
+    debug_log << "ADD [" << query << "]\n";
+    excl_tree->add(query, 's', inf);
+    return;
+  }
+
+  // Else wait for the user map at the end of the block
+  pending.push_back(make_pair(key, make_pair(inf, query)));
 }
 
-/**
- *  @brief Parses an exclusion, found between a <rule>...</rule>
- *  @param vp_ref Exclusion file input stream
- *  @param excl_tree Exclusion tree to be populated
- *  @param fil Structure containing filters (comments, users...)
- *  @param default_type Type used if we can't determine the type of the exclusion
- */
-void parse_rules(std::ifstream &vp_ref, top_tree* &excl_tree, const filters_t& fil,
-    char default_type) {
+void rules_handler::start_element(const string &name, const xml_attrs &attrs) {
 
-  // Setup
-  string line;
-  // Each exclusion will be a made into a string and a info structure
-  // Each will get paired with a user id
-  vector<pair<int, pair<node_info_t, string>>> all_excl;
-  // Each user gets paired with an int id
-  map<string, int> users;
+  if (name == "rules") {
+    in_rules = true;
+  } else if (name == "cache-entry") {
+    // Get user for each key
+    const string &user = attrs.get("value");
+    int key = atoi(attrs.get("key").c_str());
 
-//  getline(vp_ref, line);
-//  line_number++;
-  line = read_rule(vp_ref);
+    debug_log << "Found user/key pair [" << user << "," << key << "] @ " << line()
+        << "! All good\n";
+
+    // Store it in a map
+    users[user] = key;
+  } else if (in_rules) {
+    add_rule(attrs);
+  }
+}
 
-  // Start reading line by line
-  while (1) {
+void rules_handler::end_element(const string &name) {
 
-    if (line.find("&lt;/rules&gt;") != string::npos) {
-      debug_log << "Reached end of rules @ " << line_number << ". All good!\n";
-      break;
-    }
+  if (name == "rules") {
+    debug_log << "Reached end of rules @ " << line() << ". All good!\n";
+    in_rules = false;
+  } else if (name == "cache-map") {
+    flush();
+  }
+}
 
-    // Run comment filtering
-    string comment = get_field(line, "comment");
-    int accumulator = 1;
+/**
+ * @brief See which user did which exclusion and filter if necessary
+ */
+void rules_handler::flush() {
 
-    for (uint i = 0; i < fil.comment_workers.size(); ++i)
-      accumulator = accumulator & fil.comment_workers[i]->run_check(comment);
+  if (!pending.empty()) {
+    debug_log << "\n";
 
-    if (!accumulator) {
-//      getline(vp_ref, line);
-//      line_number++;
-      line = read_rule(vp_ref);
+    // Keys of the targeted users that appear in this block
+    unordered_set<int> keys;
 
-      continue;
+    for (auto &user : users) {
+      if (fil->targeted_users.count(user.first)) {
+        debug_log << "Found targeted user " << user.first << "\n";
+        keys.insert(user.second);
+      }
     }
 
-    // Start assembling
-    node_info_t inf;
-
-    size_t aux;
-    size_t aux2;
-
-    // Get scope fields
-    string new_top = get_field(line, "entityName");
-
-    if (new_top.empty())
-      break;
-
-    string new_path = get_field(line, "subEntityName");
-
-    char new_type = default_type;
-
-    string sub_entity_type = get_field(line, "subEntityType");
-
-    /* Set new_type to internal codification
-     * 	 new_type:
-     *		F --> fsm
-     *		s --> state
-     *		t --> transition
-     *		b --> block
-     *		b --> case block
-     *		b --> true_block
-     *		b --> false_block
-     *		X --> top_expr
-     *		X --> expr
-     *		m --> min-term
-     */
-
-    // Slightly adjust the exclusion type
-    if (!sub_entity_type.empty())
-      new_type = sub_entity_type[0];
-
-    if (new_type == 't' && sub_entity_type[3] == '-')
-      new_type = 'X';
-
-    if (new_type == 'e')
-      new_type = 'X';
-
-    if (new_type == 'f' && sub_entity_type[1] == 's')
-      new_type ^= 32;  // Uppercase
-
-    if (new_type == 'i')
-      new_type = default_type;
-
-    // Get user id
-    int key = -1;
-
-    key = atoi(get_field(line, "user").c_str());
-
-    string query = new_top + "/";
-
-    if (!new_path.empty())
-      query += new_path + "/";
-
-    // Populate the info structure
-    inf.location = query;
-    inf.name = sub_entity_type;
-
-    switch (new_type) {
-    case 'b':
-    case 'L':
-      inf.type = "Block";
-      break;
-    case 't':
-      inf.type = "Transition";
-      break;
-    case 's':
-      inf.type = "State";
-      break;
-    case 'F':
-      inf.type = "FSM";
-      break;
-    case 'X':
-    case 'm':
-      inf.type = "Expression";
-      break;
-    default:
-      inf.type = "Default: " + new_type;
-      debug_log << "*CL_ERR: vpRefine type solved to [" << new_type << "]\n";
-      break;
+    // Single pass over the exclusions
+    for (uint i = 0; i < pending.size(); ++i) {
+      if (keys.count(pending[i].first)) {
+        debug_log << "ADD [" << pending[i].second.second << "]\n";
+
+        excl_tree->add(pending[i].second.second, 's', pending[i].second.first);
+      }
     }
 
-    inf.negated = fil.negate;
-    inf.line = line_number;
-    inf.hit_count = 0;
-    inf.found = 0;
-    inf.generator = "";
-    inf.expanded = false;
-    inf.generator_line = 0;
-    inf.comment = comment;
+    debug_log << "\n";
+  }
 
-    query.push_back(new_type);
-    query.push_back('/');
+  pending.clear();
+  users.clear();
+  in_rules = false;
+}
 
-    // Store exclusion
-    all_excl.push_back(make_pair(key, make_pair(inf, query)));
+void refine_handler::start_element(const string &name, const xml_attrs &attrs) {
 
-    debug_log << "Found exclusion [" << new_type << ":" << new_top + "/" + new_path + "/" << "] "
-        << "by user: " << key << " @" << line_number << "! All good\n";
+  if (!root_seen) {
+    root_seen = true;
 
-//    getline(vp_ref, line);
-//    line_number++;
-    line = read_rule(vp_ref);
+    if (name != "vplanx:planRefinements") {
+      cerr << "Input file is not a valid vpRefine!\n";
+      cerr << outer->line() << "[<" << name << ">]\n";
+      valid = false;
+      outer->stop();
+    }
 
+    return;
   }
 
-  // Look for where the users are stored
-  while (line.find("&lt;cache-map&gt;") == string::npos) {
-    getline(vp_ref, line);
-    line_number++;
-  }
+  // New refinement block
+  if (name == "metricsPortPath") {
+    end_block();
 
-  // Get first entry
-  getline(vp_ref, line);
-  line_number++;
+    in_path = true;
+    path.clear();
+  }
 
-  while (1) {
-    // End of cache-map
-    size_t aux = line.find("/cache-map");
+  element_text.clear();
+}
 
-    if (aux != string::npos)
-      break;
+void refine_handler::end_element(const string &name) {
 
-    aux = line.find("cache-entry");
+  if (!in_path)
+    return;
 
-    if (aux == string::npos) {
-      getline(vp_ref, line);
-      line_number++;
-      continue;
-    }
+  if (name != "metricsPortPath") {
+    // Always append what's between <elementName>...</elementName>
+    path += "/" + element_text;
+    return;
+  }
 
-    // Get user for each key
-    string user = get_field(line, "value");
+  in_path = false;
 
-    int key = atoi(get_field(line, "key").c_str());
+  // See if its mapped in the vplan
+  auto x = fil->folders.find(path);
 
-    debug_log << "Found user/key pair [" << user << "," << key << "] @ " << line_number
-        << "! All good\n";
+  if (x == fil->folders.end()) {
+    debug_log << "Nothing interesting @" << outer->line() << "! All good\n";
+    debug_log << " No rules tested here\n";
+    return;
+  }
 
-    // Store it in a map
-    users[user] = key;
+  debug_log << "Found rules @" << outer->line() << " for " << x->second << ":" << x->first
+      << "! All good\n";
+  debug_log << " We should have rules\n";
 
-    getline(vp_ref, line);
-    line_number++;
-  }
+  // Return rule type (L/X/S)
+  mapped = true;
+  rules.default_type = x->second;
+}
 
-  debug_log << "\n";
-  // Finished with the parsing
-  // See which user did which exclusion and filter if necessary
-  if (!fil.targeted_users.empty()) {
-    // Get stats for each user
-    for (int it = 0; it < fil.targeted_users.size(); ++it) {
-      if (users.find(fil.targeted_users[it]) == users.end()) {
-        debug_log << "Targeted user " << fil.targeted_users[it]
-            << " doesn't have exclusions in this block!\n";
-        continue;
-      }
+void refine_handler::text(const char *s, size_t len) {
 
-      // Get key for user
-      int required_key = users[fil.targeted_users[it]];
+  if (in_path) {
+    element_text.append(s, len);
+  } else if (mapped) {
+    // Text is handed over once read, so count back to where it started
+    if (!rules_tok.bytes())
+      rules.base_line = outer->line() - std::count(s, s + len, '\n');
 
-      debug_log << "Found for user " << fil.targeted_users[it] << ": \n";
+    rules_tok.feed(s, len);
+  }
+}
 
-      // Search for his exclusions
-      for (uint i = 0; i < all_excl.size(); ++i) {
-        if (all_excl[i].first == required_key) {
-          debug_log << "ADD [" << all_excl[i].second.second << "]\n";
+/**
+ * @brief Closes the current refinement block
+ */
+void refine_handler::end_block() {
 
-          excl_tree->add(all_excl[i].second.second, 's', all_excl[i].second.first);
-        }
-      }
-    }
-  } else {
-    // No targeted users so we add everything
-    for (uint i = 0; i < all_excl.size(); ++i) {
-      debug_log << "ADD [" << all_excl[i].second.second << "]\n";
+  if (!mapped)
+    return;
 
-      excl_tree->add(all_excl[i].second.second, 's', all_excl[i].second.first);
-    }
-  }
+  rules_tok.finish();
+  rules.flush();
+  rules_tok.reset();
 
-  debug_log << "\n";
+  mapped = false;
 }
 
 /**
@@ -373,7 +412,7 @@ int vp_main(top_tree* &acc, string ref, const filters_t &fil, bool debug, bool s
     debug_log.open("vp_refine_parser.log", std::ofstream::out);
 
   // Open vpRefine
-  std::ifstream vp_ref(ref, std::ifstream::in);
+  std::ifstream vp_ref(ref, std::ifstream::in | std::ifstream::binary);
 
   if (!vp_ref.is_open()) {
     cerr << "Could not open file " << ref << " !\n";
@@ -382,59 +421,49 @@ int vp_main(top_tree* &acc, string ref, const filters_t &fil, bool debug, bool s
 
   // Print users
   debug_log << "Targeting: \n";
-  for (int i = 0; i < fil.targeted_users.size(); ++i)
-    debug_log << "\t[" << fil.targeted_users[i] << "] \n";
-
-  string line;
+  for (auto &user : fil.targeted_users)
+    debug_log << "\t[" << user << "] \n";
 
   // Start reading + some checks
+  string line;
   getline(vp_ref, line);
-  line_number++;
 
   if (line.find("<?xml version=") == string::npos) {
     cerr << "Input file is not a valid XML!\n";
     return -1;
   }
 
-  getline(vp_ref, line);
-  line_number++;
+  vp_ref.seekg(0);
+
+  // Setup the two tokenizers
+  refine_handler handler;
+  xml_tokenizer tok(handler);
 
-  if (line.find("<vplanx:planRefinements") == string::npos) {
-    cerr << "Input file is not a valid vpRefine!\n";
-    cerr << line_number << "[" << line << "]\n";
+  handler.fil = &fil;
+  handler.outer = &tok;
+
+  handler.rules.excl_tree = acc;
+  handler.rules.fil = &fil;
+
+  auto start = std::chrono::steady_clock::now();
+
+  // Traverse the file
+  uint64_t nof_bytes = xml_feed_stream(vp_ref, tok);
+
+  if (!handler.valid)
     return -1;
-  }
 
-  line_number = 2;
-
-  // Traverse files
-  while (1) {
-    // Get to a relevant part
-    char metric_port_path = get_to_rules(vp_ref, fil.folders);
-
-    switch (metric_port_path) {
-    case 1:
-      debug_log << " No rules tested here";
-      break;
-    case 2:
-      debug_log << " EOF";
-      break;
-    default:
-      debug_log << " We should have rules";
-      break;
-    }
+  handler.end_block();
 
-    debug_log << "\n";
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
 
-    if (metric_port_path == 2) {
-      break;
-    } else if (metric_port_path != 1) {
-      // Found rules => parse them
-      parse_rules(vp_ref, acc, fil, metric_port_path);
-    }
-  }
+  debug_log << " EOF\n";
+  debug_log << "Parsed " << nof_bytes << " bytes in " << elapsed.count() << "s";
 
-  debug_log << "\n\n";
+  if (elapsed.count() > 0)
+    debug_log << " (" << nof_bytes / elapsed.count() / (1 << 20) << " MB/s)";
+
+  debug_log << "\n\n\n";
   acc->print(debug_log);
 
   if (!silent)
@@ -442,4 +471,3 @@ int vp_main(top_tree* &acc, string ref, const filters_t &fil, bool debug, bool s
 
   return 0;
 }
-
@@ -16,143 +16,273 @@
  *******************************************************************************/
 
 #include "vplan_parser.hpp"
+#include "xml_tokenizer.hpp"
 
 // Debug
 static bool debug_switch;
 static ofstream debug_log;
 
-static ifstream vplan_xml;
+// Identifies a folder map cache file
+static const char cache_magic[8] = { 'C', 'L', 'V', 'P', 'L', 'A', 'N', '1' };
+
+/*
+ * A frame for each open <section> or <metricsPort>
+ */
+typedef struct {
+  string name;
+  bool is_port;
+  bool named;
+} plan_frame_t;
 
 /**
- * @brief Parses the type of a code coverage entry
- * @param open_sections Current recursivity level
- * @param acc Current accumulated path
- * @param folders Where we'll add a valid folder
+ * @brief Builds the folder map while the vplanx XML streams by.
+ * @brief The sections are tracked on an explicit stack instead of recursing.
  */
-void parse_metrics_types(int open_sections, const string & acc,
-    unordered_map<string, char> &folders) {
-  string line;
-  size_t aux, aux2;
+class plan_handler: public xml_handler {
+
+  vector<plan_frame_t> sections;
 
-  string kind;
+  bool in_root;
+  bool in_types;
 
-  while (1) {
+  // Capture the text of the current element
+  bool capture;
+  bool expect_kind;
+  string text_buf;
 
-    getline(vplan_xml, line);
+  // Path of the metricsPort whose types we read
+  string types_path;
 
-    aux = line.find("<");
-    aux2 = line.find(" ", aux);
+  /*
+   * @brief Current accumulated path: /<section>/.../<port>
+   */
+  string path() const {
+    string acc;
+
+    for (size_t i = 0; i < sections.size(); ++i)
+      acc += "/" + sections[i].name;
+
+    return acc;
+  }
+
+  void indent() {
+    for (size_t i = 0; i < sections.size(); ++i)
+      debug_log << "\t";
+  }
 
-    if (aux == string::npos || aux2 == string::npos)
-      break;
+public:
+
+  unordered_map<string, char> *folders;
+
+  plan_handler(unordered_map<string, char> &f) :
+      in_root(false), in_types(false), capture(false), expect_kind(false), folders(&f) {
+  }
+
+  void start_element(const string &name, const xml_attrs &attrs) {
+
+    if (name == "rootElements") {
+      in_root = true;
+      return;
+    }
+
+    if (!in_root)
+      return;
 
     /*
-     * How this line works:
-     * 1) we stored the path in acc
-     * 2) line should be only:
+     * Children of <metricsTypes> are only:
      * a) fsm-...
      * b) block...
      * c) expression...
-     * 3) type will be s,l or x
-     * 4) we uppercase it with ^32
-     * 5) we mapped the section to its type
+     * their second letter (s,l or x) uppercased is the type of the folder
      */
-    folders[acc] = line[aux + 2] ^ 32;
+    if (in_types) {
+      if (name.size() > 1)
+        (*folders)[types_path] = name[1] ^ 32;
+      return;
+    }
 
-    if (line.find("</metricsTypes>") != string::npos) {
-      break;
+    if (name == "section" || name == "metricsPort") {
+      plan_frame_t frame;
+
+      frame.is_port = (name == "metricsPort");
+      frame.named = false;
+      sections.push_back(frame);
+    } else if (name == "name" && !sections.empty() && !sections.back().named) {
+      text_buf.clear();
+      capture = true;
+    } else if (name == "metricsTypes" && !sections.empty() && sections.back().is_port) {
+      types_path = path();
+      in_types = true;
+    } else if (expect_kind) {
+      text_buf.clear();
+      capture = true;
     }
   }
-}
 
-/**
- * @brief Searches for a <metricsTypes> tag while building a path to it
- * @param open_sections: current recursivity level
- * @param acc: current accumulated path
- * @param folders: where we'll add a valid folder
- */
-void parse_metrics_port(int open_sections, const string & acc,
-    unordered_map<string, char> &folders) {
+  void end_element(const string &name) {
 
-  string line;
-  size_t aux, aux2;
+    if (name == "rootElements") {
+      in_root = false;
+      return;
+    }
 
-  string name;
-  string kind;
+    if (name == "metricsTypes") {
+      in_types = false;
+      return;
+    }
 
-  while (1) {
-    getline(vplan_xml, line);
+    if (capture) {
+      capture = false;
+
+      if (name == "name" && !sections.back().named) {
+        // Get section name
+        sections.back().name = text_buf;
+        sections.back().named = true;
+
+        if (!sections.back().is_port) {
+          indent();
+          debug_log << "Folder: " << text_buf << "\n";
+        }
+      } else if (expect_kind) {
+        // Get the kind of the metrics port
+        expect_kind = false;
+
+        indent();
+        debug_log << text_buf << ": " << sections.back().name << "\n";
+      }
+      return;
+    }
+
+    if ((name == "section" || name == "metricsPort") && !sections.empty())
+      sections.pop_back();
+  }
 
-    // Get section name
-    if (line.find("<name") != string::npos && name.empty()) {
-      aux = line.find('>');
-      aux2 = line.find("</");
+  void text(const char *s, size_t len) {
 
-      name = string(line, aux + 1, aux2 - aux - 1);
+    if (capture) {
+      text_buf.append(s, len);
+      return;
     }
 
-    // Get its type
-    if (line.find("<metricsTypes>") != string::npos)
-      parse_metrics_types(open_sections + 1, (acc + "/" + name), folders);
+    // The kind of the metrics port is the value that follows this key
+    if (in_root && !sections.empty() && sections.back().is_port
+        && string(s, len).find("metrics_port_kind") != string::npos)
+      expect_kind = true;
+  }
+};
 
-    // Get name of the folder
-    if (line.find("metrics_port_kind") != string::npos && kind.empty()) {
-      getline(vplan_xml, line);
+/**
+ * @brief Hashes a file with 64-bit FNV-1a
+ * @param file Path to the file
+ * @param hash Result
+ * @return 0 on success
+ */
+static int hash_file(const string &file, uint64_t &hash) {
 
-      aux = line.find('>');
-      aux2 = line.find("</");
+  ifstream in(file, ifstream::in | ifstream::binary);
 
-      kind = string(line, aux + 1, aux2 - aux - 1);
+  if (!in.good())
+    return -1;
 
-      for (int i = 0; i < open_sections; ++i)
-        debug_log << "\t";
+  vector<char> buf(XML_READ_CHUNK);
 
-      debug_log << kind << ": " << name << "\n";
-    }
+  hash = 14695981039346656037ULL;
 
-    if (line.find("</metricsPort>") != string::npos) {
-      break;
+  while (in) {
+    in.read(buf.data(), buf.size());
+
+    for (std::streamsize i = 0; i < in.gcount(); ++i) {
+      hash ^= (unsigned char) buf[i];
+      hash *= 1099511628211ULL;
     }
   }
+
+  return 0;
 }
 
 /**
- * @brief Parses a <section> tag while building a path
- * @param open_sections Current recursivity level
- * @param acc Current accumulated path
- * @param folders Where we'll add a valid folder
+ * @brief Path of the cache file for a plan hash
  */
-void parse_section(int &open_sections, const string &acc, unordered_map<string, char> &folders) {
-  string line;
+static string cache_path(const string &cache_dir, uint64_t hash) {
+  char name[32];
 
-  size_t aux, aux2;
-  string name;
+  snprintf(name, sizeof(name), "vplan_%016llx.cache", (unsigned long long) hash);
 
-  while (1) {
-    getline(vplan_xml, line);
+  return cache_dir + "/" + name;
+}
 
-    if (line.find("<name") != string::npos && name.empty()) {
-      aux = line.find('>');
-      aux2 = line.find("</");
+/**
+ * @brief Loads the folder map of a plan from the cache
+ * @return 0 on success, -1 if there is no usable cache entry
+ */
+static int load_cache(const string &file, uint64_t hash, unordered_map<string, char> &folders) {
 
-      name = string(line, aux + 1, aux2 - aux - 1);
+  ifstream in(file, ifstream::in | ifstream::binary);
 
-      for (int i = 0; i < open_sections; ++i)
-        debug_log << "\t";
-      debug_log << "Folder: " << name << "\n";
-    }
+  if (!in.good())
+    return -1;
 
-    // Start searching for a code coverage folder
-    if (line.find("<metricsPort ") != string::npos)
-      parse_metrics_port(open_sections + 1, acc + "/" + name, folders);
+  char magic[sizeof(cache_magic)];
+  uint64_t stored_hash;
+  uint32_t count;
 
-    if (line.find("<section ") != string::npos)
-      parse_section(++open_sections, acc + "/" + name, folders);
+  in.read(magic, sizeof(magic));
+  in.read((char *) &stored_hash, sizeof(stored_hash));
+  in.read((char *) &count, sizeof(count));
 
-    if (line.find("</section>") != string::npos) {
-      open_sections--;
-      break;
-    }
+  if (!in || memcmp(magic, cache_magic, sizeof(magic)) || stored_hash != hash)
+    return -1;
+
+  unordered_map<string, char> loaded;
+  loaded.reserve(count);
+
+  for (uint32_t i = 0; i < count; ++i) {
+    uint32_t len;
+    char type;
+
+    in.read((char *) &len, sizeof(len));
+
+    string folder(len, '\0');
+
+    in.read(&folder[0], len);
+    in.get(type);
+
+    if (!in)
+      return -1;
+
+    loaded[folder] = type;
+  }
+
+  folders.insert(loaded.begin(), loaded.end());
+
+  return 0;
+}
+
+/**
+ * @brief Stores the folder map of a plan in the cache
+ */
+static void store_cache(const string &file, uint64_t hash,
+    const unordered_map<string, char> &folders) {
+
+  ofstream out(file, ofstream::out | ofstream::binary);
+
+  if (!out.good()) {
+    cerr << "Could not write vplan cache " << file << "!\n";
+    return;
+  }
+
+  uint32_t count = folders.size();
+
+  out.write(cache_magic, sizeof(cache_magic));
+  out.write((const char *) &hash, sizeof(hash));
+  out.write((const char *) &count, sizeof(count));
+
+  for (auto &x : folders) {
+    uint32_t len = x.first.size();
+
+    out.write((const char *) &len, sizeof(len));
+    out.write(x.first.data(), len);
+    out.put(x.second);
   }
 }
 
@@ -173,8 +303,10 @@ static void pretty_print_type(unordered_map<string, char> &folders) {
  * @param folders Where we'll add a valid folder
  * @param debug Generate debug file
  * @param silent Don't generate console output
+ * @param cache_dir Where to keep the parsed folder maps (empty to disable)
  */
-int plan_parser_main(string vplan, unordered_map<string, char> &folders, bool debug, bool silent) {
+int plan_parser_main(string vplan, unordered_map<string, char> &folders, bool debug, bool silent,
+    const string &cache_dir) {
 
   debug_switch = debug;
 
@@ -192,42 +324,50 @@ int plan_parser_main(string vplan, unordered_map<string, char> &folders, bool de
   if (debug_switch)
     debug_log.open("vplan_debug.log");
 
-  // Dearchivate vplan
-  string to_xml("/bin/zcat " + vplan + " > amiq_vplan_parser.xml");
+  // Try the cache first
+  uint64_t hash = 0;
+  bool use_cache = !cache_dir.empty() && !hash_file(vplan, hash);
 
-  system(to_xml.c_str());
+  if (use_cache && !load_cache(cache_path(cache_dir, hash), hash, folders)) {
+    debug_log << "Loaded from cache " << cache_path(cache_dir, hash) << "\n";
+    pretty_print_type(folders);
 
-  vplan_xml.open("amiq_vplan_parser.xml", ifstream::in);
+    if (!silent)
+      cout << "Vplan parser finished successfully!\n";
 
-  if (!vplan_xml.good()) {
+    return 0;
+  }
+
+  // Dearchivate vplan and parse it as it comes out of the pipe
+  string to_xml("/bin/zcat '" + vplan + "'");
+
+  FILE *vplan_xml = popen(to_xml.c_str(), "r");
+
+  if (vplan_xml == NULL) {
     cerr << "Could not create xml vplan!\n";
     return -1;
   }
 
-  // Skip meta data
-  string line;
-  getline(vplan_xml, line);
+  unordered_map<string, char> parsed;
+  plan_handler handler(parsed);
+  xml_tokenizer tok(handler);
 
-  while (line.find("rootElements") == string::npos)
-    getline(vplan_xml, line);
+  uint64_t nof_bytes = xml_feed_file(vplan_xml, tok);
 
-  // Parse vplan
-  while (line.find("/rootElements") == string::npos) {
+  if (pclose(vplan_xml) != 0 || !nof_bytes) {
+    cerr << "Could not create xml vplan!\n";
+    return -1;
+  }
 
-    while (line.find("<section ") == string::npos)
-      getline(vplan_xml, line);
+  debug_log << "Parsed " << nof_bytes << " bytes\n";
 
-    int open = 1;
-    parse_section(open, "", folders);
+  if (use_cache)
+    store_cache(cache_path(cache_dir, hash), hash, parsed);
 
-    getline(vplan_xml, line);
-  }
+  folders.insert(parsed.begin(), parsed.end());
 
   pretty_print_type(folders);
 
-  // Delete dearchivated file
-  system("/bin/rm amiq_vplan_parser.xml");
-
   if (!silent)
   cout << "Vplan parser finished successfully!\n";
 
@@ -0,0 +1,433 @@
+/******************************************************************************
+ * (C) Copyright 2017 AMIQ Consulting
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *******************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include "xml_tokenizer.hpp"
+
+// Longest entity we try to decode (e.g. "&#x10FFFF;")
+#define XML_MAX_ENTITY 10
+
+static inline bool is_ws(char c) {
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+/*
+ * @brief Appends a code point to out, UTF-8 encoded
+ */
+static void append_utf8(string &out, unsigned long cp) {
+  if (cp < 0x80) {
+    out.push_back((char) cp);
+  } else if (cp < 0x800) {
+    out.push_back((char) (0xC0 | (cp >> 6)));
+    out.push_back((char) (0x80 | (cp & 0x3F)));
+  } else if (cp < 0x10000) {
+    out.push_back((char) (0xE0 | (cp >> 12)));
+    out.push_back((char) (0x80 | ((cp >> 6) & 0x3F)));
+    out.push_back((char) (0x80 | (cp & 0x3F)));
+  } else {
+    out.push_back((char) (0xF0 | (cp >> 18)));
+    out.push_back((char) (0x80 | ((cp >> 12) & 0x3F)));
+    out.push_back((char) (0x80 | ((cp >> 6) & 0x3F)));
+    out.push_back((char) (0x80 | (cp & 0x3F)));
+  }
+}
+
+/*
+ * @brief Drops all state, the tokenizer can be reused for a new document
+ */
+void xml_tokenizer::reset() {
+  state = XS_TEXT;
+  entity_ret = XS_TEXT;
+  quote = '"';
+
+  name.clear();
+  entity.clear();
+  text_buf.clear();
+  bang.clear();
+
+  attrs.count = 0;
+  nof_bytes = 0;
+  nof_lines = 0;
+  stopped = false;
+}
+
+/*
+ * @brief Hands the accumulated text to the handler
+ */
+void xml_tokenizer::flush_text() {
+  if (text_buf.empty())
+    return;
+
+  handler->text(text_buf.data(), text_buf.size());
+  text_buf.clear();
+}
+
+/*
+ * @brief Decodes the entity accumulated so far (without '&' and ';') into out.
+ * @brief Unknown entities are copied as they are.
+ */
+void xml_tokenizer::decode_entity(string &out) {
+
+  if (entity == "lt")
+    out.push_back('<');
+  else if (entity == "gt")
+    out.push_back('>');
+  else if (entity == "amp")
+    out.push_back('&');
+  else if (entity == "quot")
+    out.push_back('"');
+  else if (entity == "apos")
+    out.push_back('\'');
+  else if (entity.size() > 1 && entity[0] == '#') {
+    char *end;
+    unsigned long cp;
+
+    if (entity[1] == 'x' || entity[1] == 'X')
+      cp = strtoul(entity.c_str() + 2, &end, 16);
+    else
+      cp = strtoul(entity.c_str() + 1, &end, 10);
+
+    if (*end == '\0' && cp <= 0x10FFFF)
+      append_utf8(out, cp);
+    else
+      out += "&" + entity + ";";
+  } else {
+    out += "&" + entity + ";";
+  }
+
+  entity.clear();
+}
+
+/*
+ * @brief Signals the start (and the end, for <x/>) of the current element
+ */
+void xml_tokenizer::emit_start(bool empty) {
+
+  handler->start_element(name, attrs);
+
+  if (empty)
+    handler->end_element(name);
+
+  attrs.count = 0;
+}
+
+/*
+ * @brief Advances the state machine with one char
+ */
+void xml_tokenizer::step(char c) {
+
+  switch (state) {
+  case XS_TEXT:
+    if (c == '<') {
+      flush_text();
+      state = XS_LT;
+    } else if (c == '&') {
+      entity_ret = XS_TEXT;
+      state = XS_ENTITY;
+    } else {
+      text_buf.push_back(c);
+
+      if (text_buf.size() >= XML_TEXT_CHUNK)
+        flush_text();
+    }
+    break;
+  case XS_ENTITY: {
+    string &out = (entity_ret == XS_TEXT) ? text_buf : attrs.last_value();
+
+    if (c == ';') {
+      decode_entity(out);
+      state = entity_ret;
+    } else if (entity.size() >= XML_MAX_ENTITY || c == '<' || c == '&' || c == quote) {
+      // Not an entity after all: keep the text and reparse the char
+      out += "&" + entity;
+      entity.clear();
+      state = entity_ret;
+      step(c);
+    } else {
+      entity.push_back(c);
+    }
+    break;
+  }
+  case XS_LT:
+    name.clear();
+
+    if (c == '/') {
+      state = XS_END_NAME;
+    } else if (c == '!') {
+      bang.clear();
+      state = XS_BANG;
+    } else if (c == '?') {
+      bang.clear();
+      state = XS_PI;
+    } else {
+      name.push_back(c);
+      attrs.count = 0;
+      state = XS_START_NAME;
+    }
+    break;
+  case XS_START_NAME:
+    if (is_ws(c)) {
+      state = XS_IN_TAG;
+    } else if (c == '>') {
+      emit_start(false);
+      state = XS_TEXT;
+    } else if (c == '/') {
+      state = XS_EMPTY_CLOSE;
+    } else {
+      name.push_back(c);
+    }
+    break;
+  case XS_IN_TAG:
+    if (c == '>') {
+      emit_start(false);
+      state = XS_TEXT;
+    } else if (c == '/') {
+      state = XS_EMPTY_CLOSE;
+    } else if (!is_ws(c)) {
+      attrs.add().push_back(c);
+      state = XS_ATTR_NAME;
+    }
+    break;
+  case XS_ATTR_NAME:
+    if (c == '=') {
+      state = XS_ATTR_QUOTE;
+    } else if (is_ws(c)) {
+      state = XS_ATTR_EQ;
+    } else if (c == '>' || c == '/') {
+      // Attribute without a value
+      state = XS_IN_TAG;
+      step(c);
+    } else {
+      attrs.slots[attrs.count - 1].first.push_back(c);
+    }
+    break;
+  case XS_ATTR_EQ:
+    if (c == '=') {
+      state = XS_ATTR_QUOTE;
+    } else if (!is_ws(c)) {
+      state = XS_IN_TAG;
+      step(c);
+    }
+    break;
+  case XS_ATTR_QUOTE:
+    if (c == '"' || c == '\'') {
+      quote = c;
+      state = XS_ATTR_VALUE;
+    } else if (!is_ws(c)) {
+      // Unquoted value, read it until the next whitespace
+      quote = ' ';
+      attrs.last_value().push_back(c);
+      state = XS_ATTR_VALUE;
+    }
+    break;
+  case XS_ATTR_VALUE:
+    if (c == quote || (quote == ' ' && (is_ws(c) || c == '>'))) {
+      state = XS_IN_TAG;
+      if (c == '>')
+        step(c);
+    } else if (c == '&') {
+      entity_ret = XS_ATTR_VALUE;
+      state = XS_ENTITY;
+    } else {
+      attrs.last_value().push_back(c);
+    }
+    break;
+  case XS_EMPTY_CLOSE:
+    if (c == '>') {
+      emit_start(true);
+      state = XS_TEXT;
+    } else if (!is_ws(c)) {
+      state = XS_IN_TAG;
+      step(c);
+    }
+    break;
+  case XS_END_NAME:
+    if (c == '>') {
+      handler->end_element(name);
+      state = XS_TEXT;
+    } else if (is_ws(c)) {
+      state = XS_END_TAIL;
+    } else {
+      name.push_back(c);
+    }
+    break;
+  case XS_END_TAIL:
+    if (c == '>') {
+      handler->end_element(name);
+      state = XS_TEXT;
+    }
+    break;
+  case XS_BANG:
+    bang.push_back(c);
+
+    if (bang == "--") {
+      bang.clear();
+      state = XS_COMMENT;
+    } else if (bang == "[CDATA[") {
+      bang.clear();
+      state = XS_CDATA;
+    } else if (string("--").compare(0, bang.size(), bang) && string("[CDATA[").compare(0,
+        bang.size(), bang)) {
+      // <!DOCTYPE ...> or similar: skip it
+      state = XS_DECL;
+      step(c);
+    }
+    break;
+  case XS_COMMENT:
+    // Keep only the last 2 chars to spot "-->"
+    if (c == '>' && bang == "--") {
+      state = XS_TEXT;
+    } else {
+      bang.push_back(c);
+      if (bang.size() > 2)
+        bang.erase(0, 1);
+    }
+    break;
+  case XS_CDATA:
+    if (c == '>' && bang == "]]") {
+      text_buf.erase(text_buf.size() - 2);
+      flush_text();
+      bang.clear();
+      state = XS_TEXT;
+    } else {
+      text_buf.push_back(c);
+      bang.push_back(c);
+      if (bang.size() > 2)
+        bang.erase(0, 1);
+
+      // Keep the last two chars in case they close the section
+      if (text_buf.size() >= XML_TEXT_CHUNK) {
+        handler->text(text_buf.data(), text_buf.size() - 2);
+        text_buf.erase(0, text_buf.size() - 2);
+      }
+    }
+    break;
+  case XS_DECL:
+    if (c == '>')
+      state = XS_TEXT;
+    break;
+  case XS_PI:
+    if (c == '>' && bang == "?")
+      state = XS_TEXT;
+    bang = c;
+    break;
+  default:
+    break;
+  }
+}
+
+/*
+ * @brief Parses the next block of input
+ * @param buf Input bytes
+ * @param len Number of bytes in buf
+ */
+void xml_tokenizer::feed(const char *buf, size_t len) {
+
+  const char *end = buf + len;
+
+  while (buf < end && !stopped) {
+
+    // Fast path: copy plain text in one go
+    if (state == XS_TEXT) {
+      const char *p = buf;
+
+      while (p < end && *p != '<' && *p != '&') {
+        if (*p == '\n')
+          nof_lines++;
+        p++;
+      }
+
+      while (buf < p) {
+        size_t n = std::min((size_t) (p - buf), (size_t) XML_TEXT_CHUNK - text_buf.size());
+        text_buf.append(buf, n);
+        buf += n;
+        nof_bytes += n;
+
+        if (text_buf.size() >= XML_TEXT_CHUNK)
+          flush_text();
+      }
+
+      if (buf == end)
+        break;
+    }
+
+    if (*buf == '\n')
+      nof_lines++;
+
+    step(*buf++);
+    nof_bytes++;
+  }
+}
+
+/*
+ * @brief Flushes pending text at the end of the input
+ */
+void xml_tokenizer::finish() {
+  if (state == XS_TEXT)
+    flush_text();
+}
+
+/*
+ * @brief Feeds a whole stream to the tokenizer through a fixed size buffer
+ * @param in Input stream
+ * @param tok Tokenizer
+ * @return Number of bytes read
+ */
+uint64_t xml_feed_stream(std::istream &in, xml_tokenizer &tok) {
+
+  vector<char> buf(XML_READ_CHUNK);
+  uint64_t total = 0;
+
+  while (in && !tok.is_stopped()) {
+    in.read(buf.data(), buf.size());
+
+    std::streamsize n = in.gcount();
+
+    if (n <= 0)
+      break;
+
+    tok.feed(buf.data(), n);
+    total += n;
+  }
+
+  tok.finish();
+
+  return total;
+}
+
+/*
+ * @brief Same as above, for a C stream (e.g. a pipe)
+ */
+uint64_t xml_feed_file(FILE *in, xml_tokenizer &tok) {
+
+  vector<char> buf(XML_READ_CHUNK);
+  uint64_t total = 0;
+  size_t n;
+
+  while (!tok.is_stopped() && (n = fread(buf.data(), 1, buf.size(), in)) > 0) {
+    tok.feed(buf.data(), n);
+    total += n;
+  }
+
+  tok.finish();
+
+  return total;
+}
@@ -15,6 +15,8 @@
  *
  *******************************************************************************/
 
+#include <stdlib.h>
+
 #include <vector>
 #include <map>
 #include <string>
@@ -27,7 +29,13 @@ static ofstream debug_log;
 static map<string, string> opt = { { "users", "u" }, { "plan", "p" }, { "refinement", "r" }, {
     "strict-comment", "sc" }, { "weak-comment", "wc" }, { "file", "f" }, { "database", "d" }, {
     "mail", "m" }, { "verbose", "v" }, { "check-file", "c" }, { "output", "o" }, { "list", "l" }, {
-    "testname", "t" }, { "quiet", "q" }, { "negate", "n" }, {"coverage", "g"} };
+    "testname", "t" }, { "quiet", "q" }, { "negate", "n" }, {"coverage", "g"}, {
+    "plan-cache", "P" }, { "incremental", "I" }, {
+    "summary", "S" }, { "diff-against", "D" }, {
+    "checker", "C" }, { "rule", "R" }, { "jobs", "j" }, {
+    "compress", "z" }, { "cross-holes", "X" }, { "asserts", "A" }, {
+    "rank", "K" }, { "attribution", "T" }, {
+    "first-hit", "F" }, { "instances", "U" } };
 
 inline void semantic_err(const string &msg) {
   cerr << "*CL_ERR: Semantic error! ===> " << msg << "\n";
@@ -112,6 +120,20 @@ int check_option(const string &option) {
   case 't':
   case 'q':
   case 'n':
+  case 'P':
+  case 'I':
+  case 'S':
+  case 'D':
+  case 'C':
+  case 'R':
+  case 'j':
+  case 'z':
+  case 'X':
+  case 'A':
+  case 'K':
+  case 'T':
+  case 'F':
+  case 'U':
     if (option.size() > 2)  // Needs to be just a char
       ret = 2;
     break;
@@ -226,10 +248,15 @@ int parse_option(vector<string> &argv, int &pos, vector<vector<string> > &info)
   case 'o':
   case 't':
   case 'p':
+  case 'P':
+  case 'I':
+  case 'D':
+  case 'C':
+  case 'j':
     ret = get_one_arg(arg_return, argv, pos);
-    info[argv[pos - 1][1] - 'a'].push_back(arg_return);
+    info[arg_slot(argv[pos - 1][1])].push_back(arg_return);
 
-    if (info[argv[pos - 1][1] - 'a'].size() > 1) {
+    if (info[arg_slot(argv[pos - 1][1])].size() > 1) {
       syntax_err("Specify \"" + argv[pos - 2] + "\" only once!");
       ret = 3;
     }
@@ -243,7 +270,7 @@ int parse_option(vector<string> &argv, int &pos, vector<vector<string> > &info)
     break;
   case 'g':
     // Functional coverage option
-    ret = get_multiple_args(info[argv[pos][1] - 'a'], argv, pos);
+    ret = get_multiple_args(info[arg_slot(argv[pos][1])], argv, pos);
     num_args = info['g' - 'a'].size();
     
     if (num_args > 3) {
@@ -251,7 +278,8 @@ int parse_option(vector<string> &argv, int &pos, vector<vector<string> > &info)
       ret = 3;
     } else {
       // no other arguments needed
-      if (info['g' - 'a'][0] == "nof_cvps" || info['g' - 'a'][0] == "nof_cvgs") {
+      if (info['g' - 'a'][0] == "nof_cvps" || info['g' - 'a'][0] == "nof_cvgs"
+          || info['g' - 'a'][0] == "scores") {
         found = true;
 
         if (num_args > 1) {
@@ -304,8 +332,9 @@ int parse_option(vector<string> &argv, int &pos, vector<vector<string> > &info)
   case 'u':
   case 'm':
   case 'c':
+  case 'R':
 
-    ret = get_multiple_args(info[argv[pos][1] - 'a'], argv, pos);
+    ret = get_multiple_args(info[arg_slot(argv[pos][1])], argv, pos);
     pos++;
 
     break;
@@ -334,31 +363,39 @@ int parse_option(vector<string> &argv, int &pos, vector<vector<string> > &info)
   case 'v':
   case 'q':
   case 'n':
+  case 'z':
+  case 'T':
+  case 'F':
+  case 'U':
     if (pos < argv.size() - 1 && argv[pos + 1][0] != '-') {
       syntax_err(argv[pos] + " doesn't take args!");
       return 2;
     }
 
-    info[argv[pos][1] - 'a'].push_back("1");
+    info[arg_slot(argv[pos][1])].push_back("1");
 
     pos++;
     break;
     // Optional arguments options
   case 'l':
+  case 'S':
+  case 'X':
+  case 'A':
+  case 'K':
 
     if (pos == argv.size() - 1) {
-      info[argv[pos][1] - 'a'].push_back("");
+      info[arg_slot(argv[pos][1])].push_back("");
       pos++;
       break;
     }
 
     if (argv[pos + 1][0] == '-') {
-      info[argv[pos][1] - 'a'].push_back("");
+      info[arg_slot(argv[pos][1])].push_back("");
       pos++;
       break;
     }
 
-    ret = get_multiple_args(info[argv[pos][1] - 'a'], argv, pos);
+    ret = get_multiple_args(info[arg_slot(argv[pos][1])], argv, pos);
     pos++;
 
     break;
@@ -379,11 +416,11 @@ int parse_option(vector<string> &argv, int &pos, vector<vector<string> > &info)
  * @param info: arguments for each opt
  */
 void print_args(vector<vector<string> > &info) {
-  for (int i = 0; i < 26; ++i) {
+  for (int i = 0; i < ARG_SLOTS; ++i) {
     if (!info[i].size())
       continue;
 
-    debug_log << static_cast<char>(i + 'a') << ": ";
+    debug_log << static_cast<char>(i < 26 ? i + 'a' : i - 26 + 'A') << ": ";
     for (int j = 0; j < info[i].size(); ++j)
       debug_log << "[" << info[i][j] << "] ";
 
@@ -428,7 +465,9 @@ int arg_main(int argc, char** argv, vector<vector<string> > &infos) {
   }
 
   if (infos['l' - 'a'].empty())
-    if (infos['r' - 'a'].empty() && infos['c' - 'a'].empty() && infos['g' - 'a'].empty()) {
+    if (infos['r' - 'a'].empty() && infos['c' - 'a'].empty() && infos['g' - 'a'].empty()
+        && infos[arg_slot('X')].empty() && infos[arg_slot('A')].empty()
+        && infos[arg_slot('K')].empty()) {
       semantic_err("No code specified!");
       return 3;
     }
@@ -438,13 +477,56 @@ int arg_main(int argc, char** argv, vector<vector<string> > &infos) {
     return 3;
   }
 
+  if (!infos[arg_slot('T')].empty() && !infos[arg_slot('I')].empty()) {
+    semantic_err("Can't attribute hits to tests in incremental mode!");
+    return 3;
+  }
+
+  if (!infos[arg_slot('U')].empty() && !infos[arg_slot('I')].empty()) {
+    semantic_err("Can't list design unit hits per instance in incremental mode!");
+    return 3;
+  }
+
+  // Rank and first hit only write their own list: report options would be ignored
+  for (char mode : { 'K', 'F' })
+    for (char report : { 'T', 'U', 'I', 'S', 'D' })
+      if (!infos[arg_slot(mode)].empty() && !infos[arg_slot(report)].empty()) {
+        semantic_err(string("Can't use -") + report + " together with -" + mode + "!");
+        return 3;
+      }
+
 #ifdef NCSIM
   if (!infos['r' - 'a'].empty() && infos['p' - 'a'].empty()) {
       semantic_err("Can't specify a refinement without a vPlan!");
       return 3;
     }
+
+  // Items of design units are found in their definition, not in each instance
+  if (!infos[arg_slot('U')].empty()) {
+    semantic_err("Can't list design unit hits per instance for NCSIM!");
+    return 3;
+  }
 #endif
 
+  if (!infos[arg_slot('P')].empty() && infos['p' - 'a'].empty()) {
+    semantic_err("Can't specify a plan cache without a vPlan!");
+    return 3;
+  }
+
+  if (!infos[arg_slot('S')].empty()) {
+    const vector<string> &summary = infos[arg_slot('S')];
+
+    if (summary.size() > 1 || (!summary[0].empty() && summary[0] != "rows")) {
+      syntax_err("The only argument of --summary is \"rows\"!");
+      return 2;
+    }
+  }
+
+  if (!infos['j' - 'a'].empty() && atoi(infos['j' - 'a'][0].c_str()) < 1) {
+    semantic_err("The number of jobs must be a positive number!");
+    return 3;
+  }
+
   // This checks that you're not using strict comment filtering with weak filtering
   if (!infos['s' - 'a'].empty() && !infos['w' - 'a'].empty()) {
     semantic_err("Can't enable both comment flags at once!");
@@ -0,0 +1,229 @@
+/******************************************************************************
+ * (C) Copyright 2017 AMIQ Consulting
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *******************************************************************************/
+
+#include <iostream>
+
+#include "assert_census.hpp"
+#include "ucis_callbacks.hpp"
+#include "formatter.hpp"
+
+using std::cout;
+using std::cerr;
+
+/*
+ * @brief Key of the assertion counter held by a cover item type, 0 for other types.
+ * @brief Counters are checked under <assertion>/a/<key>/ (see cl_check -t assert).
+ */
+char assert_counter_key(ucisCoverTypeT type) {
+
+  switch (type) {
+  case UCIS_ASSERTBIN:
+    return 'f';
+  case UCIS_PASSBIN:
+    return 'p';
+  case UCIS_VACUOUSBIN:
+    return 'v';
+  case UCIS_DISABLEDBIN:
+    return 'd';
+  case UCIS_ATTEMPTBIN:
+    return 'n';
+  default:
+    return 0;
+  }
+}
+
+/*
+ * @brief Key of an assertion counter given by name (fails, passes, vacuous,
+ * @brief disabled, attempts), 0 if there is none
+ */
+char assert_counter_key(const string &name) {
+
+  if (name == "fails")
+    return assert_counter_key(UCIS_ASSERTBIN);
+  else if (name == "passes")
+    return assert_counter_key(UCIS_PASSBIN);
+  else if (name == "vacuous")
+    return assert_counter_key(UCIS_VACUOUSBIN);
+  else if (name == "disabled")
+    return assert_counter_key(UCIS_DISABLEDBIN);
+  else if (name == "attempts")
+    return assert_counter_key(UCIS_ATTEMPTBIN);
+
+  return 0;
+}
+
+/*
+ * @brief Name of an assertion counter given by key, NULL if there is none
+ */
+const char *assert_counter_name(char key) {
+  const char *names[] = { "fails", "passes", "vacuous", "disabled", "attempts" };
+
+  for (int i = 0; i < 5; ++i)
+    if (assert_counter_key(names[i]) == key)
+      return names[i];
+
+  return NULL;
+}
+
+/*
+ * @brief Status of an assertion: "failed", "never" (attempted), "vacuous" (only
+ * @brief vacuous passes) or "passed"
+ */
+const char *assert_status(const assert_stats_t &a) {
+
+  if (a.fails)
+    return "failed";
+
+  if (!a.passes && !a.vacuous && !a.attempts)
+    return "never";
+
+  if (!a.passes && a.vacuous)
+    return "vacuous";
+
+  return "passed";
+}
+
+/*
+ * @brief Adds the count of a cover item to its assertion
+ * @param name Hierarchical name of the assertion
+ * @param type Cover item type, one of the assertion bins
+ * @param count Count of the item
+ */
+void assert_census::add(const string &name, ucisCoverTypeT type, int64_t count) {
+
+  if (last == UINT32_MAX || rows[last].name != name) {
+    auto it = ids.find(name);
+
+    if (it != ids.end()) {
+      last = it->second;
+    } else {
+      assert_stats_t a = { name, 0, 0, 0, 0, 0 };
+
+      last = rows.size();
+      ids[name] = last;
+      rows.push_back(a);
+    }
+  }
+
+  assert_stats_t &a = rows[last];
+
+  switch (type) {
+  case UCIS_ASSERTBIN:
+    a.fails += count;
+    break;
+  case UCIS_PASSBIN:
+    a.passes += count;
+    break;
+  case UCIS_VACUOUSBIN:
+    a.vacuous += count;
+    break;
+  case UCIS_DISABLEDBIN:
+    a.disabled += count;
+    break;
+  case UCIS_ATTEMPTBIN:
+    a.attempts += count;
+    break;
+  default:
+    break;
+  }
+}
+
+/*
+ * @brief True if the filter is a status rather than a name substring
+ */
+static bool is_status(const string &filter) {
+  return filter == "failed" || filter == "never" || filter == "vacuous" || filter == "passed";
+}
+
+/*
+ * @brief Collects the counts of every assertion over all UCISDBs and lists
+ * @brief the ones that have one of the statuses and one of the name substrings
+ * @brief given as filters (any, if none of a kind is given).
+ * @param dbs Paths to the UCISDBs
+ * @param filters Statuses (see assert_status) and name substrings
+ * @param file Where the assertions are listed
+ * @return 0 on success
+ */
+int census_main(const vector<string> &dbs, const vector<string> &filters, const string &file) {
+
+  assert_census census;
+  census_scan_t scan;
+
+  scan.census = &census;
+
+  for (int i = 0; i < dbs.size(); ++i) {
+    cout << "UCISDB #" << i << " @" << dbs[i] << "\n";
+
+    scan.du.underneath = 0;
+    scan.du.subscope_counter = 0;
+
+    iterate_db(dbs[i], census_callback, (void *) &scan);
+  }
+
+  vector<string> statuses, names;
+
+  for (auto &f : filters)
+    (is_status(f) ? statuses : names).push_back(f);
+
+  out_file table(file);
+
+  if (!table.is_open()) {
+    cerr << "*CL_ERR: Could not write " << file << "!\n";
+    return 1;
+  }
+
+  out_buffer out(&table);
+  size_t nof_failed = 0, nof_never = 0, nof_vacuous = 0, nof_listed = 0;
+
+  out.put("status\tfails\tpasses\tvacuous\tdisabled\tattempts\tname\n");
+
+  for (auto &a : census.list()) {
+    const char *status = assert_status(a);
+    bool listed = statuses.empty() && names.empty();
+
+    nof_failed += status[0] == 'f';
+    nof_never += status[0] == 'n';
+    nof_vacuous += status[0] == 'v';
+
+    if (!listed) {
+      bool status_ok = statuses.empty(), name_ok = names.empty();
+
+      for (auto &s : statuses)
+        status_ok |= s == status;
+
+      for (auto &n : names)
+        name_ok |= a.name.find(n) != string::npos;
+
+      listed = status_ok && name_ok;
+    }
+
+    if (!listed)
+      continue;
+
+    out.put(status).put('\t').put_int(a.fails).put('\t').put_int(a.passes).put('\t');
+    out.put_int(a.vacuous).put('\t').put_int(a.disabled).put('\t').put_int(a.attempts).put('\t');
+    out.put(a.name).put('\n');
+
+    nof_listed++;
+  }
+
+  cout << "Assertions: " << census.list().size() << ", failed: " << nof_failed
+      << ", never attempted: " << nof_never << ", only vacuous passes: " << nof_vacuous << "\n";
+  cout << nof_listed << " assertions are listed in " << file << "\n";
+
+  return 0;
+}
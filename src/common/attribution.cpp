@@ -0,0 +1,111 @@
+/******************************************************************************
+ * (C) Copyright 2017 AMIQ Consulting
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *******************************************************************************/
+
+#include <algorithm>
+#include <iterator>
+
+#include "attribution.hpp"
+
+uint32_t test_attribution::id(const string &name) {
+
+  auto ins = ids.insert(make_pair(name, (uint32_t) names.size()));
+
+  if (ins.second)
+    names.push_back(name);
+
+  return ins.first->second;
+}
+
+uint32_t test_attribution::node_id(ucisT db, ucisHistoryNodeT node) {
+
+  auto it = nodes.find(node);
+
+  if (it != nodes.end())
+    return it->second;
+
+  const char *name = ucis_GetStringProperty(db, node, -1, UCIS_STR_TEST_NAME);
+  uint32_t n = id(name && name[0] ? string(name) : db_file);
+
+  nodes[node] = n;
+
+  return n;
+}
+
+/*
+ * @brief Tests that hit a bin, as sorted numbers
+ */
+const vector<uint32_t> &test_attribution::bin_tests(ucisT db, ucisScopeT scope, int coverindex) {
+
+  bin.clear();
+
+  ucisHistoryNodeListT list = ucis_GetHistoryNodeListAssoc(db, scope, coverindex,
+      UCIS_ASSOC_TESTHIT);
+
+  if (list) {
+    ucisIteratorT it = ucis_HistoryNodeListIterate(db, list);
+
+    if (it) {
+      for (ucisHistoryNodeT node; (node = ucis_HistoryScan(db, it)) != NULL;)
+        bin.push_back(node_id(db, node));
+
+      ucis_FreeIterator(db, it);
+    }
+  }
+
+  if (!bin.empty()) {
+    std::sort(bin.begin(), bin.end());
+    bin.erase(std::unique(bin.begin(), bin.end()), bin.end());
+
+    return bin;
+  }
+
+  // No test data on the bin: it comes from the tests of the UCISDB
+  if (db_tests.empty()) {
+    ucisIteratorT it = ucis_HistoryIterate(db, NULL, UCIS_HISTORYNODE_TEST);
+
+    if (it) {
+      for (ucisHistoryNodeT node; (node = ucis_HistoryScan(db, it)) != NULL;)
+        db_tests.push_back(node_id(db, node));
+
+      ucis_FreeIterator(db, it);
+    }
+
+    if (db_tests.empty())
+      db_tests.push_back(id(db_file));
+
+    std::sort(db_tests.begin(), db_tests.end());
+    db_tests.erase(std::unique(db_tests.begin(), db_tests.end()), db_tests.end());
+  }
+
+  return db_tests;
+}
+
+/*
+ * @brief Adds tests to the sorted list of a check
+ */
+void merge_tests(vector<uint32_t> &tests, const vector<uint32_t> &add) {
+
+  // Mostly the same tests again
+  if (std::includes(tests.begin(), tests.end(), add.begin(), add.end()))
+    return;
+
+  vector<uint32_t> merged;
+
+  merged.reserve(tests.size() + add.size());
+  std::set_union(tests.begin(), tests.end(), add.begin(), add.end(), std::back_inserter(merged));
+  tests.swap(merged);
+}
@@ -0,0 +1,220 @@
+/******************************************************************************
+ * (C) Copyright 2017 AMIQ Consulting
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *******************************************************************************/
+
+#include <dlfcn.h>
+#include <string.h>
+
+#include <iostream>
+
+#include "batch_checker.hpp"
+
+using std::cerr;
+
+/*
+ * @brief Default policy: items must be found and hit, assertions must never fire
+ */
+static void default_check_batch(const cl_leaf_t *leaves, size_t n, uint8_t *status) {
+
+  for (size_t i = 0; i < n; ++i) {
+    const cl_leaf_t &l = leaves[i];
+
+    if (!l.found)
+      status[i] = CL_STATUS_MISSING;
+    else if (strcmp(l.type, "Assertbin"))
+      status[i] = l.hit_count == 0 ? CL_STATUS_FAIL : CL_STATUS_DEFAULT;
+    else
+      status[i] = l.hit_count > 0 ? CL_STATUS_FAIL : CL_STATUS_DEFAULT;
+  }
+}
+
+batch_checker::batch_checker(checker f) :
+    f(f), batch(default_check_batch), lib(NULL), rules(NULL) {
+  names.push_back("default");
+  names.push_back("fail");
+  names.push_back("missing");
+}
+
+batch_checker::~batch_checker() {
+  if (lib)
+    dlclose(lib);
+}
+
+/*
+ * @brief Uses the checker exported by a plugin instead
+ * @param path Shared library (see cl_checker.h)
+ * @return 0 on success
+ */
+int batch_checker::load(const string &path) {
+
+  // Without a '/', dlopen would only search the library path
+  string file = (path.find('/') == string::npos) ? "./" + path : path;
+
+  void *handle = dlopen(file.c_str(), RTLD_NOW | RTLD_LOCAL);
+
+  if (!handle) {
+    cerr << "*CL_ERR: Could not load checker " << path << ": " << dlerror() << "\n";
+    return 1;
+  }
+
+  cl_check_batch_t fn = (cl_check_batch_t) dlsym(handle, CL_CHECK_BATCH_SYMBOL);
+
+  if (!fn) {
+    cerr << "*CL_ERR: " << path << " does not export " << CL_CHECK_BATCH_SYMBOL << "!\n";
+    dlclose(handle);
+    return 1;
+  }
+
+  cl_status_names_t get_names = (cl_status_names_t) dlsym(handle, CL_STATUS_NAMES_SYMBOL);
+
+  names.resize(CL_STATUS_CUSTOM);
+
+  if (get_names) {
+    size_t n = 0;
+    const char * const *extra = get_names(&n);
+
+    for (size_t i = 0; i < n && names.size() < 256; ++i)
+      names.push_back(extra[i]);
+  }
+
+  if (lib)
+    dlclose(lib);
+
+  lib = handle;
+  batch = fn;
+  f = NULL;
+
+  map_rules();
+
+  return 0;
+}
+
+/*
+ * @brief Gives each class used by the rules a status code
+ */
+void batch_checker::map_rules() {
+
+  rule_codes.clear();
+
+  if (!rules)
+    return;
+
+  for (auto &target : rules->targets()) {
+    size_t code = 0;
+
+    while (code < names.size() && names[code] != target)
+      code++;
+
+    if (code == names.size()) {
+      if (names.size() == 256) {
+        cerr << "*CL_ERR: Too many check classes, \"" << target << "\" is reported as default!\n";
+        code = CL_STATUS_DEFAULT;
+      } else {
+        names.push_back(target);
+      }
+    }
+
+    rule_codes.push_back(code);
+  }
+}
+
+/*
+ * @brief Rules tried, in order, before the checker
+ * @param r The rules, must outlive this object
+ */
+void batch_checker::set_rules(const rule_set *r) {
+  rules = (r && !r->empty()) ? r : NULL;
+  map_rules();
+}
+
+void batch_checker::run_batch(const node_info_t * const *infos, size_t n, const string **out) {
+
+  views.resize(n);
+  codes.resize(n);
+
+  for (size_t i = 0; i < n; ++i) {
+    const node_info_t &inf = *infos[i];
+    cl_leaf_t &v = views[i];
+
+    v.type = inf.type.c_str();
+    v.name = inf.name.c_str();
+    v.location = inf.location.c_str();
+    v.comment = inf.comment.c_str();
+    v.line = inf.line;
+    v.hit_count = inf.hit_count;
+    v.found = inf.found;
+    v.negated = inf.negated;
+  }
+
+  batch(views.data(), n, codes.data());
+
+  for (size_t i = 0; i < n && rules; ++i) {
+    int r = rules->match(*infos[i]);
+
+    if (r >= 0)
+      codes[i] = rule_codes[r];
+  }
+
+  for (size_t i = 0; i < n; ++i) {
+    // Unknown codes are reported as passing
+    uint8_t code = (codes[i] < names.size()) ? codes[i] : CL_STATUS_DEFAULT;
+
+    if (infos[i]->negated) {
+      if (code == CL_STATUS_FAIL)
+        code = CL_STATUS_DEFAULT;
+      else if (code == CL_STATUS_DEFAULT)
+        code = CL_STATUS_FAIL;
+    }
+
+    out[i] = &names[code];
+  }
+}
+
+void batch_checker::run_legacy(const node_info_t * const *infos, size_t n, const string **out) {
+
+  for (size_t i = 0; i < n; ++i) {
+    int r = rules ? rules->match(*infos[i]) : -1;
+    const string *res = (r >= 0) ? &names[rule_codes[r]] : &*legacy_names.insert(f(*infos[i])).first;
+
+    if (infos[i]->negated) {
+
+      if (!res->compare("fail"))
+        res = &names[CL_STATUS_DEFAULT];
+      else if (!res->compare("default") || res->empty())
+        res = &names[CL_STATUS_FAIL];
+
+    }
+
+    out[i] = res;
+  }
+}
+
+/*
+ * @brief Evaluates n checks
+ * @param infos The checked items
+ * @param out Receives the class name of each item
+ */
+void batch_checker::run(const node_info_t * const *infos, size_t n, const string **out) {
+
+  for (size_t i = 0; i < n; i += CL_CHECK_CHUNK) {
+    size_t len = (n - i < CL_CHECK_CHUNK) ? n - i : CL_CHECK_CHUNK;
+
+    if (f)
+      run_legacy(infos + i, len, out + i);
+    else
+      run_batch(infos + i, len, out + i);
+  }
+}
@@ -0,0 +1,322 @@
+/******************************************************************************
+ * (C) Copyright 2017 AMIQ Consulting
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *******************************************************************************/
+
+#include <algorithm>
+#include <iterator>
+#include <utility>
+
+#include "bitmap.hpp"
+
+/*
+ * @brief Container of the given key, created if missing
+ */
+roaring_bitmap::container_t &roaring_bitmap::get(uint16_t key) {
+
+  // Values mostly come in increasing order
+  if (containers.empty() || containers.back().key < key) {
+    containers.push_back(container_t());
+    containers.back().key = key;
+    containers.back().card = 0;
+    return containers.back();
+  }
+
+  auto it = std::lower_bound(containers.begin(), containers.end(), key,
+      [](const container_t &c, uint16_t k) { return c.key < k; });
+
+  if (it == containers.end() || it->key != key) {
+    it = containers.insert(it, container_t());
+    it->key = key;
+    it->card = 0;
+  }
+
+  return *it;
+}
+
+const roaring_bitmap::container_t *roaring_bitmap::find(uint16_t key) const {
+
+  auto it = std::lower_bound(containers.begin(), containers.end(), key,
+      [](const container_t &c, uint16_t k) { return c.key < k; });
+
+  return (it == containers.end() || it->key != key) ? NULL : &*it;
+}
+
+void roaring_bitmap::to_bits(container_t &c) {
+
+  c.bits.assign(BITMAP_WORDS, 0);
+
+  for (uint16_t low : c.array)
+    c.bits[low >> 6] |= 1ULL << (low & 63);
+
+  vector<uint16_t>().swap(c.array);
+}
+
+void roaring_bitmap::to_array(container_t &c) {
+
+  c.array.clear();
+  c.array.reserve(c.card);
+
+  for (uint32_t w = 0; w < BITMAP_WORDS; ++w)
+    for (uint64_t word = c.bits[w]; word; word &= word - 1)
+      c.array.push_back((w << 6) | __builtin_ctzll(word));
+
+  vector<uint64_t>().swap(c.bits);
+}
+
+/*
+ * @brief a |= b, for two containers with the same key
+ */
+void roaring_bitmap::unite(container_t &a, const container_t &b) {
+
+  if (a.bits.empty() && b.bits.empty()) {
+    vector<uint16_t> merged;
+
+    merged.reserve(a.array.size() + b.array.size());
+    std::set_union(a.array.begin(), a.array.end(), b.array.begin(), b.array.end(),
+        std::back_inserter(merged));
+
+    a.array.swap(merged);
+    a.card = a.array.size();
+
+    if (a.card > BITMAP_ARRAY_MAX)
+      to_bits(a);
+
+    return;
+  }
+
+  if (a.bits.empty())
+    to_bits(a);
+
+  if (b.bits.empty()) {
+    for (uint16_t low : b.array)
+      a.bits[low >> 6] |= 1ULL << (low & 63);
+  } else {
+    for (uint32_t w = 0; w < BITMAP_WORDS; ++w)
+      a.bits[w] |= b.bits[w];
+  }
+
+  a.card = 0;
+
+  for (uint32_t w = 0; w < BITMAP_WORDS; ++w)
+    a.card += __builtin_popcountll(a.bits[w]);
+}
+
+/*
+ * @brief a &= b, for two containers with the same key
+ */
+void roaring_bitmap::intersect(container_t &a, const container_t &b) {
+
+  if (a.bits.empty()) {
+    vector<uint16_t> common;
+
+    if (b.bits.empty()) {
+      std::set_intersection(a.array.begin(), a.array.end(), b.array.begin(), b.array.end(),
+          std::back_inserter(common));
+    } else {
+      for (uint16_t low : a.array)
+        if (b.bits[low >> 6] & (1ULL << (low & 63)))
+          common.push_back(low);
+    }
+
+    a.array.swap(common);
+    a.card = a.array.size();
+
+    return;
+  }
+
+  if (b.bits.empty()) {
+    vector<uint16_t> common;
+
+    for (uint16_t low : b.array)
+      if (a.bits[low >> 6] & (1ULL << (low & 63)))
+        common.push_back(low);
+
+    vector<uint64_t>().swap(a.bits);
+    a.array.swap(common);
+    a.card = a.array.size();
+
+    return;
+  }
+
+  a.card = 0;
+
+  for (uint32_t w = 0; w < BITMAP_WORDS; ++w) {
+    a.bits[w] &= b.bits[w];
+    a.card += __builtin_popcountll(a.bits[w]);
+  }
+
+  if (a.card <= BITMAP_ARRAY_MAX)
+    to_array(a);
+}
+
+void roaring_bitmap::add(uint32_t x) {
+
+  container_t &c = get(x >> 16);
+  uint16_t low = x & 0xFFFF;
+
+  if (!c.bits.empty()) {
+    uint64_t &word = c.bits[low >> 6];
+    uint64_t bit = 1ULL << (low & 63);
+
+    if (!(word & bit)) {
+      word |= bit;
+      c.card++;
+    }
+
+    return;
+  }
+
+  if (c.array.empty() || c.array.back() < low) {
+    c.array.push_back(low);
+  } else {
+    auto it = std::lower_bound(c.array.begin(), c.array.end(), low);
+
+    if (*it == low)
+      return;
+
+    c.array.insert(it, low);
+  }
+
+  if (++c.card > BITMAP_ARRAY_MAX)
+    to_bits(c);
+}
+
+bool roaring_bitmap::contains(uint32_t x) const {
+
+  const container_t *c = find(x >> 16);
+  uint16_t low = x & 0xFFFF;
+
+  if (!c)
+    return false;
+
+  if (!c->bits.empty())
+    return c->bits[low >> 6] & (1ULL << (low & 63));
+
+  return std::binary_search(c->array.begin(), c->array.end(), low);
+}
+
+uint64_t roaring_bitmap::cardinality() const {
+
+  uint64_t n = 0;
+
+  for (auto &c : containers)
+    n += c.card;
+
+  return n;
+}
+
+roaring_bitmap &roaring_bitmap::operator|=(const roaring_bitmap &b) {
+
+  vector<container_t> result;
+  size_t i = 0, j = 0;
+
+  result.reserve(containers.size() + b.containers.size());
+
+  while (i < containers.size() || j < b.containers.size()) {
+    if (j == b.containers.size() || (i < containers.size() && containers[i].key < b.containers[j].key)) {
+      result.push_back(std::move(containers[i++]));
+    } else if (i == containers.size() || b.containers[j].key < containers[i].key) {
+      result.push_back(b.containers[j++]);
+    } else {
+      unite(containers[i], b.containers[j++]);
+      result.push_back(std::move(containers[i++]));
+    }
+  }
+
+  containers.swap(result);
+
+  return *this;
+}
+
+roaring_bitmap &roaring_bitmap::operator&=(const roaring_bitmap &b) {
+
+  size_t kept = 0;
+
+  for (size_t i = 0; i < containers.size(); ++i) {
+    const container_t *other = b.find(containers[i].key);
+
+    if (!other)
+      continue;
+
+    intersect(containers[i], *other);
+
+    if (containers[i].card) {
+      if (kept != i)
+        containers[kept] = std::move(containers[i]);
+      kept++;
+    }
+  }
+
+  containers.resize(kept);
+
+  return *this;
+}
+
+/*
+ * @brief Number of values whose bit is not set in a plain bitset (value x is
+ * @brief bit x & 63 of words[x >> 6]). words must cover all the containers.
+ */
+uint64_t roaring_bitmap::count_not_in(const vector<uint64_t> &words) const {
+
+  uint64_t n = 0;
+
+  for (auto &c : containers) {
+    const uint64_t *base = words.data() + ((size_t) c.key << 10);
+
+    if (c.bits.empty()) {
+      for (uint16_t low : c.array)
+        n += !(base[low >> 6] & (1ULL << (low & 63)));
+      continue;
+    }
+
+    for (uint32_t w = 0; w < BITMAP_WORDS; ++w)
+      n += __builtin_popcountll(c.bits[w] & ~base[w]);
+  }
+
+  return n;
+}
+
+/*
+ * @brief Sets the bits of the values in a plain bitset, see count_not_in
+ */
+void roaring_bitmap::set_in(vector<uint64_t> &words) const {
+
+  for (auto &c : containers) {
+    uint64_t *base = words.data() + ((size_t) c.key << 10);
+
+    if (c.bits.empty()) {
+      for (uint16_t low : c.array)
+        base[low >> 6] |= 1ULL << (low & 63);
+      continue;
+    }
+
+    for (uint32_t w = 0; w < BITMAP_WORDS; ++w)
+      base[w] |= c.bits[w];
+  }
+}
+
+/*
+ * @brief Memory used by the containers, in bytes
+ */
+size_t roaring_bitmap::bytes() const {
+
+  size_t n = containers.capacity() * sizeof(container_t);
+
+  for (auto &c : containers)
+    n += c.array.capacity() * sizeof(uint16_t) + c.bits.capacity() * sizeof(uint64_t);
+
+  return n;
+}
@@ -17,6 +17,7 @@
 
 #include "parser_utils.hpp"
 #include "check_file_parser.hpp"
+#include "assert_census.hpp"
 
 // Debug info
 static bool debug_switch;
@@ -26,11 +27,11 @@ static ofstream debug_log;
 static pu *parser;
 
 #define CHECK_UNIQUE(x) \
-    if (cmd.find((x)) == cmd.end() || cmd[(x)].size() != 1) \
+    if (cmd.args((x)).size() != 1) \
       return; \
 
 #define CHECK_EXIST(x) \
-    if (cmd.find((x)) == cmd.end()) \
+    if (!cmd.has((x))) \
       return; \
 
 /**
@@ -97,7 +98,7 @@ int get_num_params(string path, string sep)
  *  @param line Check command line in file (for debugging)
  *  @param negate Global check switch
  */
-void add_command(top_tree* &excl_tree, map<string, vector<string>> cmd, int index,
+void add_command(top_tree* &excl_tree, const pu_cmd &cmd, int index,
     const string& file, int line, bool negate) {
 
 // Step 1: get location : type + scope
@@ -112,14 +113,14 @@ void add_command(top_tree* &excl_tree, map<string, vector<string>> cmd, int inde
 
   // First char of the first(and only argument) "kind" argument
   // f -> file, d -> du, s -> scope
-//  query_t = cmd["k"][0][0];
-  if (!cmd["k"][0].compare("type"))
+//  query_t = cmd.args("k")[0][0];
+  if (!cmd.args("k")[0].compare("type"))
     query_t = 'd';
-  else if (!cmd["k"][0].compare("inst"))
+  else if (!cmd.args("k")[0].compare("inst"))
     query_t = 's';
 
   // Start by adding location to query
-  query = cmd["p"][0];
+  query = cmd.args("p")[0];
 
   if (query[0] == '/')
     query = query.substr(1);
@@ -133,14 +134,14 @@ void add_command(top_tree* &excl_tree, map<string, vector<string>> cmd, int inde
   inf.generator = file;
   inf.generator_line = line;
 
-  inf.negated = (cmd.find("n") != cmd.end()) ^ negate;
+  inf.negated = cmd.has("n") ^ negate;
 
   query += "/";
 
-  string type = cmd["t"][0];
+  const vector<string> &opt = cmd.args("t");
+  const string &type = opt[0];
 
-  vector<string> opt = cmd["t"];
-  vector<int> linerange = get_lines(cmd["l"], expanded);
+  vector<int> linerange = get_lines(cmd.args("l"), expanded);
 
   switch (type[0]) {
   case 's':
@@ -252,6 +253,17 @@ void add_command(top_tree* &excl_tree, map<string, vector<string>> cmd, int inde
 
       inf.name = path;
 
+      // A range of an array bin is kept as one check, with a hit count per index
+      int64_t first, last;
+
+      if (::excl_tree::parse_range(index, first, last)) {
+        inf.bin_first = first;
+        inf.bin_hits.assign(last - first + 1, 0);
+      } else if (index.find('-') != string::npos) {
+        cerr << "*CL_ERR: Invalid bin range " << index << " in " << file << ", line " << line << "!\n";
+        return;
+      }
+
       PRINT_LINE(query + path + "/" + index + "/v/");
       excl_tree->add(query + path + "/" + index + "/v/", query_t, inf, expanded);
     }
@@ -266,12 +278,64 @@ void add_command(top_tree* &excl_tree, map<string, vector<string>> cmd, int inde
       path = path.substr(1);
     inf.name = path;
 
+    // A counter of the assertion, with the count it must reach
+    if (opt.size() > 2) {
+      char counter = assert_counter_key(opt[2]);
+
+      if (!counter) {
+        cerr << "*CL_ERR: Unknown assertion counter " << opt[2] << " in " << file << ", line " << line << "!\n";
+        return;
+      }
+
+      inf.type = "Assertion";
+      inf.name += " " + opt[2];
+      inf.min_hits = (opt.size() > 3) ? atoll(opt[3].c_str()) : 1;
+
+      if (inf.min_hits < 1) {
+        cerr << "*CL_ERR: Invalid threshold " << opt[3] << " in " << file << ", line " << line << "!\n";
+        return;
+      }
+
+      PRINT_LINE(query + path + "/a/" + counter + "/");
+      excl_tree->add(query + path + "/a/" + counter + "/", query_t, inf, expanded);
+      break;
+    }
+
     PRINT_LINE(query + path + "/a/");
     excl_tree->add(query + path + "/a/", query_t, inf, expanded);
 
     break;
   }
-  case 't':               // "trans"
+  case 't':               // "trans" or "toggle"
+
+    if (type[1] == 'o') {
+      inf.type = "Toggle";
+
+      // Every signal under the location
+      if (opt.size() < 2) {
+        inf.name = "*";
+        PRINT_LINE(query + "O/");
+        excl_tree->add(query + "O/", query_t, inf);
+        break;
+      }
+
+      // Signals, with an optional bit or part select, '*' and '?' match any chars
+      for (int i = 1; i < opt.size(); ++i) {
+        string glob;
+        int64_t first, last;
+
+        if (!toggle_parse_pattern(opt[i], glob, first, last)) {
+          cerr << "*CL_ERR: Invalid toggle signal " << opt[i] << " in " << file << ", line " << line << "!\n";
+          continue;
+        }
+
+        inf.name = opt[i];
+        PRINT_LINE(query + opt[i] + "/o/");
+        excl_tree->add(query + opt[i] + "/o/", query_t, inf);
+      }
+
+      break;
+    }
 
     if (opt.size() < 2) {
       debug_log << "Not enough params for a state check. \
@@ -322,6 +386,25 @@ void add_command(top_tree* &excl_tree, map<string, vector<string>> cmd, int inde
   }
 }
 
+/*
+ * State shared by check_consumer calls
+ */
+typedef struct {
+  top_tree *excl_tree;
+  const string *file_name;
+  bool negate;
+  int index;
+} check_ctx_t;
+
+/**
+ * @brief Stores each check command as soon as the parser read it
+ */
+static void check_consumer(const pu_cmd &cmd, uint line, void *data) {
+  check_ctx_t *ctx = (check_ctx_t *) data;
+
+  add_command(ctx->excl_tree, cmd, ctx->index++, *ctx->file_name, line, ctx->negate);
+}
+
 /**
  * @brief Configures the generic parser and stores the checks
  * @param vp_ref Check file stream
@@ -342,15 +425,15 @@ void parse_rules(ifstream &vp_ref, top_tree* &excl_tree, const string &file_name
 
   parser = new pu(questa_conf, args, vp_ref);
 
+  // Checks go straight into the tree, without building a result map
+  check_ctx_t ctx = { excl_tree, &file_name, negate, 0 };
+  parser->pu_set_consumer(check_consumer, &ctx);
+
   // Read the file
   parser->pu_main();
 
-  // Get map
-  pu_results x = parser->pu_get_results();
-
-  for (int q = 0; q < x.size(); ++q) {
-    add_command(excl_tree, x[q], q, file_name, parser->get_line(q), negate);
-  }
+  delete parser;
+  parser = NULL;
 }
 
 /**
@@ -0,0 +1,574 @@
+/******************************************************************************
+ * (C) Copyright 2017 AMIQ Consulting
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include <fstream>
+#include <iostream>
+
+#include "cov_index.hpp"
+#include "ucis_callbacks.hpp"
+
+using std::ifstream;
+using std::ofstream;
+using std::cout;
+using std::cerr;
+using std::to_string;
+
+static const char index_magic[8] = { 'C', 'L', 'C', 'O', 'V', 'I', 'X', '4' };
+
+static void print_red(const string &text) {
+  cout << "\033[1;31m" << text << "\033[0m";
+}
+
+/*
+ * @brief True for keys that are node numbers rather than names
+ */
+static bool is_number(const string &key) {
+  return !key.empty() && key.find_first_not_of("0123456789") == string::npos;
+}
+
+/*
+ * @brief Position of a node given by number (from 1) or by name, -1 if none
+ */
+static int64_t find_node(const string &key, size_t count, const unordered_map<string, uint32_t> &ids) {
+
+  if (is_number(key)) {
+    uint64_t n = strtoull(key.c_str(), NULL, 10);
+
+    return (n >= 1 && n <= count) ? (int64_t) n - 1 : -1;
+  }
+
+  auto it = ids.find(key);
+
+  return it == ids.end() ? -1 : (int64_t) it->second;
+}
+
+/*
+ * @brief True if name is <group>/<point>
+ */
+static bool same_point(const string &name, const string &group, const string &point) {
+  return name.size() == group.size() + 1 + point.size() && !name.compare(0, group.size(), group)
+      && name[group.size()] == '/' && !name.compare(group.size() + 1, string::npos, point);
+}
+
+void cov_index::clear() {
+  groups.clear();
+  points.clear();
+  bins.clear();
+  group_ids.clear();
+  point_ids.clear();
+  bin_ids.clear();
+  last_point = UINT32_MAX;
+}
+
+/*
+ * @brief Adds a bin, and its coverpoint and covergroup if they are new
+ * @param group Hierarchical name of the covergroup
+ * @param point Name of the coverpoint in the covergroup
+ * @param bin Name of the bin
+ * @param hits Hit count of the bin
+ * @param covered True if the bin was hit at least at_least times
+ * @param scope Crossed coverpoints and options, used if the coverpoint is new
+ */
+void cov_index::add_bin(const string &group, const string &point, const string &bin, int64_t hits,
+    bool covered, const cov_scope_t &scope) {
+
+  if (last_point == UINT32_MAX || !same_point(points[last_point].name, group, point)) {
+
+    string point_name = group + "/" + point;
+    auto p = point_ids.find(point_name);
+
+    if (p != point_ids.end()) {
+      last_point = p->second;
+    } else {
+      auto g = group_ids.find(group);
+      uint32_t gid;
+
+      if (g == group_ids.end()) {
+        cov_group_t cvg;
+
+        cvg.name = group;
+        cvg.stats.bins = 0;
+        cvg.stats.hit_bins = 0;
+        cvg.options = scope.group;
+
+        gid = groups.size();
+        groups.push_back(cvg);
+        group_ids[group] = gid;
+      } else {
+        gid = g->second;
+      }
+
+      cov_point_t cvp;
+
+      cvp.name = point_name;
+      cvp.group = gid;
+      cvp.crossed = scope.crossed;
+      cvp.stats.bins = 0;
+      cvp.stats.hit_bins = 0;
+      cvp.options = scope.point;
+
+      last_point = points.size();
+      groups[gid].points.push_back(last_point);
+      points.push_back(cvp);
+      point_ids[point_name] = last_point;
+    }
+  }
+
+  cov_point_t &cvp = points[last_point];
+  cov_group_t &cvg = groups[cvp.group];
+  cov_bin_t b = { bin, hits, covered };
+
+  // The first bin of a name is the one found by name
+  bin_ids.insert(make_pair(cvp.name + "/" + bin, (uint32_t) bins.size()));
+
+  cvp.bins.push_back(bins.size());
+  bins.push_back(b);
+
+  cvp.stats.bins++;
+  cvg.stats.bins++;
+
+  if (covered) {
+    cvp.stats.hit_bins++;
+    cvg.stats.hit_bins++;
+  }
+}
+
+/*
+ * @brief Score of a covergroup: average of the scores of its coverpoints and
+ * @brief crosses, weighted by their option.weight
+ */
+double cov_index::group_score(uint32_t group) const {
+  double sum = 0;
+  int64_t weights = 0;
+
+  for (uint32_t p : groups[group].points) {
+    sum += points[p].options.weight * point_score(p);
+    weights += points[p].options.weight;
+  }
+
+  return weights ? sum / weights : 0;
+}
+
+/*
+ * @brief Score of the UCISDB: average of the covergroup scores, weighted by their
+ * @brief option.weight
+ */
+double cov_index::total_score() const {
+  double sum = 0;
+  int64_t weights = 0;
+
+  for (uint32_t g = 0; g < groups.size(); ++g) {
+    sum += groups[g].options.weight * group_score(g);
+    weights += groups[g].options.weight;
+  }
+
+  return weights ? sum / weights : 0;
+}
+
+int64_t cov_index::find_group(const string &key) const {
+  return find_node(key, groups.size(), group_ids);
+}
+
+int64_t cov_index::find_point(const string &key) const {
+  return find_node(key, points.size(), point_ids);
+}
+
+int64_t cov_index::find_bin(uint32_t point, const string &key) const {
+
+  const vector<uint32_t> &ids = points[point].bins;
+
+  if (is_number(key)) {
+    uint64_t n = strtoull(key.c_str(), NULL, 10);
+
+    return (n >= 1 && n <= ids.size()) ? (int64_t) ids[n - 1] : -1;
+  }
+
+  auto it = bin_ids.find(points[point].name + "/" + key);
+
+  return it == bin_ids.end() ? -1 : (int64_t) it->second;
+}
+
+/*
+ * @brief Rebuilds the name lookups of a loaded index
+ */
+void cov_index::map_names() {
+
+  group_ids.clear();
+  point_ids.clear();
+  bin_ids.clear();
+
+  for (uint32_t i = 0; i < groups.size(); ++i)
+    group_ids.insert(make_pair(groups[i].name, i));
+
+  for (uint32_t i = 0; i < points.size(); ++i) {
+    point_ids.insert(make_pair(points[i].name, i));
+
+    for (uint32_t b : points[i].bins)
+      bin_ids.insert(make_pair(points[i].name + "/" + bins[b].name, b));
+  }
+
+  last_point = UINT32_MAX;
+}
+
+static void write_str(ofstream &out, const string &s) {
+  uint32_t len = s.size();
+
+  out.write((const char *) &len, sizeof(len));
+  out.write(s.data(), len);
+}
+
+static bool read_str(ifstream &in, string &s) {
+  uint32_t len;
+
+  if (!in.read((char *) &len, sizeof(len)))
+    return false;
+
+  s.resize(len);
+
+  return len == 0 || in.read(&s[0], len);
+}
+
+template<typename T>
+static void write_pod(ofstream &out, const T &x) {
+  out.write((const char *) &x, sizeof(x));
+}
+
+template<typename T>
+static bool read_pod(ifstream &in, T &x) {
+  return (bool) in.read((char *) &x, sizeof(x));
+}
+
+static void write_ids(ofstream &out, const vector<uint32_t> &ids) {
+  write_pod(out, (uint32_t) ids.size());
+  out.write((const char *) ids.data(), ids.size() * sizeof(uint32_t));
+}
+
+static bool read_ids(ifstream &in, vector<uint32_t> &ids, uint32_t limit) {
+  uint32_t n;
+
+  if (!read_pod(in, n) || n > limit)
+    return false;
+
+  ids.resize(n);
+
+  if (n && !in.read((char *) ids.data(), n * sizeof(uint32_t)))
+    return false;
+
+  for (uint32_t id : ids)
+    if (id >= limit)
+      return false;
+
+  return true;
+}
+
+/*
+ * @brief Stores the index, stamped with the UCISDB it was built from
+ */
+bool cov_index::store(const string &file, uint64_t mtime, uint64_t size) const {
+
+  ofstream out(file, ofstream::out | ofstream::binary);
+
+  if (!out.good())
+    return false;
+
+  out.write(index_magic, sizeof(index_magic));
+  write_pod(out, mtime);
+  write_pod(out, size);
+
+  write_pod(out, (uint32_t) groups.size());
+  write_pod(out, (uint32_t) points.size());
+  write_pod(out, (uint32_t) bins.size());
+
+  for (auto &g : groups) {
+    write_str(out, g.name);
+    write_ids(out, g.points);
+    write_pod(out, g.stats);
+    write_pod(out, g.options);
+  }
+
+  for (auto &p : points) {
+    write_str(out, p.name);
+    write_pod(out, p.group);
+    write_pod(out, (uint32_t) p.crossed.size());
+
+    for (auto &c : p.crossed)
+      write_str(out, c);
+
+    write_ids(out, p.bins);
+    write_pod(out, p.stats);
+    write_pod(out, p.options);
+  }
+
+  for (auto &b : bins) {
+    write_str(out, b.name);
+    write_pod(out, b.hits);
+    write_pod(out, (uint8_t) b.covered);
+  }
+
+  return out.good();
+}
+
+/*
+ * @brief Loads an index stored for the UCISDB in its current state
+ * @return true on success
+ */
+bool cov_index::load(const string &file, uint64_t mtime, uint64_t size) {
+
+  ifstream in(file, ifstream::in | ifstream::binary);
+  char magic[8];
+  uint64_t m, s;
+  uint32_t nof_groups, nof_points, nof_bins;
+
+  clear();
+
+  if (!in.read(magic, sizeof(magic)) || memcmp(magic, index_magic, sizeof(magic))
+      || !read_pod(in, m) || !read_pod(in, s) || m != mtime || s != size
+      || !read_pod(in, nof_groups) || !read_pod(in, nof_points) || !read_pod(in, nof_bins))
+    return false;
+
+  groups.resize(nof_groups);
+  points.resize(nof_points);
+  bins.resize(nof_bins);
+
+  bool ok = true;
+
+  for (auto &g : groups)
+    ok = ok && read_str(in, g.name) && read_ids(in, g.points, nof_points) && read_pod(in, g.stats)
+        && read_pod(in, g.options);
+
+  for (auto &p : points) {
+    uint32_t nof_crossed = 0;
+
+    ok = ok && read_str(in, p.name) && read_pod(in, p.group) && p.group < nof_groups
+        && read_pod(in, nof_crossed);
+
+    p.crossed.resize(ok ? nof_crossed : 0);
+
+    for (auto &c : p.crossed)
+      ok = ok && read_str(in, c);
+
+    ok = ok && read_ids(in, p.bins, nof_bins) && read_pod(in, p.stats) && read_pod(in, p.options);
+  }
+
+  for (auto &b : bins) {
+    uint8_t covered = 0;
+
+    ok = ok && read_str(in, b.name) && read_pod(in, b.hits) && read_pod(in, covered);
+    b.covered = covered;
+  }
+
+  if (!ok) {
+    clear();
+    return false;
+  }
+
+  map_names();
+
+  return true;
+}
+
+/*
+ * @brief FNV-1a hash, used to name the index of a UCISDB
+ */
+static uint64_t fnv1a(const string &s) {
+  uint64_t hash = 0xcbf29ce484222325ULL;
+
+  for (size_t i = 0; i < s.size(); ++i) {
+    hash ^= (unsigned char) s[i];
+    hash *= 0x100000001b3ULL;
+  }
+
+  return hash;
+}
+
+/*
+ * @brief Builds the index of a UCISDB, or loads it from cache_dir
+ * @param db_file Path to the UCISDB
+ * @param cache_dir Where indexes are kept, none if empty
+ * @param index Filled with the index
+ */
+void cov_build(const string &db_file, const string &cache_dir, cov_index &index) {
+
+  struct stat st;
+  string file;
+
+  if (!cache_dir.empty() && stat(db_file.c_str(), &st) == 0) {
+    char name[40];
+
+    snprintf(name, sizeof(name), "db_%016llx.cvindex", (unsigned long long) fnv1a(db_file));
+    file = cache_dir + "/" + name;
+
+    if (index.load(file, st.st_mtime, st.st_size))
+      return;
+  }
+
+  cov_scan_t scan;
+
+  scan.du.underneath = 0;
+  scan.du.subscope_counter = 0;
+  scan.index = &index;
+  scan.scope.group = cov_default_options();
+  scan.scope.point = cov_default_options();
+
+  index.clear();
+  iterate_db(db_file, index_callback, (void *) &scan);
+
+  if (!file.empty() && !index.store(file, st.st_mtime, st.st_size))
+    cerr << "Could not write coverage index " << file << "!\n";
+}
+
+/*
+ * @brief Prints a row of the score table
+ */
+static void score_row(const char *kind, double score, const cov_options_t &o, const cov_stats_t &s,
+    const string &name) {
+  char num[32];
+
+  snprintf(num, sizeof(num), "%.2f", score);
+
+  cout << kind << "\t" << num << "\t" << o.goal << "\t" << (score >= o.goal ? "yes" : "no") << "\t"
+      << o.weight << "\t" << o.at_least << "\t" << s.bins << "\t" << s.hit_bins << "\t" << name << "\n";
+}
+
+/*
+ * @brief Prints the scores of all covergroups, coverpoints and crosses, each
+ * @brief covergroup followed by its coverpoints and crosses
+ */
+static void print_scores(const cov_index &index) {
+  const vector<cov_group_t> &groups = index.group_list();
+  const vector<cov_point_t> &points = index.point_list();
+  char num[32];
+
+  cout << "kind\tscore\tgoal\tmet\tweight\tat_least\tbins\thit_bins\tname\n";
+
+  for (uint32_t g = 0; g < groups.size(); ++g) {
+    score_row("covergroup", index.group_score(g), groups[g].options, groups[g].stats, groups[g].name);
+
+    for (uint32_t p : groups[g].points)
+      score_row(points[p].crossed.empty() ? "coverpoint" : "cross", index.point_score(p),
+          points[p].options, points[p].stats, points[p].name);
+  }
+
+  snprintf(num, sizeof(num), "%.2f", index.total_score());
+  cout << "total\t" << num << "\n";
+}
+
+/*
+ * @brief Prints the answer to a -g query
+ */
+static void query(const cov_index &index, const vector<string> &args) {
+
+  const string &cmd = args[0];
+  const string none;
+  const string &arg1 = args.size() > 1 ? args[1] : none;
+  const string &arg2 = args.size() > 2 ? args[2] : none;
+
+  int64_t cvg = -1, cvp = -1, bin = -1;
+
+  if (cmd == "cvg_name" || cmd == "cvg_res")
+    cvg = index.find_group(arg1);
+  else if (cmd == "cvp_name" || cmd == "cvp_res" || cmd == "nof_bins")
+    cvp = index.find_point(arg1);
+  else if (cmd == "bin_name" || cmd == "nof_hits") {
+    cvp = index.find_point(arg1);
+
+    if (cvp >= 0)
+      bin = index.find_bin(cvp, arg2);
+  }
+
+  if (cmd == "scores") {
+    print_scores(index);
+    return;
+  }
+
+  bool found = cmd == "nof_cvgs" || cmd == "nof_cvps" || cvg >= 0
+      || (cvp >= 0 && (bin >= 0 || (cmd != "bin_name" && cmd != "nof_hits")));
+
+  cout << "\t";
+
+  if (!found) {
+    print_red("Not found");
+    cout << "\n";
+    return;
+  }
+
+  if (cmd == "nof_cvgs") {
+    cout << "Number of covergroups is [";
+    print_red(to_string(index.group_list().size()));
+    cout << "]\n";
+  } else if (cmd == "cvg_name") {
+    cout << "Name is [";
+    print_red(index.group_list()[cvg].name);
+    cout << "]\n";
+  } else if (cmd == "cvp_name") {
+    cout << "Name is [";
+    print_red(index.point_list()[cvp].name);
+    cout << "]\n";
+  } else if (cmd == "bin_name") {
+    cout << "Name is [";
+    print_red(index.bin_list()[bin].name);
+    cout << "]\n";
+  } else if (cmd == "cvg_res") {
+    cout << "Weighted score [";
+    print_red(to_string(index.group_score(cvg)));
+    cout << "]\n";
+  } else if (cmd == "cvp_res") {
+    cout << "Percent of hit bins [";
+    print_red(to_string(cov_percent(index.point_list()[cvp].stats)));
+    cout << "]\n";
+  } else if (cmd == "nof_cvps") {
+    cout << "Number of coverpoints is [";
+    print_red(to_string(index.point_list().size()));
+    cout << "]\n";
+  } else if (cmd == "nof_hits") {
+    cout << "The bin was hit [";
+    print_red(to_string(index.bin_list()[bin].hits));
+    cout << "] times\n";
+  } else if (cmd == "nof_bins") {
+    cout << "The number of bins is [";
+    print_red(to_string(index.point_list()[cvp].stats.bins));
+    cout << "]\n";
+  }
+}
+
+/*
+ * @brief Answers a -g query for each UCISDB.
+ * @brief The index of each UCISDB is built by a single traversal, or loaded
+ * @brief from cache_dir when the UCISDB did not change since it was stored.
+ * @param dbs Paths to the UCISDBs
+ * @param args Query and its arguments
+ * @param cache_dir Where indexes are kept, none if empty
+ * @return 0 on success
+ */
+int cov_main(const vector<string> &dbs, const vector<string> &args, const string &cache_dir) {
+
+  cov_index index;
+
+  for (int i = 0; i < dbs.size(); ++i) {
+    cout << "UCISDB #" << i << " @" << dbs[i] << "\n";
+
+    cov_build(dbs[i], cache_dir, index);
+    query(index, args);
+  }
+
+  return 0;
+}
@@ -0,0 +1,266 @@
+/******************************************************************************
+ * (C) Copyright 2017 AMIQ Consulting
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *******************************************************************************/
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <iostream>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "cross_holes.hpp"
+#include "cov_index.hpp"
+#include "bitmap.hpp"
+#include "formatter.hpp"
+
+using std::cout;
+using std::cerr;
+using std::unordered_map;
+using std::unordered_set;
+
+/*
+ * A cross over all UCISDBs. Bins are numbered by name, in the order they are
+ * first seen, so that the bitmaps of different UCISDBs line up.
+ */
+typedef struct {
+  string name;
+  vector<string> crossed;
+  vector<string> bins;
+  unordered_map<string, uint32_t> ids;
+  roaring_bitmap any;     // hit in some UCISDB
+  roaring_bitmap all;     // hit in every UCISDB
+  uint32_t nof_dbs;       // UCISDBs holding the cross
+} cross_t;
+
+/*
+ * Bins of the cross sharing a value of one of its coverpoints
+ */
+typedef struct {
+  uint32_t dim;
+  string value;
+  uint32_t holes;
+  uint32_t total;
+} projection_t;
+
+/*
+ * @brief Splits an automatic cross bin name ("<v1,v2,...>") in the values of
+ * @brief the crossed coverpoints. Commas inside brackets don't split.
+ * @return false for bins named otherwise (e.g. user defined cross bins)
+ */
+static bool split_bin(const string &bin, vector<string> &values) {
+
+  values.clear();
+
+  if (bin.size() < 2 || bin[0] != '<' || bin[bin.size() - 1] != '>')
+    return false;
+
+  int depth = 0;
+  size_t start = 1;
+
+  for (size_t i = 1; i < bin.size() - 1; ++i) {
+    char c = bin[i];
+
+    if (c == '[' || c == '(' || c == '{')
+      depth++;
+    else if ((c == ']' || c == ')' || c == '}') && depth)
+      depth--;
+    else if (c == ',' && !depth) {
+      values.push_back(bin.substr(start, i - start));
+      start = i + 1;
+    }
+  }
+
+  values.push_back(bin.substr(start, bin.size() - 1 - start));
+
+  return true;
+}
+
+/*
+ * @brief Adds the bins one UCISDB covered (as -g scores counts them) to a cross
+ */
+static void add_db(cross_t &cross, const cov_index &index, const cov_point_t &point) {
+
+  roaring_bitmap hit;
+
+  for (uint32_t b : point.bins) {
+    const cov_bin_t &bin = index.bin_list()[b];
+    auto ins = cross.ids.insert(make_pair(bin.name, (uint32_t) cross.bins.size()));
+
+    if (ins.second)
+      cross.bins.push_back(bin.name);
+
+    if (bin.covered)
+      hit.add(ins.first->second);
+  }
+
+  cross.any |= hit;
+
+  if (cross.nof_dbs)
+    cross.all &= hit;
+  else
+    cross.all = hit;
+
+  cross.nof_dbs++;
+}
+
+/*
+ * @brief Groups the holes of a cross by coverpoint value, most holes first
+ */
+static vector<projection_t> project(const cross_t &cross, const vector<uint64_t> &hit) {
+
+  vector<projection_t> proj;
+  unordered_map<string, size_t> ids;
+  vector<string> values;
+
+  for (uint32_t b = 0; b < cross.bins.size(); ++b) {
+
+    if (!split_bin(cross.bins[b], values))
+      continue;
+
+    bool hole = !(hit[b >> 6] & (1ULL << (b & 63)));
+
+    for (uint32_t d = 0; d < values.size(); ++d) {
+      string key = to_string(d) + "=" + values[d];
+      auto ins = ids.insert(make_pair(key, proj.size()));
+
+      if (ins.second) {
+        projection_t p = { d, values[d], 0, 0 };
+        proj.push_back(p);
+      }
+
+      proj[ins.first->second].total++;
+      proj[ins.first->second].holes += hole;
+    }
+  }
+
+  std::stable_sort(proj.begin(), proj.end(), [](const projection_t &a, const projection_t &b) {
+    return a.holes > b.holes;
+  });
+
+  return proj;
+}
+
+static string dim_name(const cross_t &cross, uint32_t d) {
+  return d < cross.crossed.size() ? cross.crossed[d] : "#" + to_string(d + 1);
+}
+
+/*
+ * @brief Writes the holes of a cross to stdout (summary) and out (everything)
+ */
+static void report(const cross_t &cross, size_t nof_dbs, out_buffer &out) {
+
+  vector<uint64_t> hit((cross.bins.size() >> 6) + 1, 0);
+
+  cross.any.for_each([&](uint32_t b) { hit[b >> 6] |= 1ULL << (b & 63); });
+
+  uint64_t nof_bins = cross.bins.size();
+  uint64_t nof_hit = cross.any.cardinality();
+  uint64_t nof_all = cross.nof_dbs == nof_dbs ? cross.all.cardinality() : 0;
+
+  string line = "Cross " + cross.name + ": " + to_string(nof_bins) + " bins, " + to_string(nof_hit)
+      + " hit in some UCISDB (" + to_string(nof_bins ? 100.0 * nof_hit / nof_bins : 0) + "%), "
+      + to_string(nof_all) + " hit in all, " + to_string(nof_bins - nof_hit) + " holes\n";
+
+  cout << line;
+  out.put(line);
+
+  vector<projection_t> proj = project(cross, hit);
+  vector<uint32_t> shown(std::max<size_t>(cross.crossed.size(), 1), 0);
+
+  for (auto &p : proj) {
+    if (!p.holes)
+      break;
+
+    line = "\t" + dim_name(cross, p.dim) + " = " + p.value + ": " + to_string(p.holes) + " of "
+        + to_string(p.total) + " bins not hit\n";
+
+    if (p.dim >= shown.size())
+      shown.resize(p.dim + 1, 0);
+
+    if (shown[p.dim]++ < CROSS_TOP_VALUES)
+      cout << line;
+
+    out.put(line);
+  }
+
+  for (uint32_t b = 0; b < nof_bins; ++b)
+    if (!(hit[b >> 6] & (1ULL << (b & 63))))
+      out.put("\thole ").put(cross.bins[b]).put('\n');
+}
+
+/*
+ * @brief Reports the bins of the crosses that no UCISDB hit.
+ * @brief For each UCISDB and cross, the hit bins are collected in a compressed
+ * @brief bitmap. The bitmaps of all UCISDBs are then joined (hit anywhere) and
+ * @brief intersected (hit everywhere). Holes are grouped by the value they
+ * @brief have for each crossed coverpoint.
+ * @param dbs Paths to the UCISDBs
+ * @param crosses Names (<covergroup>/<cross>) of the crosses to analyze, all if empty
+ * @param cache_dir Where coverage indexes are kept, none if empty
+ * @param file Where every hole is listed
+ * @return 0 on success
+ */
+int cross_main(const vector<string> &dbs, const vector<string> &crosses, const string &cache_dir,
+    const string &file) {
+
+  unordered_set<string> wanted(crosses.begin(), crosses.end());
+  vector<cross_t> all;
+  unordered_map<string, size_t> ids;
+  cov_index index;
+
+  for (int i = 0; i < dbs.size(); ++i) {
+    cout << "UCISDB #" << i << " @" << dbs[i] << "\n";
+
+    cov_build(dbs[i], cache_dir, index);
+
+    for (auto &p : index.point_list()) {
+
+      if (p.crossed.empty() || (!wanted.empty() && !wanted.count(p.name)))
+        continue;
+
+      auto ins = ids.insert(make_pair(p.name, all.size()));
+
+      if (ins.second) {
+        all.push_back(cross_t());
+        all.back().name = p.name;
+        all.back().crossed = p.crossed;
+        all.back().nof_dbs = 0;
+      }
+
+      add_db(all[ins.first->second], index, p);
+    }
+  }
+
+  out_file holes(file);
+
+  if (!holes.is_open()) {
+    cerr << "*CL_ERR: Could not write " << file << "!\n";
+    return 1;
+  }
+
+  out_buffer out(&holes);
+
+  for (auto &cross : all)
+    report(cross, dbs.size(), out);
+
+  if (all.empty())
+    cout << "No crosses found\n";
+  else
+    cout << "Holes of each cross are listed in " << file << "\n";
+
+  return 0;
+}
@@ -15,8 +15,15 @@
  *
  *******************************************************************************/
 
+#include <stdlib.h>
+
+#include <algorithm>
+
 #include "excl_tree.hpp"
 
+// Largest number of indexes a range check can hold
+#define EXCL_MAX_BIN_RANGE (1 << 24)
+
 int excl_tree::total_excluded = 0;
 char excl_tree::separator = '/';
 
@@ -24,15 +31,16 @@ char excl_tree::separator = '/';
  * @brief Adds a new node in the tree
  * @param s_to_add the string left to analyze
  * @param expanded mark subsequent nodes with this
+ * @return the node of the check
  */
-void excl_tree::add(string to_be_added, const node_info_t& inf, bool expanded) {
+excl_tree* excl_tree::add(string to_be_added, const node_info_t& inf, bool expanded) {
 
   // Reached end of path => we're done
   if (to_be_added.empty()) {
     this->excluded = true;
     this->expanded = expanded;
     this->inf = new node_info_t(inf);
-    return;
+    return this;
   }
 
   // Split by separator
@@ -44,11 +52,17 @@ void excl_tree::add(string to_be_added, const node_info_t& inf, bool expanded) {
   auto it = this->children.find(added);
 
   // If it doesn't exist => create it
-  if (it == this->children.end())
-    this->children[added] = new excl_tree(added);
+  if (it == this->children.end()) {
+    excl_tree *child = new excl_tree(added);
+
+    this->children[added] = child;
+
+    if (child->range_first <= child->range_last)
+      this->ranges.push_back(child);
+  }
 
   // Go to next node
-  this->children[added]->add(left, inf, expanded);
+  return this->children[added]->add(left, inf, expanded);
 }
 
 /*
@@ -72,6 +86,22 @@ excl_tree* excl_tree::find(const string &to_find) {
   if (this->children.find(added) == this->children.end()) {
     char c;
 
+    // Index of an array bin: it can be caught by a range check, the narrowest one wins
+    if (!this->ranges.empty() && left == "v/" && !added.empty()
+        && added.find_first_not_of("0123456789") == string::npos) {
+      int64_t index = atoll(added.c_str());
+      excl_tree *range = NULL;
+
+      for (excl_tree *r : this->ranges) {
+        if (index >= r->range_first && index <= r->range_last
+            && (!range || r->range_last - r->range_first < range->range_last - range->range_first))
+          range = r;
+      }
+
+      if (range)
+        return range->find(left);
+    }
+
     // See what kind of exclusion we're trying to find
     if (left.empty())
       c = to_find[0];
@@ -111,6 +141,160 @@ excl_tree* excl_tree::find(const string &to_find) {
   return this->children[added]->find(left);
 }
 
+/*
+ * @brief Tells if find() can go past this node with the given path component
+ * @param name the path component
+ */
+bool excl_tree::has_child(const string &name) const {
+
+  if (this->children.count(name))
+    return true;
+
+  // Recursive checks match any component
+  for (auto &it : this->children)
+    if (it.second->path.size() == 1)
+      return true;
+
+  return false;
+}
+
+/*
+ * @brief Tells if an item of the given location can reach a check: there is a
+ * @brief check under the location, or a recursive check on the way to it
+ * @param location path of the location, without a trailing separator
+ */
+bool excl_tree::reaches(const string &location) const {
+
+  const excl_tree *node = this;
+  size_t start = 0;
+
+  if (this->children.empty())
+    return false;
+
+  while (start < location.size()) {
+
+    // Recursive checks match any component
+    for (auto &it : node->children)
+      if (it.second->path.size() == 1)
+        return true;
+
+    size_t s = location.find(excl_tree::separator, start);
+    auto it = node->children.find(location.substr(start, s - start));
+
+    if (it == node->children.end())
+      return false;
+
+    node = it->second;
+    start = (s == string::npos) ? location.size() : s + 1;
+  }
+
+  return true;
+}
+
+/*
+ * @brief Parses an array bin range
+ * @param s the range, as "first-last"
+ * @param first receives the first index
+ * @param last receives the last index
+ * @return true if s is a valid range
+ */
+bool excl_tree::parse_range(const string &s, int64_t &first, int64_t &last) {
+  size_t dash = s.find('-');
+
+  first = 0;
+  last = -1;
+
+  if (dash == string::npos || dash == 0 || dash == s.size() - 1
+      || s.find_first_not_of("0123456789-") != string::npos || s.find('-', dash + 1) != string::npos)
+    return false;
+
+  int64_t a = atoll(s.substr(0, dash).c_str());
+  int64_t b = atoll(s.substr(dash + 1).c_str());
+
+  if (a > b || b - a >= EXCL_MAX_BIN_RANGE)
+    return false;
+
+  first = a;
+  last = b;
+
+  return true;
+}
+
+/*
+ * @brief Counts the hits of an array bin on a range check
+ * @param query the query of the bin, ending in <index>/v/
+ * @param cov_val hit count of the bin
+ */
+void excl_tree::count_bin(const string &query, int64_t cov_val) {
+
+  if (!inf || inf->bin_hits.empty() || query.size() < 4)
+    return;
+
+  size_t end = query.size() - 3;
+  size_t start = query.find_last_of(excl_tree::separator, end - 1);
+
+  start = (start == string::npos) ? 0 : start + 1;
+
+  int64_t index = atoll(query.substr(start, end - start).c_str()) - inf->bin_first;
+
+  if (index >= 0 && index < (int64_t) inf->bin_hits.size())
+    inf->bin_hits[index] += cov_val;
+}
+
+/*
+ * @brief Sets the result of a check that depends on all its hits:
+ * @brief  -> a range check is hit only if all its bins are, the uncovered ones are
+ * @brief     listed as ranges in the name
+ * @brief  -> a check with a threshold is hit only if it reaches it
+ */
+void excl_tree::close() {
+
+  if (!inf)
+    return;
+
+  if (inf->min_hits > 0 && inf->hit_count < inf->min_hits) {
+    inf->name += " (" + to_string(inf->hit_count) + " of " + to_string(inf->min_hits) + ")";
+    inf->hit_count = 0;
+  }
+
+  if (inf->bin_hits.empty())
+    return;
+
+  const vector<int64_t> &hits = inf->bin_hits;
+  int64_t first = inf->bin_first;
+  string uncovered;
+
+  for (size_t i = 0; i < hits.size(); ++i) {
+    if (hits[i])
+      continue;
+
+    // Extend to the end of the run of uncovered bins
+    size_t j = i;
+
+    while (j + 1 < hits.size() && !hits[j + 1])
+      ++j;
+
+    if (!uncovered.empty())
+      uncovered += ", ";
+
+    uncovered += to_string(first + i);
+
+    if (j > i)
+      uncovered += "-" + to_string(first + j);
+
+    i = j;
+  }
+
+  inf->name += "[" + to_string(first) + "-" + to_string(first + hits.size() - 1) + "]";
+
+  if (!uncovered.empty()) {
+    inf->name += " (bins " + uncovered + " uncovered)";
+
+    if (!inf->negated)
+      inf->hit_count = 0;
+  }
+}
+
 /*
  * @brief Printer function
  * @param s current assembled path
@@ -166,29 +350,85 @@ void excl_tree::print_hit_map(const string &s, std::ofstream & out) {
 }
 
 /*
- * @brief Generic iterator over tests. Applies f to each leaf.
- * @param f function that takes a node_info_t and returns a string
- * @param out stream to print results
+ * @brief Collects the checks of the tree, children before their parent
+ * @param out the checked items
  */
-void excl_tree::iterate(checker f, reporter& r) const {
+void excl_tree::get_checks(vector<const node_info_t*> &out) const {
+
+  for (auto it = children.begin(); it != children.end(); ++it)
+    it->second->get_checks(out);
+
+  if (excluded)
+    out.push_back(inf);
+}
+
+/*
+ * @brief Aggregates the results of the checks under this node, bottom-up.
+ * @brief Only nodes that are part of a check location are listed, the ones
+ * @brief below (lines, item names) are just counted.
+ * @param results results of the checks, in get_checks order
+ * @param next index of the next result to use
+ * @param depth number of path components down to this node
+ * @param s summary of this node, filled here
+ * @return location of one of the checks under this node, NULL if none
+ */
+const string *excl_tree::summarize(const string * const *results, size_t &next, int depth,
+    summary_node_t &s) const {
+
+  const string *location = NULL;
+
+  s.name = path;
 
   for (auto it = children.begin(); it != children.end(); ++it) {
-    it->second->iterate(f, r);
+    summary_node_t child = summary_node_t();
+    const string *child_location = it->second->summarize(results, next, depth + 1, child);
+
+    if (!child_location)
+      continue;
+
+    int scope_depth = std::count(child_location->begin(), child_location->end(), separator) + 1;
+
+    summary_add_child(s, child, depth + 1 <= scope_depth);
+    location = child_location;
   }
 
-  if (!excluded)
-    return;
+  if (excluded) {
+    summary_count(s, inf->type, *results[next++], inf->hit_count);
+    location = &inf->location;
+  }
 
-  string res = f(*inf);
+  return location;
+}
 
-  if (inf->negated) {
+/*
+ * @brief Aggregates the results of the checks in the tree, bottom-up
+ * @param results results of the checks, in get_checks order
+ * @param s summary of the tree, filled here
+ */
+void excl_tree::summarize(const string * const *results, summary_node_t &s) const {
+  size_t next = 0;
 
-    if (!res.compare("fail"))
-      res = "default";
-    else if (!res.compare("default") || res.empty())
-      res = "fail";
+  summarize(results, next, 0, s);
+}
 
-  }
+/*
+ * @brief Collects the checks under this node
+ * @param s current assembled path
+ * @param out pairs of path, node
+ */
+void excl_tree::get_leaves(const string &s, vector<pair<string, excl_tree*> > &out) {
+
+  if (excluded)
+    out.push_back(make_pair(s, this));
+
+  for (auto it = children.begin(); it != children.end(); ++it)
+    it->second->get_leaves(s + it->second->path + excl_tree::separator, out);
+}
 
-  r.format(*inf, res);
+/*
+ * @brief Collects the checks in the tree, with their paths (as given to add)
+ * @param out pairs of path, node
+ */
+void excl_tree::get_leaves(vector<pair<string, excl_tree*> > &out) {
+  get_leaves("", out);
 }
@@ -0,0 +1,142 @@
+/******************************************************************************
+ * (C) Copyright 2017 AMIQ Consulting
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *******************************************************************************/
+
+#include <algorithm>
+#include <queue>
+
+#include "excluder.hpp"
+
+#define AC_ALPHABET 256
+
+/*
+ * Adds a reference
+ * @param valid: the reference
+ * @param op: operations::equals or operations::contains
+ */
+void comment_filter::add(const string &valid, int op) {
+
+  if (op == operations::equals) {
+    exact.push_back(valid);
+    return;
+  }
+
+  // Every comment contains these
+  if (valid.empty())
+    return;
+
+  if (std::find(keywords.begin(), keywords.end(), valid) == keywords.end())
+    keywords.push_back(valid);
+}
+
+/*
+ * Builds the automaton. Call it after the last add.
+ * It is a trie of the keywords whose missing transitions are replaced by the
+ * transitions of the longest proper suffix state.
+ */
+void comment_filter::compile() {
+
+  next.assign(AC_ALPHABET, 0);
+  out.assign(1, vector<uint32_t>());
+
+  vector<int32_t> fail(1, 0);
+
+  // Trie of the keywords; 0 is also "no transition" since no edge goes back to the root
+  for (uint32_t k = 0; k < keywords.size(); ++k) {
+    int32_t state = 0;
+
+    for (size_t i = 0; i < keywords[k].size(); ++i) {
+      unsigned char c = keywords[k][i];
+
+      if (!next[state * AC_ALPHABET + c]) {
+        next[state * AC_ALPHABET + c] = out.size();
+        next.resize(next.size() + AC_ALPHABET, 0);
+        out.push_back(vector<uint32_t>());
+        fail.push_back(0);
+      }
+
+      state = next[state * AC_ALPHABET + c];
+    }
+
+    out[state].push_back(k);
+  }
+
+  // Breadth first, so suffix states are complete before they are used
+  std::queue<int32_t> q;
+
+  for (int c = 0; c < AC_ALPHABET; ++c)
+    if (next[c])
+      q.push(next[c]);
+
+  while (!q.empty()) {
+    int32_t state = q.front();
+    q.pop();
+
+    const vector<uint32_t> &inherited = out[fail[state]];
+    out[state].insert(out[state].end(), inherited.begin(), inherited.end());
+
+    for (int c = 0; c < AC_ALPHABET; ++c) {
+      int32_t &to = next[state * AC_ALPHABET + c];
+
+      if (to) {
+        fail[to] = next[fail[state] * AC_ALPHABET + c];
+        q.push(to);
+      } else {
+        to = next[fail[state] * AC_ALPHABET + c];
+      }
+    }
+  }
+
+  seen.assign(keywords.size(), 0);
+  generation = 0;
+}
+
+/*
+ * Checks a comment against all references
+ * @param val: the comment
+ * @return : true if the comment passes
+ */
+bool comment_filter::run_check(const string &val) const {
+
+  for (size_t i = 0; i < exact.size(); ++i)
+    if (val != exact[i])
+      return false;
+
+  if (keywords.empty())
+    return true;
+
+  generation++;
+
+  size_t missing = keywords.size();
+  int32_t state = 0;
+
+  for (size_t i = 0; i < val.size(); ++i) {
+    state = next[state * AC_ALPHABET + (unsigned char) val[i]];
+
+    const vector<uint32_t> &found = out[state];
+
+    for (size_t j = 0; j < found.size(); ++j) {
+      if (seen[found[j]] != generation) {
+        seen[found[j]] = generation;
+
+        if (!--missing)
+          return true;
+      }
+    }
+  }
+
+  return false;
+}
@@ -0,0 +1,159 @@
+/******************************************************************************
+ * (C) Copyright 2017 AMIQ Consulting
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *******************************************************************************/
+
+#include <stdint.h>
+
+#include <iostream>
+#include <unordered_map>
+
+#include "first_hit.hpp"
+#include "ucis_callbacks.hpp"
+#include "formatter.hpp"
+
+using std::cout;
+using std::cerr;
+using std::unordered_map;
+
+/*
+ * A check and the first UCISDB that hit it
+ */
+typedef struct {
+  string key;           // tree kind and path, see top_tree::get_leaves
+  bool expanded;
+  node_info_t initial;  // as parsed
+  node_info_t result;   // as found in the first UCISDB that hit it
+  int64_t db;           // -1 while no UCISDB hit it
+} first_hit_t;
+
+/*
+ * @brief Searches a UCISDB for the pending checks, in a trie of their own
+ * @return Number of checks resolved by the UCISDB
+ */
+static size_t search_pending(vector<first_hit_t> &checks, const vector<size_t> &pending,
+    const string &db_file, int64_t db, bool refinement_flag) {
+
+  top_tree trie;
+  unordered_map<string, size_t> ids;
+
+  for (size_t i : pending) {
+    trie.add(checks[i].key.substr(1), checks[i].key[0], checks[i].initial, checks[i].expanded);
+    ids[checks[i].key] = i;
+  }
+
+  search_db(&trie, db_file, refinement_flag);
+
+  trie.close_checks();
+
+  vector<pair<string, excl_tree*> > leaves;
+  size_t count = 0;
+
+  trie.get_leaves(leaves);
+
+  for (auto &x : leaves) {
+    const node_info_t *inf = x.second->inf;
+    auto it = ids.find(x.first);
+
+    if (it == ids.end() || !inf->found || inf->hit_count <= 0)
+      continue;
+
+    checks[it->second].result = *inf;
+    checks[it->second].db = db;
+    count++;
+  }
+
+  return count;
+}
+
+/*
+ * @brief Finds, for each check, the first UCISDB of a chronological list that hits it.
+ * @brief UCISDBs are searched in order, each one only for the checks that no earlier
+ * @brief UCISDB hit: the resolved checks are dropped from the trie searched next
+ * @brief (toggle bins are skipped once no toggle check is left). The search stops as
+ * @brief soon as every check was hit.
+ * @param trie Checks, populated by the parsers
+ * @param dbs Paths to the UCISDBs, oldest first
+ * @param refinement_flag How items are indexed (see search_callback)
+ * @param file Where the first hit of each check is listed
+ * @return 0 on success
+ */
+int first_hit_main(top_tree *trie, const vector<string> &dbs, bool refinement_flag,
+    const string &file) {
+
+  vector<pair<string, excl_tree*> > leaves;
+  vector<first_hit_t> checks;
+  vector<size_t> pending;
+
+  trie->get_leaves(leaves);
+
+  for (auto &x : leaves) {
+    first_hit_t c;
+
+    c.key = x.first;
+    c.expanded = x.second->expanded;
+    c.initial = *x.second->inf;
+    c.db = -1;
+
+    pending.push_back(checks.size());
+    checks.push_back(c);
+  }
+
+  size_t scanned = 0;
+
+  for (size_t i = 0; i < dbs.size() && !pending.empty(); ++i) {
+    size_t resolved = search_pending(checks, pending, dbs[i], i, refinement_flag);
+    size_t kept = 0;
+
+    for (size_t j : pending)
+      if (checks[j].db < 0)
+        pending[kept++] = j;
+
+    pending.resize(kept);
+    scanned++;
+
+    cout << "UCISDB #" << i << " @" << dbs[i] << ": " << resolved << " checks first hit, "
+        << pending.size() << " left\n";
+  }
+
+  out_file list(file);
+
+  if (!list.is_open()) {
+    cerr << "*CL_ERR: Could not write " << file << "!\n";
+    return 1;
+  }
+
+  out_buffer out(&list);
+
+  out.put("ucisdb\tindex\thit_count\ttype\tlocation\tname\tgenerator\tline\n");
+
+  for (auto &c : checks) {
+    const node_info_t &inf = c.db < 0 ? c.initial : c.result;
+
+    if (c.db < 0)
+      out.put("-\t-\t0\t");
+    else
+      out.put(dbs[c.db]).put('\t').put_int(c.db).put('\t').put_int(inf.hit_count).put('\t');
+
+    out.put(inf.type).put('\t').put(inf.location).put('\t').put(inf.name).put('\t');
+    out.put(inf.generator).put('\t').put_int(inf.generator_line).put('\n');
+  }
+
+  cout << checks.size() - pending.size() << " of " << checks.size() << " checks hit, "
+      << scanned << " of " << dbs.size() << " UCISDBs searched\n";
+  cout << "The first hit of each check is listed in " << file << "\n";
+
+  return 0;
+}
@@ -15,73 +15,203 @@
  *
  *******************************************************************************/
 
+#include <algorithm>
+#include <atomic>
 #include <iostream>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include "formatter.hpp"
+#include "attribution.hpp"
 
-string add_tooltip(const string& tooltip_text) {
+out_buffer &out_buffer::put_int(int64_t x) {
 
-	string rez = "<span class=tooltip>";
-	rez += tooltip_text;
-	rez += "</span>";
+	char num[24];
+	int n = snprintf(num, sizeof(num), "%lld", (long long) x);
 
-	return rez;
+	return put(num, n);
 }
 
 /*
- * Surrounds info with a html tag of your choice
+ * Writes s with the HTML special chars escaped
  */
-string format_html_add_tag(const string &s, const string &tag,
-		const string &attr) {
-	return "<" + tag + " " + attr + ">" + s + "</" + tag + ">";
+out_buffer &out_buffer::put_html(const string &s) {
+
+	size_t start = 0;
+
+	for (size_t i = 0; i < s.size(); ++i) {
+		const char *entity;
+
+		switch (s[i]) {
+		case '<':
+			entity = "&lt;";
+			break;
+		case '>':
+			entity = "&gt;";
+			break;
+		case '&':
+			entity = "&amp;";
+			break;
+		case '"':
+			entity = "&quot;";
+			break;
+		default:
+			continue;
+		}
+
+		put(s.data() + start, i - start);
+		put(entity);
+		start = i + 1;
+	}
+
+	return put(s.data() + start, s.size() - start);
 }
 
-void reporter_html::start(void) {
+/*
+ * Writes s as a JSON string (quotes included)
+ */
+out_buffer &out_buffer::put_json(const string &s) {
+
+	size_t start = 0;
+
+	put('"');
+
+	for (size_t i = 0; i < s.size(); ++i) {
+		unsigned char c = s[i];
+		char esc[8];
+
+		if (c >= 0x20 && c != '"' && c != '\\')
+			continue;
+
+		put(s.data() + start, i - start);
+		start = i + 1;
+
+		switch (c) {
+		case '"':
+			put("\\\"", 2);
+			break;
+		case '\\':
+			put("\\\\", 2);
+			break;
+		case '\n':
+			put("\\n", 2);
+			break;
+		case '\r':
+			put("\\r", 2);
+			break;
+		case '\t':
+			put("\\t", 2);
+			break;
+		default:
+			snprintf(esc, sizeof(esc), "\\u%04x", c);
+			put(esc, 6);
+			break;
+		}
+	}
 
-	report << "<!DOCTYPE html>\n";
-	report << "<html>\n";
+	put(s.data() + start, s.size() - start);
 
-	ifstream style(style_file);
-	string line;
+	return put('"');
+}
+
+/*
+ * Writes s as a CSV field, quoted only if needed
+ */
+out_buffer &out_buffer::put_csv(const string &s) {
+
+	if (s.find_first_of(",\"\r\n") == string::npos)
+		return put(s);
+
+	size_t start = 0;
+
+	put('"');
 
-	report << "<style>\n";
-	while (getline(style, line)) {
-		report << line << "\n";
+	for (size_t i = 0; i < s.size(); ++i) {
+		if (s[i] != '"')
+			continue;
+
+		// Quotes are doubled
+		put(s.data() + start, i - start + 1);
+		start = i;
 	}
-	report << "</style>\n";
 
+	put(s.data() + start, s.size() - start);
+
+	return put('"');
 }
 
-void reporter_html::title() {
+reporter_html::reporter_html(string file, bool mode, string test, uint rows_per_page) :
+		reporter(file, mode), testname(test), out(&report), rows_per_page(rows_per_page) {
 
-	string rez = "Coverage Lens report";
+	nof_pages = 1;
+	rows_in_page = 0;
+	in_table = false;
+	test_names = NULL;
 
-	if (!testname.empty())
-		rez += " for test: \"" + testname + "\"";
+	// Pages are named after the report, and compressed like it
+	index_name = file.substr(file.find_last_of('/') + 1);
+	page_prefix = file;
+	page_suffix = ".html";
+
+	if (gz_name(page_prefix)) {
+		page_prefix.erase(page_prefix.size() - 3);
+		page_suffix += ".gz";
+	}
+
+	if (page_prefix.size() > 5 && !page_prefix.compare(page_prefix.size() - 5, 5, ".html"))
+		page_prefix.erase(page_prefix.size() - 5);
+}
 
-	rez = "<head>" + rez + "</head>";
-	rez = format_html_add_tag(rez, "p", "style=\"font-size:25px\"");
-	rez = "<b>" + rez + "</b>";
+/*
+ * Page n of a paginated report, relative to the report
+ */
+string reporter_html::page_name(uint n) {
 
-	report << rez << "\n";
+	string name = page_prefix.substr(page_prefix.find_last_of('/') + 1);
 
+	return name + "_p" + to_string(n) + page_suffix;
 }
 
-void reporter_html::tree_title(string title) {
-	string header = format_html_add_tag(title, "p", "style=\"font-size:20px\"");
+void reporter_html::head(out_buffer &b) {
+	b.put("<!DOCTYPE html>\n<html>\n<style>\n").put(style).put("</style>\n");
+}
+
+void reporter_html::title(out_buffer &b) {
+
+	b.put("<b><p style=\"font-size:25px\"><head>Coverage Lens report");
 
-//  header = format_html_add_tag(header, "b");
-	header = "<b>" + header + "</b>";
+	if (!testname.empty())
+		b.put(" for test: \"").put_html(testname).put("\"");
 
-	report << header + "<br>\n";
+	b.put("</head></p></b>\n");
 }
 
-void reporter_html::tree_start() {
-	report << "<table>\n";
+void reporter_html::table_start(out_buffer &b) {
+
+	b.put("<b><p style=\"font-size:20px\">").put_html(tree_name).put("</p></b><br>\n");
+
+	b.put("<table>\n<tr>\n");
+
+	for (int i = 0; i < headers.size(); ++i)
+		b.put("<th>").put(headers[i]).put("</th>\n");
+
+	b.put("</tr>\n");
+	in_table = true;
+}
 
-	report << "<tr>\n";
+void reporter_html::footer(out_buffer &b) {
+	b.put("<br>\n<div class=\"topcorner\"> Failed checks: ").put_int(err_count).put("</div>\n");
+	b.put("</html>\n");
+}
+
+void reporter_html::start(void) {
+
+	ifstream style_in(style_file);
+	string line;
+
+	while (getline(style_in, line))
+		style += line + "\n";
 
 	if (headers.empty()) {
 		headers.push_back("Type");
@@ -91,49 +221,232 @@ void reporter_html::tree_start() {
 		headers.push_back("Hit count");
 	}
 
-	for (int i = 0; i < headers.size(); ++i) {
-		report << "<th>" << headers[i] << "</th>\n";
+	if (!rows_per_page)
+		head(out);
+}
+
+void reporter_html::title() {
+	if (!rows_per_page)
+		title(out);
+}
+
+void reporter_html::tree_title(string title) {
+
+	tree_name = title;
+
+	if (rows_per_page) {
+		summaries.push_back(make_pair(title, vector<scope_summary_t>()));
+		summary_index.clear();
 	}
-	report << "</tr>\n";
+}
 
+void reporter_html::tree_start() {
+	table_start(rows_per_page ? page : out);
 }
 
 void reporter_html::tree_end() {
-	report << "</table>";
+	(rows_per_page ? page : out).put("</table>");
+	in_table = false;
+}
+
+/*
+ * Starts page n in b
+ */
+void reporter_html::open_page(out_buffer &b, uint n) {
+
+	head(b);
+	title(b);
+
+	b.put("<p><a href=\"").put(index_name).put("\">Index</a>");
+
+	if (n > 1)
+		b.put(" <a href=\"").put(page_name(n - 1)).put("\">Previous</a>");
+
+	b.put("</p>\n");
+}
+
+/*
+ * Ends the current page and writes it out
+ */
+void reporter_html::close_page(bool last) {
+
+	if (in_table)
+		page.put("</table>");
+
+	page.put("<p>");
+	if (!last)
+		page.put("<a href=\"").put(page_name(nof_pages + 1)).put("\">Next</a>");
+	page.put("</p>\n</html>\n");
+
+	page.flush();
+	page.attach(NULL);
+	page_file.close();
+}
+
+/*
+ * Moves the rows that follow to a new page
+ */
+void reporter_html::next_page() {
+
+	// The first page was kept in memory in case it was the only one
+	if (!page.attached()) {
+		page_file.open(page_prefix + "_p1" + page_suffix);
+
+		out_buffer first(&page_file);
+		open_page(first, 1);
+		first.flush();
+
+		page.attach(&page_file);
+	}
+
+	close_page(false);
+
+	nof_pages++;
+	rows_in_page = 0;
+
+	page_file.open(page_prefix + "_p" + to_string(nof_pages) + page_suffix);
+	page.attach(&page_file);
+	open_page(page, nof_pages);
+
+	if (in_table)
+		table_start(page);
+}
+
+/*
+ * Counts a row in the summary of its location
+ */
+void reporter_html::add_summary(const node_info_t& inf, const string &class_name) {
+
+	vector<scope_summary_t> &tree = summaries.back().second;
+	auto it = summary_index.find(inf.location);
+	size_t i;
+
+	if (it == summary_index.end()) {
+		scope_summary_t sum = { inf.location, 0, 0, 0, nof_pages, nof_pages };
+
+		i = tree.size();
+		tree.push_back(sum);
+		summary_index[inf.location] = i;
+	} else {
+		i = it->second;
+	}
+
+	tree[i].items++;
+	tree[i].failed += !class_name.compare("fail");
+	tree[i].missing += !class_name.compare("missing");
+	tree[i].last_page = nof_pages;
+}
+
+/*
+ * Index of a paginated report: one summary row per location
+ */
+void reporter_html::write_index() {
+
+	head(out);
+	title(out);
+
+	for (auto &tree : summaries) {
+
+		if (tree.second.empty())
+			continue;
+
+		out.put("<b><p style=\"font-size:20px\">").put_html(tree.first).put("</p></b><br>\n");
+		out.put("<table>\n<tr>\n<th>Location</th>\n<th>Items</th>\n<th>Failed</th>\n");
+		out.put("<th>Missing</th>\n<th>Pages</th>\n</tr>\n");
+
+		for (auto &sum : tree.second) {
+			const char *class_name = sum.failed ? "fail" : (sum.missing ? "missing" : "default");
+
+			out.put("<tr class=\"").put(class_name).put("\">\n");
+			out.put("<td>").put_html(sum.location).put("</td>\n");
+			out.put("<td>").put_int(sum.items).put("</td>\n");
+			out.put("<td>").put_int(sum.failed).put("</td>\n");
+			out.put("<td>").put_int(sum.missing).put("</td>\n");
+			out.put("<td>");
+
+			for (uint p = sum.first_page; p <= sum.last_page; ++p)
+				out.put("<a href=\"").put(page_name(p)).put("\">").put_int(p).put("</a> ");
+
+			out.put("</td>\n</tr>\n");
+		}
+
+		out.put("</table>");
+	}
+
+	footer(out);
 }
 
 void reporter_html::end() {
-	report << "<br>\n";
-	report
-			<< "<div class=\"topcorner\"> Failed checks: "
-					+ to_string(err_count) + "</div>\n";
-	report << "</html>\n";
+
+	if (!rows_per_page) {
+		footer(out);
+		out.flush();
+		return;
+	}
+
+	// Everything fit on one page: write it as a single report
+	if (!page.attached()) {
+		head(out);
+		title(out);
+		out.put(page.data());
+		page.clear();
+		footer(out);
+		out.flush();
+		return;
+	}
+
+	close_page(true);
+	write_index();
+	out.flush();
 }
 
-void reporter_html::add_row(const node_info_t& inf) {
+void reporter_html::add_row(out_buffer &b, const node_info_t& inf, const string &class_name) const {
+
+	if (!class_name.empty())
+		b.put("<tr class=\"").put(class_name).put("\">\n");
+	else
+		b.put("<tr>\n");
 
-	report << "<td>" + inf.type + "</td>";
-	report << "<td>" + to_string(inf.line) + "</td>\n";
-	report << "<td>" + inf.name + "</td>\n";
-	report << "<td>" + inf.location + "</td>\n";
+	b.put("<td>").put_html(inf.type).put("</td>");
+	b.put("<td>").put_int(inf.line).put("</td>\n");
+	b.put("<td>").put_html(inf.name).put("</td>\n");
+	b.put("<td>").put_html(inf.location).put("</td>\n");
 #ifdef QUESTA
-  report << "<td style=\"text-align:right;\">" + to_string(inf.hit_count / 2);
+	b.put("<td style=\"text-align:right;\">").put_int(inf.hit_count / 2);
 #endif
 #ifdef NCSIM
-  report << "<td style=\"text-align:right;\">" + to_string(inf.hit_count);
+	b.put("<td style=\"text-align:right;\">").put_int(inf.hit_count);
 #endif
 
+	bool tests = test_names && !inf.tests.empty();
+
+	if (!inf.generator.empty() || !inf.comment.empty() || tests)
+		b.put("<span class=tooltip>");
+
 	if (!inf.generator.empty()) {
-		report
-				<< add_tooltip(
-						"From file ./" + inf.generator + ", line "
-								+ to_string(inf.generator_line));
+		b.put("From file ./").put_html(inf.generator);
+		b.put(", line ").put_int(inf.generator_line);
 	} else if (!inf.comment.empty()) {
-		report << add_tooltip(inf.comment);
+		b.put_html(inf.comment);
 	}
 
-	report << "</td>\n";
+	if (tests) {
+		if (!inf.generator.empty() || !inf.comment.empty())
+			b.put("<br>");
+
+		b.put("Hit by ");
 
+		for (size_t i = 0; i < inf.tests.size() && i < ATTRIBUTION_MAX_LISTED; ++i)
+			b.put(i ? ", " : "").put_html((*test_names)[inf.tests[i]]);
+
+		if (inf.tests.size() > ATTRIBUTION_MAX_LISTED)
+			b.put(" and ").put_int(inf.tests.size() - ATTRIBUTION_MAX_LISTED).put(" more");
+	}
+
+	if (!inf.generator.empty() || !inf.comment.empty() || tests)
+		b.put("</span>");
+
+	b.put("</td>\n</tr>\n");
 }
 
 void reporter_html::format(const node_info_t& inf, const string &class_name) {
@@ -141,37 +454,66 @@ void reporter_html::format(const node_info_t& inf, const string &class_name) {
 	if (class_name.compare("fail") == 0)
 		err_count++;
 
-	if (!class_name.empty())
-		report << "<tr class=\"" << class_name << "\">\n";
-	else
-		report << "<tr>\n";
+	if (!rows_per_page) {
+		add_row(out, inf, class_name);
+		return;
+	}
 
-	add_row(inf);
+	if (rows_in_page == rows_per_page)
+		next_page();
+
+	rows_in_page++;
+	add_row(page, inf, class_name);
+	add_summary(inf, class_name);
+}
 
-	report << "</tr>\n";
+void reporter_html::format_rows(out_buffer &b, vector<size_t> &ends, const node_info_t * const *infos,
+		const string * const *results, size_t n) const {
 
+	for (size_t i = 0; i < n; ++i) {
+		add_row(b, *infos[i], *results[i]);
+		ends.push_back(b.data().size());
+	}
 }
 
-void reporter_html::format_default(const node_info_t& inf) {
+/*
+ * Same as format, for rows formatted by format_rows
+ */
+void reporter_html::append_rows(const out_buffer &b, const vector<size_t> &ends,
+		const node_info_t * const *infos, const string * const *results, size_t n) {
 
-	report << "<tr class=\"default\">\n";
-	add_row(inf);
-	report << "</tr>\n";
+	for (size_t i = 0; i < n; ++i)
+		if (results[i]->compare("fail") == 0)
+			err_count++;
 
-}
-;
+	if (!rows_per_page) {
+		out.put(b.data());
+		return;
+	}
 
-void reporter_html::format_fail(const node_info_t& inf) {
+	size_t start = 0;
+
+	for (size_t i = 0; i < n; ++i) {
+
+		if (rows_in_page == rows_per_page)
+			next_page();
+
+		rows_in_page++;
+		page.put(b.data().data() + start, ends[i] - start);
+		add_summary(*infos[i], *results[i]);
+		start = ends[i];
+	}
+}
 
-	err_count++;
-	report << "<tr class=\"fail\">\n";
-	add_row(inf);
-	report << "</tr>\n";
+void reporter_html::format_default(const node_info_t& inf) {
+	format(inf, "default");
+}
 
+void reporter_html::format_fail(const node_info_t& inf) {
+	format(inf, "fail");
 }
-;
 
-string reporter_log::get_string_kind() {
+string reporter_log::get_string_kind() const {
 
 	if (kind == 'd')
 		return "unit";
@@ -181,7 +523,7 @@ string reporter_log::get_string_kind() {
 	return "file";
 }
 
-string reporter_log::assemble_info(const node_info_t& inf,const string &class_name) {
+string reporter_log::assemble_info(const node_info_t& inf,const string &class_name) const {
 
 	string result;
 	result += get_string_kind();
@@ -214,6 +556,33 @@ void reporter_log::format_fail(const node_info_t& inf, const string &class_name)
 	report << assemble_info(inf,class_name) << "\n";
 }
 
+void reporter_log::format_rows(out_buffer &b, vector<size_t> &ends, const node_info_t * const *infos,
+		const string * const *results, size_t n) const {
+
+	for (size_t i = 0; i < n; ++i) {
+		const string &class_name = *results[i];
+
+		if (class_name.compare("fail") == 0)
+			b.put("*CL_ITEM_NOT_COVERED_ERR in ").put(assemble_info(*infos[i], class_name)).put('\n');
+		else if (class_name.compare("missing") == 0)
+			b.put("*CL_ITEM_NOT_FOUND_ERR in ").put(assemble_info(*infos[i], class_name)).put('\n');
+
+		ends.push_back(b.data().size());
+	}
+}
+
+/*
+ * Same as format, for rows formatted by format_rows
+ */
+void reporter_log::append_rows(const out_buffer &b, const vector<size_t> &ends,
+		const node_info_t * const *infos, const string * const *results, size_t n) {
+
+	for (size_t i = 0; i < n; ++i)
+		if (results[i]->compare("fail") == 0 || results[i]->compare("missing") == 0)
+			err_count++;
+
+	report.write(b.data().data(), b.data().size());
+}
 
 void reporter_log::start() {
 	if (!testname.empty())
@@ -228,3 +597,195 @@ void reporter_log::end() {
 
 }
 
+const char *reporter_records::get_string_kind() const {
+
+	if (kind == 'd')
+		return "unit";
+	else if (kind == 's')
+		return "instance";
+
+	return "file";
+}
+
+void reporter_records::format(const node_info_t& inf, const string &class_name) {
+
+	if (class_name.compare("fail") == 0)
+		err_count++;
+
+	put_record(out, inf, class_name);
+}
+
+void reporter_records::format_rows(out_buffer &b, vector<size_t> &ends, const node_info_t * const *infos,
+		const string * const *results, size_t n) const {
+
+	for (size_t i = 0; i < n; ++i) {
+		put_record(b, *infos[i], *results[i]);
+		ends.push_back(b.data().size());
+	}
+}
+
+/*
+ * Same as format, for rows formatted by format_rows
+ */
+void reporter_records::append_rows(const out_buffer &b, const vector<size_t> &ends,
+		const node_info_t * const *infos, const string * const *results, size_t n) {
+
+	for (size_t i = 0; i < n; ++i)
+		if (results[i]->compare("fail") == 0)
+			err_count++;
+
+	out.put(b.data());
+}
+
+void reporter_jsonl::put_record(out_buffer &b, const node_info_t& inf, const string &class_name) const {
+
+	b.put("{\"kind\":\"").put(get_string_kind());
+	b.put("\",\"type\":").put_json(inf.type);
+	b.put(",\"line\":").put_int(inf.line);
+	b.put(",\"name\":").put_json(inf.name);
+	b.put(",\"location\":").put_json(inf.location);
+	b.put(",\"hit_count\":").put_int(inf.hit_count);
+	b.put(",\"status\":").put_json(class_name.empty() ? "default" : class_name);
+	b.put(",\"generator\":").put_json(inf.generator);
+	b.put(",\"generator_line\":").put_int(inf.generator_line);
+	b.put(",\"comment\":").put_json(inf.comment);
+	b.put("}\n");
+}
+
+void reporter_csv::start() {
+	out.put("kind,type,line,name,location,hit_count,status,generator,generator_line,comment\n");
+}
+
+void reporter_csv::put_record(out_buffer &b, const node_info_t& inf, const string &class_name) const {
+
+	b.put(get_string_kind()).put(',');
+	b.put_csv(inf.type).put(',');
+	b.put_int(inf.line).put(',');
+	b.put_csv(inf.name).put(',');
+	b.put_csv(inf.location).put(',');
+	b.put_int(inf.hit_count).put(',');
+	b.put_csv(class_name.empty() ? "default" : class_name).put(',');
+	b.put_csv(inf.generator).put(',');
+	b.put_int(inf.generator_line).put(',');
+	b.put_csv(inf.comment).put('\n');
+}
+
+void reporter_fanout::start() {
+	for (uint i = 0; i < sinks.size(); ++i)
+		sinks[i]->start();
+}
+
+void reporter_fanout::title() {
+	for (uint i = 0; i < sinks.size(); ++i)
+		sinks[i]->title();
+}
+
+void reporter_fanout::tree_title(string title) {
+	for (uint i = 0; i < sinks.size(); ++i) {
+		sinks[i]->kind = kind;
+		sinks[i]->tree_title(title);
+	}
+}
+
+void reporter_fanout::tree_start() {
+	for (uint i = 0; i < sinks.size(); ++i) {
+		sinks[i]->kind = kind;
+		sinks[i]->tree_start();
+	}
+}
+
+void reporter_fanout::tree_end() {
+	for (uint i = 0; i < sinks.size(); ++i)
+		sinks[i]->tree_end();
+}
+
+void reporter_fanout::end() {
+	for (uint i = 0; i < sinks.size(); ++i)
+		sinks[i]->end();
+}
+
+void reporter_fanout::format(const node_info_t& inf, const string &class_name) {
+
+	if (class_name.compare("fail") == 0)
+		err_count++;
+
+	for (uint i = 0; i < sinks.size(); ++i)
+		sinks[i]->format(inf, class_name);
+}
+
+/*
+ * Formats the rows of the sinks that support it on worker threads, a
+ * window of chunks at a time to bound memory, while the calling thread
+ * feeds the other sinks. Chunks are then appended in order.
+ */
+void reporter_fanout::format_batch(const node_info_t * const *infos, const string * const *results,
+		size_t n) {
+
+	for (size_t i = 0; i < n; ++i)
+		if (results[i]->compare("fail") == 0)
+			err_count++;
+
+	vector<reporter*> par;
+	vector<reporter*> ser;
+
+	for (uint i = 0; i < sinks.size(); ++i) {
+		sinks[i]->kind = kind;
+
+		if (jobs > 1 && n > FORMAT_CHUNK && sinks[i]->parallel())
+			par.push_back(sinks[i]);
+		else
+			ser.push_back(sinks[i]);
+	}
+
+	if (par.empty()) {
+		for (uint i = 0; i < ser.size(); ++i)
+			ser[i]->format_batch(infos, results, n);
+		return;
+	}
+
+	size_t window = (size_t) jobs * 4 * FORMAT_CHUNK;
+	size_t nof_chunks = window / FORMAT_CHUNK;
+	vector<out_buffer> bufs(par.size() * nof_chunks);
+	vector<vector<size_t> > ends(bufs.size());
+
+	for (size_t first = 0; first < n; first += window) {
+		size_t rows = std::min(window, n - first);
+		size_t chunks = (rows + FORMAT_CHUNK - 1) / FORMAT_CHUNK;
+		size_t tasks = par.size() * chunks;
+		std::atomic<size_t> next(0);
+
+		// Task t is chunk t % chunks of sink t / chunks
+		auto work = [&]() {
+			size_t t;
+
+			while ((t = next++) < tasks) {
+				size_t start = first + (t % chunks) * FORMAT_CHUNK;
+				size_t len = std::min((size_t) FORMAT_CHUNK, n - start);
+
+				bufs[t].clear();
+				ends[t].clear();
+				par[t / chunks]->format_rows(bufs[t], ends[t], infos + start, results + start, len);
+			}
+		};
+
+		vector<std::thread> workers;
+
+		for (uint i = 1; i < jobs && i < tasks; ++i)
+			workers.push_back(std::thread(work));
+
+		for (uint i = 0; i < ser.size(); ++i)
+			ser[i]->format_batch(infos + first, results + first, rows);
+
+		work();
+
+		for (uint i = 0; i < workers.size(); ++i)
+			workers[i].join();
+
+		for (size_t t = 0; t < tasks; ++t) {
+			size_t start = first + (t % chunks) * FORMAT_CHUNK;
+			size_t len = std::min((size_t) FORMAT_CHUNK, n - start);
+
+			par[t / chunks]->append_rows(bufs[t], ends[t], infos + start, results + start, len);
+		}
+	}
+}
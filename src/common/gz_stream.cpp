@@ -0,0 +1,243 @@
+/******************************************************************************
+ * (C) Copyright 2017 AMIQ Consulting
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *******************************************************************************/
+
+#include <string.h>
+
+#include <utility>
+
+#include "gz_stream.hpp"
+
+/*
+ * @brief Opens file for writing and starts the compressor
+ * @return true on success
+ */
+bool gz_streambuf::open(const string &name, bool append) {
+
+  close();
+
+  file = fopen(name.c_str(), append ? "ab" : "wb");
+
+  if (!file)
+    return false;
+
+  // 15 + 16: largest window, with a gzip header and trailer
+  memset(&zs, 0, sizeof(zs));
+
+  if (deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+    fclose(file);
+    file = NULL;
+    return false;
+  }
+
+  failed = false;
+  done = false;
+
+  block.resize(GZ_BLOCK_SIZE);
+  setp(&block[0], &block[0] + block.size());
+
+  worker = std::thread(&gz_streambuf::compress, this);
+
+  return true;
+}
+
+/*
+ * @brief Queues the put area for the compressor and starts a new one
+ */
+void gz_streambuf::hand_off() {
+
+  size_t n = pptr() - pbase();
+
+  if (!n)
+    return;
+
+  block.resize(n);
+
+  std::unique_lock<std::mutex> lock(mtx);
+
+  space.wait(lock, [this] { return queue.size() < GZ_QUEUE_BLOCKS; });
+  queue.push_back(std::move(block));
+
+  if (!spare.empty()) {
+    block = std::move(spare.back());
+    spare.pop_back();
+  } else {
+    block = string();
+  }
+
+  lock.unlock();
+  ready.notify_one();
+
+  block.resize(GZ_BLOCK_SIZE);
+  setp(&block[0], &block[0] + block.size());
+}
+
+int gz_streambuf::overflow(int c) {
+
+  if (!file)
+    return traits_type::eof();
+
+  hand_off();
+
+  if (c != traits_type::eof()) {
+    *pptr() = (char) c;
+    pbump(1);
+  }
+
+  return traits_type::not_eof(c);
+}
+
+/*
+ * @brief Hands over what was written so far. The data reaches the file once
+ * @brief the compressor gets to it, close() waits for that.
+ */
+int gz_streambuf::sync() {
+
+  if (!file)
+    return -1;
+
+  hand_off();
+
+  return 0;
+}
+
+/*
+ * @brief Deflates len bytes and writes the compressed output
+ */
+void gz_streambuf::deflate_block(const char *data, size_t len, int flush, vector<char> &out) {
+
+  zs.next_in = (Bytef *) data;
+  zs.avail_in = len;
+
+  do {
+    zs.next_out = (Bytef *) out.data();
+    zs.avail_out = out.size();
+
+    deflate(&zs, flush);
+
+    size_t have = out.size() - zs.avail_out;
+
+    if (fwrite(out.data(), 1, have, file) != have)
+      failed = true;
+  } while (zs.avail_out == 0);
+}
+
+/*
+ * @brief Body of the compressor thread: deflates the queued blocks in order
+ * @brief until close() is called, then ends the gzip member
+ */
+void gz_streambuf::compress() {
+
+  vector<char> out(GZ_BLOCK_SIZE);
+  std::unique_lock<std::mutex> lock(mtx);
+
+  while (true) {
+    ready.wait(lock, [this] { return !queue.empty() || done; });
+
+    if (queue.empty())
+      break;
+
+    string in = std::move(queue.front());
+    queue.pop_front();
+
+    lock.unlock();
+    space.notify_one();
+
+    deflate_block(in.data(), in.size(), Z_NO_FLUSH, out);
+
+    lock.lock();
+    spare.push_back(std::move(in));
+  }
+
+  lock.unlock();
+
+  deflate_block(NULL, 0, Z_FINISH, out);
+}
+
+/*
+ * @brief Compresses what is left, ends the gzip member and closes the file
+ * @return true if everything was written
+ */
+bool gz_streambuf::close() {
+
+  if (!file)
+    return true;
+
+  hand_off();
+
+  {
+    std::lock_guard<std::mutex> lock(mtx);
+    done = true;
+  }
+
+  ready.notify_one();
+  worker.join();
+
+  deflateEnd(&zs);
+
+  if (fclose(file))
+    failed = true;
+
+  file = NULL;
+  setp(NULL, NULL);
+  block.clear();
+  spare.clear();
+
+  return !failed;
+}
+
+void out_file::open(const string &name, bool append) {
+
+  close();
+
+  compressed = gz_name(name);
+
+  bool ok;
+
+  if (compressed)
+    ok = gz.open(name, append);
+  else
+    ok = plain.open(name, std::ios_base::out | (append ? std::ios_base::app : std::ios_base::trunc));
+
+  if (!ok) {
+    setstate(std::ios_base::failbit);
+    return;
+  }
+
+  if (compressed)
+    rdbuf(&gz);
+  else
+    rdbuf(&plain);
+}
+
+void out_file::close() {
+
+  if (!is_open())
+    return;
+
+  // Flush what the stream holds before the buffer goes away
+  flush();
+
+  bool ok;
+
+  if (compressed)
+    ok = gz.close();
+  else
+    ok = plain.close();
+
+  if (!ok)
+    setstate(std::ios_base::failbit);
+}
@@ -0,0 +1,792 @@
+/******************************************************************************
+ * (C) Copyright 2017 AMIQ Consulting
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *******************************************************************************/
+
+#include <string.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <unordered_map>
+
+#include "incremental.hpp"
+#include "ucis_callbacks.hpp"
+
+using std::ifstream;
+using std::ofstream;
+using std::unordered_map;
+
+// Debug info
+static bool debug_switch;
+static ofstream debug_log;
+
+static const char items_magic[8] = { 'C', 'L', 'I', 'T', 'E', 'M', 'S', '3' };
+static const char results_magic[8] = { 'C', 'L', 'R', 'S', 'L', 'T', 'S', '3' };
+
+/*
+ * Identifies the state of a UCISDB: files made for another state are ignored
+ */
+typedef struct {
+  uint64_t mtime;
+  uint64_t size;
+  uint8_t refinement;
+  uint8_t toggles;    // toggle bins were searched (they are skipped without toggle checks)
+} db_stamp_t;
+
+/*
+ * What a check got from one UCISDB.
+ * sig holds what the check itself set before the search (type and name).
+ */
+typedef struct {
+  string sig;
+  bool found;
+  int64_t times_hit;
+  int64_t hit_count;
+  string name;
+  uint32_t line;
+  string type;
+  vector<int64_t> bin_hits;
+  map<string, toggle_bits_t> toggle_bits;
+} check_result_t;
+
+/*
+ * A check from the trie, with what it had before any UCISDB was searched
+ */
+typedef struct {
+  string key;
+  excl_tree *node;
+  node_info_t initial;
+} check_leaf_t;
+
+/**
+ * @brief FNV-1a hash, used to name the files of a UCISDB
+ */
+static uint64_t fnv1a(const string &s) {
+  uint64_t hash = 0xcbf29ce484222325ULL;
+
+  for (size_t i = 0; i < s.size(); ++i) {
+    hash ^= (unsigned char) s[i];
+    hash *= 0x100000001b3ULL;
+  }
+
+  return hash;
+}
+
+/**
+ * @brief Path of a state file of a UCISDB
+ */
+static string state_path(const string &cache_dir, const string &db_file, const char *ext) {
+  char name[40];
+
+  snprintf(name, sizeof(name), "db_%016llx.%s", (unsigned long long) fnv1a(db_file), ext);
+
+  return cache_dir + "/" + name;
+}
+
+static void write_str(ofstream &out, const string &s) {
+  uint32_t len = s.size();
+
+  out.write((const char *) &len, sizeof(len));
+  out.write(s.data(), len);
+}
+
+static bool read_str(ifstream &in, string &s) {
+  uint32_t len;
+
+  if (!in.read((char *) &len, sizeof(len)))
+    return false;
+
+  s.resize(len);
+
+  return len == 0 || in.read(&s[0], len);
+}
+
+template<typename T>
+static void write_pod(ofstream &out, const T &x) {
+  out.write((const char *) &x, sizeof(x));
+}
+
+template<typename T>
+static bool read_pod(ifstream &in, T &x) {
+  return (bool) in.read((char *) &x, sizeof(x));
+}
+
+static void write_hits(ofstream &out, const vector<int64_t> &v) {
+  uint32_t len = v.size();
+
+  out.write((const char *) &len, sizeof(len));
+  out.write((const char *) v.data(), len * sizeof(int64_t));
+}
+
+static bool read_hits(ifstream &in, vector<int64_t> &v) {
+  uint32_t len;
+
+  if (!in.read((char *) &len, sizeof(len)))
+    return false;
+
+  v.resize(len);
+
+  return len == 0 || in.read((char *) v.data(), len * sizeof(int64_t));
+}
+
+static void write_toggles(ofstream &out, const map<string, toggle_bits_t> &m) {
+  uint32_t len = m.size();
+
+  out.write((const char *) &len, sizeof(len));
+
+  for (auto &x : m) {
+    uint32_t words = x.second.words.size();
+
+    write_str(out, x.first);
+    write_pod(out, x.second.low);
+    write_pod(out, x.second.high);
+    write_pod(out, words);
+    out.write((const char *) x.second.words.data(), words * sizeof(uint64_t));
+  }
+}
+
+static bool read_toggles(ifstream &in, map<string, toggle_bits_t> &m) {
+  uint32_t len;
+
+  if (!in.read((char *) &len, sizeof(len)))
+    return false;
+
+  for (uint32_t i = 0; i < len; ++i) {
+    string signal;
+    toggle_bits_t t;
+    uint32_t words;
+
+    if (!read_str(in, signal) || !read_pod(in, t.low) || !read_pod(in, t.high)
+        || !read_pod(in, words))
+      return false;
+
+    t.words.resize(words);
+
+    if (words && !in.read((char *) t.words.data(), words * sizeof(uint64_t)))
+      return false;
+
+    m[signal] = t;
+  }
+
+  return true;
+}
+
+/**
+ * @brief Writes the header of a state file
+ */
+static void write_header(ofstream &out, const char *magic, const db_stamp_t &stamp) {
+  out.write(magic, 8);
+  write_pod(out, stamp.mtime);
+  write_pod(out, stamp.size);
+  write_pod(out, stamp.refinement);
+  write_pod(out, stamp.toggles);
+}
+
+/**
+ * @brief Reads the header of a state file
+ * @return true if the file matches the UCISDB in its current state and has the
+ * @return toggle bins, if they are needed
+ */
+static bool read_header(ifstream &in, const char *magic, const db_stamp_t &stamp) {
+  char m[8];
+  db_stamp_t s;
+
+  in.read(m, sizeof(m));
+  read_pod(in, s.mtime);
+  read_pod(in, s.size);
+  read_pod(in, s.refinement);
+  read_pod(in, s.toggles);
+
+  return in && !memcmp(m, magic, sizeof(m)) && s.mtime == stamp.mtime && s.size == stamp.size
+      && s.refinement == stamp.refinement && s.toggles >= stamp.toggles;
+}
+
+/**
+ * @brief Loads the items of a UCISDB
+ * @return 0 on success, -1 if there is no usable file
+ */
+static int load_items(const string &file, const db_stamp_t &stamp, item_record_t &record) {
+
+  ifstream in(file, ifstream::in | ifstream::binary);
+  vector<check_item_t> &items = record.items;
+  uint64_t count;
+
+  if (!in.good() || !read_header(in, items_magic, stamp))
+    return -1;
+
+  for (int t = 0; t < 3; ++t) {
+    if (!read_pod(in, count))
+      return -1;
+
+    for (uint64_t i = 0; i < count; ++i) {
+      string location;
+
+      if (!read_str(in, location))
+        return -1;
+
+      record.skipped[t].insert(record.skipped[t].end(), location);
+    }
+  }
+
+  if (!read_pod(in, count))
+    return -1;
+
+  items.resize(count);
+
+  for (uint64_t i = 0; i < count; ++i) {
+    check_item_t &item = items[i];
+    int8_t select;
+
+    if (!read_pod(in, select))
+      return -1;
+
+    item.select = select;
+
+    for (int j = 0; j < (item.select ? 1 : 3); ++j)
+      if (!read_str(in, item.queries[j]))
+        return -1;
+
+    if (!read_pod(in, item.cov_val) || !read_str(in, item.name) || !read_pod(in, item.line)
+        || !read_str(in, item.type))
+      return -1;
+  }
+
+  return 0;
+}
+
+/**
+ * @brief Stores the items of a UCISDB, after the locations of the ones left out
+ */
+static void store_items(const string &file, const db_stamp_t &stamp,
+    const item_record_t &record) {
+
+  ofstream out(file, ofstream::out | ofstream::binary);
+
+  if (!out.good()) {
+    cerr << "Could not write incremental state " << file << "!\n";
+    return;
+  }
+
+  write_header(out, items_magic, stamp);
+
+  for (int t = 0; t < 3; ++t) {
+    write_pod(out, (uint64_t) record.skipped[t].size());
+
+    for (auto &location : record.skipped[t])
+      write_str(out, location);
+  }
+
+  write_pod(out, (uint64_t) record.items.size());
+
+  for (auto &item : record.items) {
+    write_pod(out, (int8_t) item.select);
+
+    for (int j = 0; j < (item.select ? 1 : 3); ++j)
+      write_str(out, item.queries[j]);
+
+    write_pod(out, item.cov_val);
+    write_str(out, item.name);
+    write_pod(out, item.line);
+    write_str(out, item.type);
+  }
+}
+
+/**
+ * @brief Loads the check results of a UCISDB
+ * @return 0 on success, -1 if there is no usable file
+ */
+static int load_results(const string &file, const db_stamp_t &stamp,
+    unordered_map<string, check_result_t> &results) {
+
+  ifstream in(file, ifstream::in | ifstream::binary);
+  uint64_t count;
+
+  if (!in.good() || !read_header(in, results_magic, stamp) || !read_pod(in, count))
+    return -1;
+
+  results.reserve(count);
+
+  for (uint64_t i = 0; i < count; ++i) {
+    string key;
+    check_result_t res;
+    uint8_t found;
+
+    if (!read_str(in, key) || !read_str(in, res.sig) || !read_pod(in, found)
+        || !read_pod(in, res.times_hit) || !read_pod(in, res.hit_count) || !read_str(in, res.name)
+        || !read_pod(in, res.line) || !read_str(in, res.type) || !read_hits(in, res.bin_hits)
+        || !read_toggles(in, res.toggle_bits))
+      return -1;
+
+    res.found = found;
+    results[key] = res;
+  }
+
+  return 0;
+}
+
+/**
+ * @brief Stores the check results of a UCISDB
+ */
+static void store_results(const string &file, const db_stamp_t &stamp,
+    const vector<check_leaf_t> &leaves, const vector<check_result_t> &results) {
+
+  ofstream out(file, ofstream::out | ofstream::binary);
+
+  if (!out.good()) {
+    cerr << "Could not write incremental state " << file << "!\n";
+    return;
+  }
+
+  write_header(out, results_magic, stamp);
+  write_pod(out, (uint64_t) leaves.size());
+
+  for (size_t i = 0; i < leaves.size(); ++i) {
+    const check_result_t &res = results[i];
+
+    write_str(out, leaves[i].key);
+    write_str(out, res.sig);
+    write_pod(out, (uint8_t) res.found);
+    write_pod(out, res.times_hit);
+    write_pod(out, res.hit_count);
+    write_str(out, res.name);
+    write_pod(out, res.line);
+    write_str(out, res.type);
+    write_hits(out, res.bin_hits);
+    write_toggles(out, res.toggle_bits);
+  }
+}
+
+/**
+ * @brief What a check sets itself before the search; a change means a new check
+ */
+static string leaf_sig(const node_info_t &inf) {
+  return inf.type + '\t' + inf.name;
+}
+
+/**
+ * @brief Brings a check back to its state before any search
+ */
+static void reset_leaf(const check_leaf_t &leaf) {
+  leaf.node->found = false;
+  leaf.node->times_hit = 0;
+  *leaf.node->inf = leaf.initial;
+}
+
+/**
+ * @brief Returns what a check got from the searches since the last reset
+ */
+static check_result_t get_result(const check_leaf_t &leaf) {
+  check_result_t res;
+
+  res.sig = leaf_sig(leaf.initial);
+  res.found = leaf.node->found;
+  res.times_hit = leaf.node->times_hit;
+  res.hit_count = leaf.node->inf->hit_count;
+  res.name = leaf.node->inf->name;
+  res.line = leaf.node->inf->line;
+  res.type = leaf.node->inf->type;
+  res.bin_hits = leaf.node->inf->bin_hits;
+  res.toggle_bits = leaf.node->inf->toggle_bits;
+
+  return res;
+}
+
+/**
+ * @brief Sets a stored result on a check
+ */
+static void set_result(const check_leaf_t &leaf, const check_result_t &res) {
+  leaf.node->found = res.found;
+  leaf.node->times_hit = res.times_hit;
+  leaf.node->inf->found = res.found;
+  leaf.node->inf->hit_count = res.hit_count;
+  leaf.node->inf->name = res.name;
+  leaf.node->inf->line = res.line;
+  leaf.node->inf->type = res.type;
+  leaf.node->inf->bin_hits = res.bin_hits;
+  leaf.node->inf->toggle_bits = res.toggle_bits;
+}
+
+/**
+ * @brief Returns true for checks on every item of a location (see excl_tree::find)
+ */
+static bool is_wildcard(const string &key) {
+  size_t n = key.size();
+
+  if (n < 3 || key[n - 1] != '/' || (n > 3 && key[n - 3] != '/'))
+    return false;
+
+  return key[n - 2] == 'L' || key[n - 2] == 'X' || key[n - 2] == 'F' || key[n - 2] == 'O';
+}
+
+/**
+ * @brief Returns the directory of the array bin of a "<dir><index>/v/" key, empty
+ * @brief for other keys
+ */
+static string bin_dir(const string &key) {
+  size_t n = key.size();
+
+  if (n < 4 || key.compare(n - 3, 3, "/v/"))
+    return "";
+
+  return key.substr(0, key.find_last_of('/', n - 4) + 1);
+}
+
+/**
+ * @brief Returns true for checks on a range of an array bin (see excl_tree::find),
+ * @brief they catch the indexes of their bin that have no exact check
+ */
+static bool is_range(const string &key) {
+  string dir = bin_dir(key);
+  int64_t first, last;
+
+  return !dir.empty()
+      && excl_tree::parse_range(key.substr(dir.size(), key.size() - dir.size() - 3), first, last);
+}
+
+/**
+ * @brief Finds the checks whose stored results can't be used anymore:
+ * @brief  -> new checks or checks with a different signature
+ * @brief  -> wildcard checks above a path that was added or removed, since they
+ * @brief     catch whatever has no exact path in the trie
+ * @brief  -> range checks of an array bin that had an index check added or removed
+ * @brief  -> DU and source file checks if scope checks changed and some items were
+ * @brief     searched in several trees (a scope hit hides them from the others)
+ * @return The number of such checks
+ */
+static size_t find_dirty(const vector<check_leaf_t> &leaves,
+    const unordered_map<string, check_result_t> &old, bool shared_items, vector<bool> &dirty) {
+
+  unordered_map<string, size_t> keys;
+  unordered_map<string, vector<size_t> > ranges;
+  vector<const string *> changed;
+
+  keys.reserve(leaves.size());
+  dirty.assign(leaves.size(), false);
+
+  for (size_t i = 0; i < leaves.size(); ++i) {
+    keys[leaves[i].key] = i;
+
+    if (is_range(leaves[i].key))
+      ranges[bin_dir(leaves[i].key)].push_back(i);
+
+    auto it = old.find(leaves[i].key);
+
+    if (it == old.end() || it->second.sig != leaf_sig(leaves[i].initial)) {
+      dirty[i] = true;
+      changed.push_back(&leaves[i].key);
+    }
+  }
+
+  for (auto &x : old)
+    if (keys.find(x.first) == keys.end())
+      changed.push_back(&x.first);
+
+  bool scope_changed = false;
+
+  for (auto key : changed) {
+    scope_changed |= (*key)[0] == 's';
+
+    // Every directory on the path, from the root of the tree (just the kind)
+    for (size_t pos = 0; pos != string::npos; pos = key->find('/', pos + 1)) {
+      string dir = key->substr(0, pos + 1);
+
+      for (const char *w = "LXF"; *w; ++w) {
+        auto it = keys.find(dir + *w + "/");
+
+        if (it != keys.end())
+          dirty[it->second] = true;
+      }
+    }
+
+    auto it = ranges.find(bin_dir(*key));
+
+    if (it != ranges.end())
+      for (size_t i : it->second)
+        dirty[i] = true;
+  }
+
+  if (shared_items && scope_changed)
+    for (size_t i = 0; i < leaves.size(); ++i)
+      if (leaves[i].key[0] != 's')
+        dirty[i] = true;
+
+  return std::count(dirty.begin(), dirty.end(), true);
+}
+
+/**
+ * @brief Runs the items that can reach the dirty checks through the trie, in their
+ * @brief original order
+ * @return The number of items replayed
+ */
+static size_t replay_items(top_tree *trie, const vector<check_item_t> &items,
+    const vector<check_leaf_t> &leaves, const vector<bool> &dirty) {
+
+  // Trees in run_check's select order
+  const char *kinds = "sdf";
+
+  // Sorted (query, item) index for each tree
+  vector<pair<const string *, size_t> > index[3];
+
+  for (size_t i = 0; i < items.size(); ++i)
+    for (int t = 0; t < 3; ++t) {
+      if (!items[i].select)
+        index[t].push_back(make_pair(&items[i].queries[t], i));
+      else if (items[i].select & (1 << t))
+        index[t].push_back(make_pair(&items[i].queries[0], i));
+    }
+
+  auto by_query = [](const pair<const string *, size_t> &a, const pair<const string *, size_t> &b) {
+    int c = a.first->compare(*b.first);
+    return c < 0 || (c == 0 && a.second < b.second);
+  };
+
+  for (int t = 0; t < 3; ++t)
+    std::sort(index[t].begin(), index[t].end(), by_query);
+
+  vector<bool> marked(items.size(), false);
+
+  for (size_t i = 0; i < leaves.size(); ++i) {
+
+    if (!dirty[i])
+      continue;
+
+    const vector<pair<const string *, size_t> > &idx = index[strchr(kinds, leaves[i].key[0]) - kinds];
+    string path = leaves[i].key.substr(1);
+    bool prefix = is_wildcard(leaves[i].key);
+
+    // A wildcard check gets items from anywhere under its directory,
+    // a range check from any index of its bin and a toggle check from its location
+    if (prefix) {
+      path.erase(path.size() - 2);
+    } else if (is_range(leaves[i].key)) {
+      prefix = true;
+      path = bin_dir(path);
+    } else if (toggle_query(path)) {
+      prefix = true;
+      path.erase(path.find_last_of('/', path.size() - 4) + 1);
+    }
+
+    auto it = std::lower_bound(idx.begin(), idx.end(), make_pair(&path, (size_t) 0), by_query);
+
+    for (; it != idx.end(); ++it) {
+      if (prefix ? it->first->compare(0, path.size(), path) : *it->first != path)
+        break;
+
+      marked[it->second] = true;
+    }
+  }
+
+  size_t count = 0;
+
+  for (size_t i = 0; i < items.size(); ++i) {
+
+    if (!marked[i])
+      continue;
+
+    const check_item_t &item = items[i];
+    node_info_t inf;
+
+    inf.name = item.name;
+    inf.line = item.line;
+    inf.type = item.type;
+
+    if (item.select)
+      trie->run_check(item.queries[0], item.cov_val, inf, item.select);
+    else
+      trie->run_check(vector<string>(item.queries, item.queries + 3), item.cov_val, inf);
+
+    count++;
+  }
+
+  return count;
+}
+
+/**
+ * @brief Searches the checks in one UCISDB, reusing its stored state if possible
+ * @return The results of each check, for this UCISDB
+ */
+static vector<check_result_t> check_db(top_tree *trie, const string &db_file,
+    const string &cache_dir, bool refinement_flag, const vector<check_leaf_t> &leaves, bool silent) {
+
+  vector<check_result_t> results;
+  item_record_t record;
+  vector<check_item_t> &items = record.items;
+  unordered_map<string, check_result_t> old;
+  struct stat st;
+  bool known = false;
+
+  db_stamp_t stamp;
+  stamp.refinement = refinement_flag;
+  stamp.toggles = !trie->toggles.empty();
+
+  string items_file = state_path(cache_dir, db_file, "items");
+  string results_file = state_path(cache_dir, db_file, "results");
+
+  if (stat(db_file.c_str(), &st) == 0) {
+    stamp.mtime = st.st_mtime;
+    stamp.size = st.st_size;
+
+    known = load_items(items_file, stamp, record) == 0
+        && load_results(results_file, stamp, old) == 0;
+  }
+
+  // Items that couldn't reach the checks of the run that stored them were left out:
+  // if a check now reaches one of their locations, they are needed again
+  for (int t = 0; t < 3 && known; ++t) {
+    for (auto &location : record.skipped[t]) {
+      if (trie->reaches(t, location)) {
+        debug_log << db_file << ": new checks under " << location << ", items not stored\n";
+        known = false;
+        break;
+      }
+    }
+  }
+
+  for (auto &leaf : leaves)
+    reset_leaf(leaf);
+
+  if (!known) {
+    // First time we see this UCISDB: search it and keep what we found
+    items.clear();
+
+    for (int t = 0; t < 3; ++t)
+      record.skipped[t].clear();
+
+    trie->recorder = &record;
+    search_db(trie, db_file, refinement_flag);
+    trie->recorder = NULL;
+
+    for (auto &leaf : leaves)
+      results.push_back(get_result(leaf));
+
+    debug_log << db_file << ": searched the UCISDB, " << items.size() << " items stored\n";
+
+    if (!silent)
+      cout << "Incremental: evaluated " << leaves.size() << " checks in " << db_file << "\n";
+
+    if (stat(db_file.c_str(), &st) == 0) {
+      store_items(items_file, stamp, record);
+      store_results(results_file, stamp, leaves, results);
+    }
+
+    return results;
+  }
+
+  bool shared_items = false;
+
+  for (auto &item : items)
+    shared_items |= (item.select & (item.select - 1)) != 0;
+
+  vector<bool> dirty;
+  size_t nof_dirty = find_dirty(leaves, old, shared_items, dirty);
+  size_t nof_replayed = 0;
+
+  if (nof_dirty)
+    nof_replayed = replay_items(trie, items, leaves, dirty);
+
+  for (size_t i = 0; i < leaves.size(); ++i) {
+    if (dirty[i])
+      results.push_back(get_result(leaves[i]));
+    else
+      results.push_back(old[leaves[i].key]);
+  }
+
+  debug_log << db_file << ": " << nof_dirty << " of " << leaves.size() << " checks evaluated, "
+      << nof_replayed << " of " << items.size() << " items replayed\n";
+
+  if (!silent)
+    cout << "Incremental: reused " << leaves.size() - nof_dirty << " of " << leaves.size()
+        << " checks in " << db_file << "\n";
+
+  if (nof_dirty || old.size() != leaves.size())
+    store_results(results_file, stamp, leaves, results);
+
+  return results;
+}
+
+/**
+ * @brief Checks the UCISDBs incrementally.
+ * @brief For each UCISDB, the items passed to run_check that can reach a check and the
+ * @brief results of each check are kept in cache_dir. As long as the UCISDB doesn't
+ * @brief change, later runs don't open it: results of known checks are reused and only
+ * @brief new or changed checks are evaluated, by replaying the stored items that can
+ * @brief reach them. A check under the location of an item left out needs a new search.
+ * @param trie Checks, populated by the parsers
+ * @param dbs Paths to the UCISDBs
+ * @param cache_dir Directory holding the per UCISDB state
+ * @param refinement_flag How items are indexed (see search_callback)
+ * @param debug Generate debug info
+ * @param silent Don't generate stdout output
+ * @return 0 on success
+ */
+int inc_main(top_tree *trie, const vector<string> &dbs, const string &cache_dir,
+    bool refinement_flag, bool debug, bool silent) {
+
+  debug_switch = debug;
+
+  if (debug_switch)
+    debug_log.open("incremental.log", std::ofstream::out);
+
+  vector<pair<string, excl_tree*> > nodes;
+  vector<check_leaf_t> leaves;
+
+  trie->get_leaves(nodes);
+
+  for (auto &x : nodes) {
+    check_leaf_t leaf;
+
+    leaf.key = x.first;
+    leaf.node = x.second;
+    leaf.initial = *x.second->inf;
+
+    leaves.push_back(leaf);
+  }
+
+  // Results over all UCISDBs, combined as run_check would
+  vector<check_result_t> total;
+
+  for (auto &leaf : leaves)
+    total.push_back(get_result(leaf));
+
+  for (size_t i = 0; i < dbs.size(); ++i) {
+    vector<check_result_t> res = check_db(trie, dbs[i], cache_dir, refinement_flag, leaves, silent);
+
+    for (size_t j = 0; j < leaves.size(); ++j) {
+      if (!res[j].found)
+        continue;
+
+      total[j].found = true;
+      total[j].times_hit += res[j].times_hit;
+      total[j].hit_count += res[j].hit_count;
+
+      for (size_t k = 0; k < total[j].bin_hits.size() && k < res[j].bin_hits.size(); ++k)
+        total[j].bin_hits[k] += res[j].bin_hits[k];
+
+      for (auto &x : res[j].toggle_bits)
+        toggle_merge(total[j].toggle_bits[x.first], x.second);
+
+      total[j].name = res[j].name;
+      total[j].line = res[j].line;
+      total[j].type = res[j].type;
+    }
+  }
+
+  for (size_t i = 0; i < leaves.size(); ++i)
+    set_result(leaves[i], total[i]);
+
+  return 0;
+}
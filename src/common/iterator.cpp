@@ -15,8 +15,16 @@
  *
  *******************************************************************************/
 
+#include <thread>
+
 #include "iterator.hpp"
 #include "ucis_callbacks.hpp"
+#include "incremental.hpp"
+#include "results_db.hpp"
+#include "cross_holes.hpp"
+#include "assert_census.hpp"
+#include "rank.hpp"
+#include "first_hit.hpp"
 
 static void error_handler(void *data, ucisErrorT *errorInfo) {
   fprintf(stderr, "UCIS Error: %s\n", errorInfo->msgstr);
@@ -24,26 +32,8 @@ static void error_handler(void *data, ucisErrorT *errorInfo) {
     exit(1);
 }
 
-static string __default_checker(node_info_t inf) {
-
-  if (!inf.found)
-    return "missing";
-
-  if (inf.type != "Assertbin") {
-    if (inf.hit_count == 0)
-      return "fail";
-    return "default";
-  } else {
-    if (inf.hit_count > 0)
-      return "fail";
-    return "default";
-  }
-
-  return "default";
-
-}
-
-static checker chk = __default_checker;
+// NULL: the built in batch checker (see batch_checker.cpp)
+static checker chk = NULL;
 
 /**
  * @brief Register a callback to be applied on the specified code items
@@ -59,10 +49,13 @@ void register_check(checker f) {
  */
 int it_main(int argc, char* argv[]) {
 
+  // "coverage_lens query ..." reads stored results, no UCISDB involved
+  if (argc > 1 && !strcmp(argv[1], "query"))
+    return query_main(argc - 2, argv + 2);
+
   // Parse arguments
-  vector<vector<string> > arguments(26, vector<string>());
-  vector<string> users;
-  vector<excluder*> comment_workers;
+  vector<vector<string> > arguments(ARG_SLOTS, vector<string>());
+  comment_filter comments;
 
   int err = arg_main(argc, argv, arguments);
 
@@ -70,15 +63,14 @@ int it_main(int argc, char* argv[]) {
   bool silent = false;
   bool negate = false;
 
-  users = arguments['u' - 'a'];
-
   // Create comment filters
   for (int i = 0; i < arguments['w' - 'a'].size(); ++i)
-    comment_workers.push_back(
-        new excluder("comment", arguments['w' - 'a'][i], operations::contains));
+    comments.add(arguments['w' - 'a'][i], operations::contains);
 
   if (arguments['s' - 'a'].size())
-    comment_workers.push_back(new excluder("comment", arguments['s' - 'a'][0], operations::equals));
+    comments.add(arguments['s' - 'a'][0], operations::equals);
+
+  comments.compile();
 
   // Invalid arguments
   if (err != 0)
@@ -96,34 +88,88 @@ int it_main(int argc, char* argv[]) {
   if (!arguments['n' - 'a'].empty())
     negate = !negate;
 
+  // Checks are evaluated by a plugin, a registered checker or the default policy
+  batch_checker checks(chk);
+
+  if (!arguments[arg_slot('C')].empty() && checks.load(arguments[arg_slot('C')][0]))
+    return 1;
+
+  // Rules go before the checker, the first one that holds decides
+  rule_set rules;
+
+  for (int i = 0; i < arguments[arg_slot('R')].size(); ++i) {
+    string rule_err;
+
+    if (rules.add(arguments[arg_slot('R')][i], rule_err)) {
+      cerr << "*CL_ERR: Invalid rule \"" << arguments[arg_slot('R')][i] << "\": " << rule_err << "!\n";
+      return 2;
+    }
+  }
+
+  checks.set_rules(&rules);
+
   ucis_RegisterErrorHandler(error_handler, NULL);
 
-  // Functional coverage details
+  string out_prefix;
+  string out_format;
+
+  if (!arguments['o' - 'a'].empty())
+    out_prefix = arguments['o' - 'a'][0];
+  else
+    out_prefix = "cl_report";
+
+  // A .gz suffix (or --compress) gzips every report, except the mail body
+  string gz;
+
+  if (gz_name(out_prefix)) {
+    out_prefix.erase(out_prefix.size() - 3);
+    gz = ".gz";
+  } else if (!arguments['z' - 'a'].empty()) {
+    gz = ".gz";
+  }
+
+  // A .jsonl or .csv suffix replaces the log with a machine readable report
+  size_t dot = out_prefix.find_last_of('.');
+
+  if (dot != string::npos && (out_prefix.substr(dot) == ".jsonl" || out_prefix.substr(dot) == ".csv")) {
+    out_format = out_prefix.substr(dot + 1);
+    out_prefix.erase(dot);
+  }
+
+  // Functional coverage details, answered from an index of each UCISDB
   if (arguments['g' - 'a'].size()) {
+    string cache_dir;
 
-    // Get a struct dustate to look only at instances
-    struct dustate *du_g = (struct dustate *) malloc(sizeof(struct dustate));
-    char **data = (char **) calloc(4, sizeof(char *));
+    if (!arguments[arg_slot('I')].empty())
+      cache_dir = arguments[arg_slot('I')][0];
 
-    // Pass -g arguments to callback
-    for (int i = 0; i < arguments['g' - 'a'].size(); i++) {
-      data[i] = (char *) arguments['g' - 'a'][i].c_str();
-    }
+    return cov_main(arguments['d' - 'a'], arguments['g' - 'a'], cache_dir);
+  }
 
-    data[3] = (char *) du_g;
+  // Cross coverage holes over all the UCISDBs
+  if (!arguments[arg_slot('X')].empty()) {
+    vector<string> crosses;
+    string cache_dir;
 
-    // Iterate over given UCISDBs
-    for (int i = 0; i < arguments['d' - 'a'].size(); ++i) {
-      cout << "UCISDB #" << i << " @" << arguments['d' - 'a'][i] << "\n";
-      iterate_db(arguments['d' - 'a'][i], functional_callback, (void *) data);
-    }
+    for (auto &x : arguments[arg_slot('X')])
+      if (!x.empty())
+        crosses.push_back(x);
 
-//    std::cout << "[" << *((uint64_t*)data)[4] << "]\n";
+    if (!arguments[arg_slot('I')].empty())
+      cache_dir = arguments[arg_slot('I')][0];
 
-    free(data);
-    free(du_g);
+    return cross_main(arguments['d' - 'a'], crosses, cache_dir, out_prefix + ".holes" + gz);
+  }
 
-    return 0;
+  // Counts of every assertion over all the UCISDBs
+  if (!arguments[arg_slot('A')].empty()) {
+    vector<string> filters;
+
+    for (auto &x : arguments[arg_slot('A')])
+      if (!x.empty())
+        filters.push_back(x);
+
+    return census_main(arguments['d' - 'a'], filters, out_prefix + ".asserts" + gz);
   }
 
   // List option
@@ -144,7 +190,12 @@ int it_main(int argc, char* argv[]) {
   // If we have a plan
 #ifdef NCSIM
   if (arguments['p' - 'a'].size()) {
-    err = plan_parser_main(arguments['p' - 'a'][0], folders, debug, silent);
+    string cache_dir;
+
+    if (!arguments[arg_slot('P')].empty())
+      cache_dir = arguments[arg_slot('P')][0];
+
+    err = plan_parser_main(arguments['p' - 'a'][0], folders, debug, silent, cache_dir);
     // Errors while parsing the plan file
     if (err != 0)
     return err;
@@ -165,8 +216,8 @@ int it_main(int argc, char* argv[]) {
     // Set filters
     filters_t fil;
     fil.folders = folders;
-    fil.targeted_users = users;
-    fil.comment_workers = comment_workers;
+    fil.targeted_users.insert(arguments['u' - 'a'].begin(), arguments['u' - 'a'].end());
+    fil.comments = comments;
     fil.negate = negate;
 
     // Analyze waivers
@@ -188,25 +239,81 @@ int it_main(int argc, char* argv[]) {
     }
   }
 
-  // Pass data to UCIS through 3 pointers
-  // 1 -> dustate structure
-  // 2 -> check storage tree
-  // 3 -> switch for refinement/checkfile
-  char **data = (char **) malloc(3 * sizeof(char *));
-  struct dustate *du = (struct dustate *) malloc(sizeof(struct dustate));
+  // Smallest ordered set of tests reaching the coverage of all of them
+  if (!arguments[arg_slot('K')].empty()) {
+    vector<string> scopes;
+    int jobs = std::thread::hardware_concurrency();
+
+    for (auto &x : arguments[arg_slot('K')])
+      if (!x.empty())
+        scopes.push_back(x);
+
+    if (!arguments['j' - 'a'].empty())
+      jobs = atoi(arguments['j' - 'a'][0].c_str());
+
+    err = rank_main(excl_trie, arguments['d' - 'a'], scopes, refinement_flag, jobs,
+        out_prefix + ".rank" + gz);
+
+    delete excl_trie;
+    return err;
+  }
+
+  // First UCISDB that hits each check, in the order they were given
+  if (!arguments[arg_slot('F')].empty()) {
+    err = first_hit_main(excl_trie, arguments['d' - 'a'], refinement_flag, out_prefix + ".first" + gz);
+
+    delete excl_trie;
+    return err;
+  }
+
+  // Tests that hit each check, listed in the tooltips of the report
+  test_attribution attribution;
+
+  if (!arguments[arg_slot('T')].empty())
+    excl_trie->attribution = &attribution;
+
+  // Hits of the design unit checks, per instance
+  du_instances_t du_instances;
 
-  // Iterate over given UCISDBs
-  for (int i = 0; i < arguments['d' - 'a'].size(); ++i) {
+  if (!arguments[arg_slot('U')].empty())
+    excl_trie->du_instances = &du_instances;
 
-    data[0] = (char *) du;
-    data[1] = (char *) excl_trie;
-    data[2] = (char *) (&refinement_flag);
+  if (!arguments[arg_slot('I')].empty()) {
 
-    iterate_db(arguments['d' - 'a'][i], search_callback, (void *) data);
+    // Reuse what previous runs found in the same UCISDBs
+    err = inc_main(excl_trie, arguments['d' - 'a'], arguments[arg_slot('I')][0], refinement_flag,
+        debug, silent);
+
+    if (err != 0)
+      return err;
+
+  } else {
+
+    // Iterate over given UCISDBs
+    for (int i = 0; i < arguments['d' - 'a'].size(); ++i) {
+
+      if (excl_trie->attribution)
+        excl_trie->attribution->start_db(arguments['d' - 'a'][i]);
+
+      search_db(excl_trie, arguments['d' - 'a'][i], refinement_flag);
+    }
   }
 
-  free(du);
-  free(data);
+  // Array bin ranges and thresholds get their result from the hits of all UCISDBs
+  excl_trie->close_checks();
+
+  if (excl_trie->du_instances) {
+    out_file list(out_prefix + ".instances" + gz);
+
+    if (!list.is_open()) {
+      cerr << "*CL_ERR: Could not write " << out_prefix << ".instances" << gz << "!\n";
+      return 1;
+    }
+
+    out_buffer out(&list);
+
+    excl_trie->print_du_instances(out);
+  }
 
   // Raw results file
   if (debug) {
@@ -220,36 +327,82 @@ int it_main(int argc, char* argv[]) {
 
     for (int i = 0; i < arguments['m' - 'a'].size(); ++i)
       recipients << arguments['m' - 'a'][i] << " ";
+  }
 
-    reporter_html r("amiq_body.html", false);
-    excl_trie->gen_report(r, chk);
+  // Results of the previous run, loaded before this run overwrites them
+  bool diff = !arguments[arg_slot('D')].empty();
+  results_table_t previous;
 
+  if (diff && results_load(arguments[arg_slot('D')][0], previous)) {
+    cerr << "*CL_ERR: Could not read results file " << arguments[arg_slot('D')][0] << "!\n";
+    delete excl_trie;
+    return 1;
   }
 
-  string out_prefix;
+  // Summary mode: results rolled up per scope and type, checks are not listed
+  bool summary = !arguments[arg_slot('S')].empty();
+  bool rows = !summary || arguments[arg_slot('S')][0] == "rows";
 
-  if (!arguments['o' - 'a'].empty())
-    out_prefix = arguments['o' - 'a'][0];
-  else
-    out_prefix = "cl_report";
+  if (summary) {
+    vector<summary_node_t> trees;
 
-  if (!silent) {
+    excl_trie->gen_summary(checks, trees);
+    summary_html(out_prefix + "_summary.html" + gz, "", trees);
 
-    reporter_html r(out_prefix + ".html");
-    excl_trie->gen_report(r, chk);
+    if (!arguments['m' - 'a'].empty() && !rows)
+      summary_html("amiq_body.html", "", trees);
   }
 
-  reporter_log log(out_prefix);
+  // Columnar results, for "coverage_lens query" and --diff-against
+  reporter_columns columns(out_prefix + ".clr");
 
-  excl_trie->gen_report(log, chk);
+  if (rows) {
+    // All reports are generated in a single pass over the checks
+    reporter_fanout reports;
+    vector<reporter*> sinks;
 
-  delete excl_trie;
+    if (!arguments['m' - 'a'].empty())
+      sinks.push_back(new reporter_html("amiq_body.html", false));
 
-  for (auto it = comment_workers.begin(); it != comment_workers.end(); it++) {
-    delete *it;
+    if (!silent) {
+      reporter_html *html = new reporter_html(out_prefix + ".html" + gz, false, "", HTML_ROWS_PER_PAGE);
+
+      if (excl_trie->attribution)
+        html->set_test_names(&attribution.test_names());
+
+      sinks.push_back(html);
+    }
+
+    if (out_format == "jsonl")
+      sinks.push_back(new reporter_jsonl(out_prefix + ".jsonl" + gz));
+    else if (out_format == "csv")
+      sinks.push_back(new reporter_csv(out_prefix + ".csv" + gz));
+    else
+      sinks.push_back(new reporter_log(out_prefix + gz));
+
+    for (int i = 0; i < sinks.size(); ++i)
+      reports.add_sink(sinks[i]);
+
+    // Rows are formatted on all cores unless told otherwise
+    if (!arguments['j' - 'a'].empty())
+      reports.set_jobs(atoi(arguments['j' - 'a'][0].c_str()));
+    else
+      reports.set_jobs(std::thread::hardware_concurrency());
+
+    reports.add_sink(&columns);
+
+    excl_trie->gen_report(reports, checks);
+
+    for (int i = 0; i < sinks.size(); ++i)
+      delete sinks[i];
+  } else if (diff) {
+    excl_trie->gen_report(columns, checks);
   }
 
-  comment_workers.clear();
+  if (diff)
+    results_diff(previous, columns.results(), out_prefix + ".diff" + gz, silent);
+
+  delete excl_trie;
 
   if (!silent)
     cout << "Iterator finished successfully!\n";
@@ -42,6 +42,35 @@ void pu::pu_replace_line(string &line, size_t &pos) {
   pos = 0;
 }
 
+/**
+ * @brief Returns a cleared flag slot for the current command
+ */
+flag &pu::pu_new_flag() {
+
+  if (nof_flags == cmd_flags.size())
+    cmd_flags.push_back(make_pair("", vector<string>()));
+
+  cmd_flags[nof_flags].first.clear();
+  cmd_flags[nof_flags].second.clear();
+
+  return cmd_flags[nof_flags++];
+}
+
+/**
+ * @brief Hands the current command to the consumer or stores it
+ */
+void pu::pu_end_cmd() {
+
+  if (consumer) {
+    consumer(pu_cmd(cmd_flags.data(), nof_flags), cmd_line, consumer_data);
+  } else {
+    cmd_lines.push_back(cmd_line);
+    commands.push_back(vector<flag>(cmd_flags.begin(), cmd_flags.begin() + nof_flags));
+  }
+
+  nof_flags = 0;
+}
+
 /**
  * @brief Reads until first non whitespace
  * @param line Current line parsed
@@ -244,7 +273,7 @@ int pu::pu_read_args(string &line, size_t &pos) {
   else
     current_flag = line.substr(arg_start);
 
-  cmd_flags[cmd_flags.size() - 1].first = current_flag;
+  cmd_flags[nof_flags - 1].first = current_flag;
 
   // Move to the first arg
   pu_goto_next_token(line, pos);
@@ -274,7 +303,7 @@ int pu::pu_read_args(string &line, size_t &pos) {
     }
 
     // Store the arg
-    cmd_flags[cmd_flags.size() - 1].second.push_back(flag_args);
+    cmd_flags[nof_flags - 1].second.push_back(flag_args);
 
     // Move to the next arg
     pu_goto_next_token(line, pos);
@@ -344,7 +373,7 @@ int pu::pu_main() {
       break;
     case PU_FOUND_CMD: {
 
-      cmd_lines.push_back(this->current_line);
+      cmd_line = this->current_line;
       pu_read_cmd(line, pos);
       state = PU_READ_ARGS;
 
@@ -352,7 +381,7 @@ int pu::pu_main() {
     }
     case PU_READ_ARGS:
 
-      cmd_flags.push_back(make_pair("", vector<string>()));
+      pu_new_flag();
 
       pu_read_args(line, pos);
 
@@ -364,10 +393,8 @@ int pu::pu_main() {
         state = PU_FOUND_CMD;
       }
 
-      if (state != PU_READ_ARGS) {
-        commands.push_back(cmd_flags);
-        cmd_flags.erase(cmd_flags.begin(), cmd_flags.end());
-      }
+      if (state != PU_READ_ARGS)
+        pu_end_cmd();
 
       break;
     case PU_DONE:
@@ -384,6 +411,9 @@ int pu::pu_main() {
   }
 }
 
+/**
+ * @brief Returns the stored commands (when no consumer is set)
+ */
 pu_results pu::pu_get_results() {
 
   pu_results pu_res;
@@ -32,6 +32,11 @@ static int top_expr_index = 1;
 
 static string path;
 
+// Design unit of the last scope: all the bins of a scope share it
+static ucisScopeT du_scope = NULL;
+static string du_name;
+static bool du_checked;
+
 /*
  * @brief Auxiliary function used in assembling queries.
  */
@@ -102,16 +107,27 @@ static void pack_specific(const vector<string> &params, string &query) {
   }
 }
 
+/*
+ * @brief Forgets the scope handles of the UCISDB that was closed
+ */
+void reset_query_cache() {
+  du_scope = NULL;
+  du_name.clear();
+  du_checked = false;
+}
+
 /*
  *  @brief Returns params to construct a query for all types of trees (see top_tree.hpp)
  *  @param cbdata used to get DB handle
  *  @param sourceinfo used to get info about files
  *  @param coverdata used to get info about the item
  *  @param name item name in UCISDB
- *  @return a vector with three queries, one for each tree
+ *  @param trie checks, the DU query is left empty if none can match it
+ *  @return a vector with three queries, one for each tree, then the path of the
+ *  @return instance that holds the item
  */
 vector<string> get_query_array(ucisCBDataT* cbdata, ucisSourceInfoT sourceinfo,
-    ucisCoverDataT coverdata, char* name, node_info_t& inf) {
+    ucisCoverDataT coverdata, char* name, node_info_t& inf, const top_tree *trie) {
 
   // Get handles to UCIS objects
   ucisScopeT scope = (ucisScopeT) (cbdata->obj);
@@ -125,12 +141,20 @@ vector<string> get_query_array(ucisCBDataT* cbdata, ucisSourceInfoT sourceinfo,
   params[AMIQ_UCIS_SRC_FILE] = string(ucis_GetFileName(db, sourceinfo.filehandle));
   params[AMIQ_UCIS_SRC_LINE] = to_string(sourceinfo.line);
   params[AMIQ_UCIS_HITCOUNT] = to_string(static_cast<long int>(coverdata.data.int64));
-  params[AMIQ_UCIS_DU_NAME] = string(
-      ucis_GetStringProperty(db, scope, -1, UCIS_STR_INSTANCE_DU_NAME));
-  params[AMIQ_UCIS_DU_NAME] = params[AMIQ_UCIS_DU_NAME].substr(
-      params[AMIQ_UCIS_DU_NAME].find_last_of('.') + 1);
+
+  if (scope != du_scope) {
+    du_name = string(ucis_GetStringProperty(db, scope, -1, UCIS_STR_INSTANCE_DU_NAME));
+    du_name = du_name.substr(du_name.find_last_of('.') + 1);
+    du_checked = trie->du_checked(du_name);
+    du_scope = scope;
+  }
+
+  params[AMIQ_UCIS_DU_NAME] = du_name;
   params[AMIQ_UCIS_NAME] = string(name);
 
+  // Instance of the item, if its scope query holds more than the instance
+  string instance;
+
   // Do some parsing for the unique items for each type
   switch (coverdata.type) {
   // Coverage 
@@ -139,6 +163,11 @@ vector<string> get_query_array(ucisCBDataT* cbdata, ucisSourceInfoT sourceinfo,
     params[AMIQ_UCIS_SCOPE_NAME] = ucis_GetStringProperty(db, scope, -1,
           UCIS_STR_SCOPE_HIER_NAME);
 
+    // The scope is a coverpoint, in a covergroup of the instance
+    instance = params[AMIQ_UCIS_SCOPE_NAME];
+    instance = instance.substr(0, instance.find_last_of('/'));
+    instance = instance.substr(0, instance.find_last_of('/'));
+
     int idx;
     int num_cross;
 
@@ -218,6 +247,8 @@ vector<string> get_query_array(ucisCBDataT* cbdata, ucisSourceInfoT sourceinfo,
     params[AMIQ_UCIS_SCOPE_NAME] = params[AMIQ_UCIS_SCOPE_NAME].substr(idx);
     params[AMIQ_UCIS_SCOPE_NAME] = aux + params[AMIQ_UCIS_SCOPE_NAME];
 
+    instance = aux;
+
     params[AMIQ_UCIS_SCOPE_NAME] += "/a";
 
     break;
@@ -296,7 +327,7 @@ vector<string> get_query_array(ucisCBDataT* cbdata, ucisSourceInfoT sourceinfo,
   }
 
   // Now that we got everything we wanted, time to build the queries
-  vector<string> queries(3, "");
+  vector<string> queries(4, "");
   string query;
 
   inf.name = params[AMIQ_UCIS_NAME];
@@ -353,11 +384,21 @@ vector<string> get_query_array(ucisCBDataT* cbdata, ucisSourceInfoT sourceinfo,
   pack_specific(params, query);
   queries[0] = query;
 
-  // ROUND 2: DU
-  query = params[AMIQ_UCIS_DU_NAME] + "/";
+  if (instance.empty())
+    instance = params[AMIQ_UCIS_SCOPE_NAME];
 
-  pack_specific(params, query);
-  queries[1] = query;
+  if (!instance.empty() && instance[0] == '/')
+    instance = instance.substr(1);
+
+  queries[3] = instance;
+
+  // ROUND 2: DU, only for design units with type checks
+  if (du_checked) {
+    query = params[AMIQ_UCIS_DU_NAME] + "/";
+
+    pack_specific(params, query);
+    queries[1] = query;
+  }
 
   // ROUND 3: src_file
   query = params[AMIQ_UCIS_SRC_FILE].substr(1) + "/";
@@ -624,3 +665,55 @@ string get_query(ucisCBDataT* cbdata, ucisCoverDataT coverdata, char* name, bool
     return "";
   }
 }
+
+/*
+ *  @brief Returns the queries of a toggle bin for all types of trees (see top_tree.hpp),
+ *  @brief as <location>/<signal>/<bit>/<edge>/o/. Toggles have no source file query.
+ *  @param cbdata used to get DB handle
+ *  @param name item name in UCISDB
+ *  @return a vector with three queries, all empty if the bin is not a 0->1 or 1->0 toggle
+ */
+vector<string> get_toggle_queries(ucisCBDataT* cbdata, char* name, node_info_t& inf) {
+
+  // Get handles to UCIS objects
+  ucisScopeT scope = (ucisScopeT) (cbdata->obj);
+  ucisT db = cbdata->db;
+
+  vector<string> queries(4, "");
+  char edge = toggle_edge(name);
+  const char *hier_name = ucis_GetStringProperty(db, scope, -1, UCIS_STR_SCOPE_HIER_NAME);
+
+  string location, signal;
+  int64_t bit;
+
+  if (!edge || hier_name == NULL || !toggle_split(hier_name, location, signal, bit))
+    return queries;
+
+  if (location[0] == '/')
+    location = location.substr(1);
+
+  // Build the info structure
+  inf.type = "Toggle";
+  inf.name = signal;
+  inf.line = 0;
+  inf.hit_count = 0;
+  inf.found = false;
+  inf.location = location;
+
+  string item = "/" + signal + "/" + to_string(bit) + "/" + edge + "/o/";
+
+  // ROUND 1: scope
+  queries[0] = location + item;
+  queries[3] = location;
+
+  // ROUND 2: DU
+  const char *du_name = ucis_GetStringProperty(db, scope, -1, UCIS_STR_INSTANCE_DU_NAME);
+
+  if (du_name != NULL) {
+    string du(du_name);
+
+    queries[1] = du.substr(du.find_last_of('.') + 1) + item;
+  }
+
+  return queries;
+}
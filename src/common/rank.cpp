@@ -0,0 +1,423 @@
+/******************************************************************************
+ * (C) Copyright 2017 AMIQ Consulting
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *******************************************************************************/
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <unordered_map>
+
+#include "rank.hpp"
+#include "bitmap.hpp"
+#include "ucis_callbacks.hpp"
+#include "formatter.hpp"
+
+using std::cout;
+using std::cerr;
+using std::unordered_map;
+
+/*
+ * Items of a UCISDB that were hit, by number in the dictionary
+ */
+typedef struct {
+  roaring_bitmap items;
+  uint64_t nof_items;       // items of the UCISDB, hit or not
+} rank_test_t;
+
+/*
+ * A UCISDB waiting to be picked. gain is exact if it was computed in the
+ * current round, an upper bound otherwise (tests only lose items to others).
+ */
+typedef struct {
+  uint64_t gain;
+  uint32_t test;
+  uint32_t round;
+} rank_entry_t;
+
+/*
+ * Most items first, then the first test given
+ */
+struct rank_order {
+  bool operator()(const rank_entry_t &a, const rank_entry_t &b) const {
+    return a.gain < b.gain || (a.gain == b.gain && a.test > b.test);
+  }
+};
+
+/*
+ * @brief Names of the items of all UCISDBs, numbered in the order they are first
+ * @brief seen. Names are spread over shards so that scans rarely wait on each other.
+ */
+class item_dict {
+
+  typedef struct {
+    std::mutex lock;
+    unordered_map<string, uint32_t> ids;
+  } shard_t;
+
+  shard_t shards[RANK_SHARDS];
+  std::atomic<uint32_t> count;
+
+public:
+
+  item_dict() :
+      count(0) {
+  }
+
+  /*
+   * @brief Numbers a batch of names, taking each shard lock once
+   * @param names Names of the items
+   * @param ids Receives the number of each name
+   */
+  void map(const vector<string> &names, vector<uint32_t> &ids) {
+
+    vector<vector<size_t> > by_shard(RANK_SHARDS);
+    std::hash<string> hash;
+
+    ids.resize(names.size());
+
+    for (size_t i = 0; i < names.size(); ++i)
+      by_shard[hash(names[i]) % RANK_SHARDS].push_back(i);
+
+    for (int s = 0; s < RANK_SHARDS; ++s) {
+      if (by_shard[s].empty())
+        continue;
+
+      std::lock_guard<std::mutex> guard(shards[s].lock);
+
+      for (size_t i : by_shard[s]) {
+        auto ins = shards[s].ids.insert(make_pair(names[i], (uint32_t) 0));
+
+        if (ins.second)
+          ins.first->second = count++;
+
+        ids[i] = ins.first->second;
+      }
+    }
+  }
+
+  uint32_t size() const {
+    return count;
+  }
+};
+
+/*
+ * Hit bins of a scanned UCISDB, waiting to be numbered
+ */
+typedef struct {
+  size_t test;
+  vector<string> hits;
+  uint64_t nof_bins;
+} rank_batch_t;
+
+/*
+ * @brief Scans the UCISDBs for the bins they hit. UCIS is only called from this
+ * @brief thread: the other ones number the names of the bins and fill the bitmaps
+ * @brief of the UCISDBs already scanned meanwhile.
+ * @param nof_items Receives the number of items hit by some UCISDB
+ * @return 0 on success, 1 if a UCISDB can't be opened
+ */
+static int scan_bins(const vector<string> &dbs, const vector<string> &scopes, int jobs,
+    vector<rank_test_t> &tests, uint32_t &nof_items) {
+
+  item_dict dict;
+  std::mutex lock;
+  std::condition_variable ready;
+  std::condition_variable space;
+  std::queue<rank_batch_t> batches;
+  bool done = false;
+
+  auto number = [&](const rank_batch_t &b) {
+    vector<uint32_t> ids;
+
+    // Sorted ids fill the bitmap containers from the back
+    dict.map(b.hits, ids);
+    std::sort(ids.begin(), ids.end());
+
+    for (uint32_t id : ids)
+      tests[b.test].items.add(id);
+
+    tests[b.test].nof_items = b.nof_bins;
+  };
+
+  auto worker = [&]() {
+    for (;;) {
+      rank_batch_t b;
+
+      {
+        std::unique_lock<std::mutex> guard(lock);
+
+        ready.wait(guard, [&]() { return done || !batches.empty(); });
+
+        if (batches.empty())
+          return;
+
+        b = std::move(batches.front());
+        batches.pop();
+      }
+
+      space.notify_one();
+      number(b);
+    }
+  };
+
+  vector<std::thread> threads;
+
+  for (int t = 1; t < jobs; ++t)
+    threads.push_back(std::thread(worker));
+
+  rank_scan_t scan;
+  int err = 0;
+
+  scan.scopes = &scopes;
+  scan.scope.group = cov_default_options();
+  scan.scope.point = cov_default_options();
+
+  for (size_t i = 0; i < dbs.size(); ++i) {
+    scan.hits.clear();
+    scan.nof_bins = 0;
+    scan.last = NULL;
+
+    if (iterate_db(dbs[i], rank_callback, (void *) &scan) != 0) {
+      cerr << "*CL_ERR: Could not open " << dbs[i] << "!\n";
+      err = 1;
+      break;
+    }
+
+    rank_batch_t b;
+
+    b.test = i;
+    b.hits.swap(scan.hits);
+    b.nof_bins = scan.nof_bins;
+
+    if (threads.empty()) {
+      number(b);
+      continue;
+    }
+
+    // At most one UCISDB per thread waits, the others are only read
+    {
+      std::unique_lock<std::mutex> guard(lock);
+
+      space.wait(guard, [&]() { return batches.size() < threads.size(); });
+      batches.push(std::move(b));
+    }
+
+    ready.notify_one();
+  }
+
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    done = true;
+  }
+
+  ready.notify_all();
+
+  for (auto &t : threads)
+    t.join();
+
+  nof_items = dict.size();
+
+  return err;
+}
+
+/*
+ * @brief Evaluates the checks on each UCISDB alone. The search keeps its state in
+ * @brief globals, so UCISDBs are searched one at a time.
+ * @param nof_items Receives the number of checks that can be covered
+ * @return 0 on success, 1 if a UCISDB can't be opened
+ */
+static int scan_checks(top_tree *trie, const vector<string> &dbs, bool refinement_flag,
+    vector<rank_test_t> &tests, uint32_t &nof_items) {
+
+  vector<pair<string, excl_tree*> > leaves;
+  vector<node_info_t> initial;
+
+  trie->get_leaves(leaves);
+
+  uint32_t n = 0;
+
+  for (auto &x : leaves) {
+    initial.push_back(*x.second->inf);
+    n += !x.second->inf->negated;
+  }
+
+  for (size_t i = 0; i < dbs.size(); ++i) {
+
+    for (size_t j = 0; j < leaves.size(); ++j) {
+      leaves[j].second->found = false;
+      leaves[j].second->times_hit = 0;
+      *leaves[j].second->inf = initial[j];
+    }
+
+    if (search_db(trie, dbs[i], refinement_flag) != 0) {
+      cerr << "*CL_ERR: Could not open " << dbs[i] << "!\n";
+      return 1;
+    }
+
+    trie->close_checks();
+
+    // Negated checks pass by not being hit, no test adds them
+    for (size_t j = 0; j < leaves.size(); ++j) {
+      const node_info_t *inf = leaves[j].second->inf;
+
+      if (inf->found && inf->hit_count > 0 && !inf->negated)
+        tests[i].items.add(j);
+    }
+
+    tests[i].nof_items = n;
+  }
+
+  nof_items = n;
+
+  return 0;
+}
+
+/*
+ * @brief Orders the UCISDBs (one per test) so that the first ones reach the
+ * @brief coverage of all of them as soon as possible, and lists the ones needed.
+ * @brief The items are the checks of the trie or, if it has none, the code and
+ * @brief functional coverage bins under the given instances. Each UCISDB becomes
+ * @brief a compressed bitmap over a dictionary of items shared by all UCISDBs.
+ * @brief Tests are then picked greedily, by the number of items they add,
+ * @brief counted with popcounts against a plain bitset of the covered items.
+ * @param trie Checks, populated by the parsers
+ * @param dbs Paths to the UCISDBs
+ * @param scopes Instances whose bins are ranked, all if empty (without checks)
+ * @param refinement_flag How items are indexed (see search_callback)
+ * @param jobs Threads: one scans the UCISDBs, the others number their bins (without checks)
+ * @param file Where the ranked UCISDBs are listed
+ * @return 0 on success
+ */
+int rank_main(top_tree *trie, const vector<string> &dbs, const vector<string> &scopes,
+    bool refinement_flag, int jobs, const string &file) {
+
+  vector<pair<string, excl_tree*> > leaves;
+  vector<rank_test_t> tests(dbs.size());
+  vector<string> wanted;
+  uint32_t nof_items;
+  int err;
+
+  trie->get_leaves(leaves);
+
+  for (auto s : scopes) {
+    if (!s.empty() && s[0] == '/')
+      s.erase(0, 1);
+
+    if (!s.empty() && s[s.size() - 1] == '/')
+      s.erase(s.size() - 1);
+
+    wanted.push_back(s);
+  }
+
+  if (jobs < 1)
+    jobs = 1;
+
+  if (jobs > (int) dbs.size())
+    jobs = dbs.size();
+
+  if (leaves.empty())
+    err = scan_bins(dbs, wanted, jobs, tests, nof_items);
+  else
+    err = scan_checks(trie, dbs, refinement_flag, tests, nof_items);
+
+  if (err != 0)
+    return err;
+
+  for (size_t i = 0; i < dbs.size(); ++i)
+    cout << "UCISDB #" << i << " @" << dbs[i] << ": " << tests[i].items.cardinality() << " of "
+        << tests[i].nof_items << (leaves.empty() ? " bins" : " checks") << " hit\n";
+
+  // Greedy set cover, gains are only recomputed for the test on top
+  std::priority_queue<rank_entry_t, vector<rank_entry_t>, rank_order> queue;
+  uint64_t bound = leaves.empty() ? nof_items : leaves.size();
+  vector<uint64_t> covered(((bound >> 16) + 1) << 10, 0);
+  vector<rank_entry_t> ranked;
+  uint32_t round = 0;
+  uint64_t total = 0;
+
+  for (uint32_t i = 0; i < tests.size(); ++i) {
+    rank_entry_t e = { tests[i].items.cardinality(), i, 0 };
+
+    if (e.gain)
+      queue.push(e);
+  }
+
+  while (!queue.empty()) {
+    rank_entry_t e = queue.top();
+
+    queue.pop();
+
+    if (e.round != round) {
+      e.gain = tests[e.test].items.count_not_in(covered);
+      e.round = round;
+
+      if (e.gain)
+        queue.push(e);
+
+      continue;
+    }
+
+    tests[e.test].items.set_in(covered);
+    total += e.gain;
+    ranked.push_back(e);
+    round++;
+  }
+
+  out_file list(file);
+
+  if (!list.is_open()) {
+    cerr << "*CL_ERR: Could not write " << file << "!\n";
+    return 1;
+  }
+
+  out_buffer out(&list);
+  uint64_t sum = 0;
+
+  out.put("rank\tadded\tcovered\tpercent\tucisdb\n");
+
+  for (size_t r = 0; r < ranked.size(); ++r) {
+    const rank_entry_t &e = ranked[r];
+
+    sum += e.gain;
+
+    string percent = to_string(total ? 100.0 * sum / total : 0);
+    string line = to_string(r + 1) + "\t" + to_string(e.gain) + "\t" + to_string(sum) + "\t" + percent
+        + "\t" + dbs[e.test] + "\n";
+
+    out.put(line);
+
+    if (r < RANK_TOP_TESTS)
+      cout << "\t#" << r + 1 << " " << dbs[e.test] << ": +" << e.gain << ", " << sum << " ("
+          << percent << "%)\n";
+  }
+
+  if (leaves.empty())
+    cout << total << " bins hit by some UCISDB, ";
+  else
+    cout << total << " of " << nof_items << " checks hit by some UCISDB, ";
+
+  cout << ranked.size() << " of " << dbs.size() << " UCISDBs reach the same coverage\n";
+  cout << "The ranked UCISDBs are listed in " << file << "\n";
+
+  return 0;
+}
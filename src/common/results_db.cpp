@@ -0,0 +1,681 @@
+/******************************************************************************
+ * (C) Copyright 2017 AMIQ Consulting
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *******************************************************************************/
+
+#include <string.h>
+#include <time.h>
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <map>
+
+#include "results_db.hpp"
+
+using std::cerr;
+using std::cout;
+using std::ifstream;
+using std::map;
+using std::ofstream;
+using std::pair;
+
+static const char results_magic[8] = { 'C', 'L', 'R', 'E', 'S', '0', '0', '1' };
+
+/*
+ * Bitmap helpers
+ */
+static inline size_t nof_words(size_t rows) {
+  return (rows + 63) / 64;
+}
+
+static inline void set_bit(vector<uint64_t> &bits, size_t i) {
+  bits[i / 64] |= 1ULL << (i % 64);
+}
+
+reporter_columns::reporter_columns(const string &file) :
+    file(file) {
+  table.created = time(NULL);
+}
+
+/*
+ * @brief Returns the dictionary index of s, adding it if needed
+ */
+uint32_t reporter_columns::get_id(const string &s) {
+
+  auto it = ids.find(s);
+
+  if (it != ids.end())
+    return it->second;
+
+  uint32_t id = table.dict.size();
+
+  table.dict.push_back(s);
+  ids[s] = id;
+
+  return id;
+}
+
+void reporter_columns::format(const node_info_t& inf, const string &class_name) {
+
+  if (class_name.compare("fail") == 0)
+    err_count++;
+
+  size_t row = results_rows(table);
+
+  table.kind.push_back(kind);
+  table.type.push_back(get_id(inf.type));
+  table.name.push_back(get_id(inf.name));
+  table.location.push_back(get_id(inf.location));
+  table.line.push_back(inf.line);
+  table.hit_count.push_back(inf.hit_count);
+  table.status.push_back(get_id(class_name.empty() ? "default" : class_name));
+  table.generator.push_back(get_id(inf.generator));
+  table.generator_line.push_back(inf.generator_line);
+  table.comment.push_back(get_id(inf.comment));
+
+  table.fail.resize(nof_words(row + 1), 0);
+  table.missing.resize(nof_words(row + 1), 0);
+
+  if (!class_name.compare("fail"))
+    set_bit(table.fail, row);
+  else if (!class_name.compare("missing"))
+    set_bit(table.missing, row);
+}
+
+void reporter_columns::end() {
+  results_store(file, table);
+}
+
+template<typename T>
+static void write_column(ofstream &out, const vector<T> &col) {
+  out.write((const char *) col.data(), col.size() * sizeof(T));
+}
+
+template<typename T>
+static bool read_column(ifstream &in, vector<T> &col, size_t n) {
+  col.resize(n);
+  return n == 0 || in.read((char *) col.data(), n * sizeof(T));
+}
+
+/*
+ * @brief Stores a results table
+ * @param file Path to the file
+ * @param t The table
+ * @return 0 on success, -1 on error
+ */
+int results_store(const string &file, const results_table_t &t) {
+
+  ofstream out(file, ofstream::out | ofstream::binary);
+
+  if (!out.good()) {
+    cerr << "Could not write results " << file << "!\n";
+    return -1;
+  }
+
+  uint64_t rows = results_rows(t);
+  uint32_t dict_size = t.dict.size();
+
+  out.write(results_magic, sizeof(results_magic));
+  out.write((const char *) &t.created, sizeof(t.created));
+  out.write((const char *) &rows, sizeof(rows));
+  out.write((const char *) &dict_size, sizeof(dict_size));
+
+  for (auto &s : t.dict) {
+    uint32_t len = s.size();
+
+    out.write((const char *) &len, sizeof(len));
+    out.write(s.data(), len);
+  }
+
+  write_column(out, t.kind);
+  write_column(out, t.type);
+  write_column(out, t.name);
+  write_column(out, t.location);
+  write_column(out, t.line);
+  write_column(out, t.status);
+  write_column(out, t.generator);
+  write_column(out, t.generator_line);
+  write_column(out, t.comment);
+
+  // Hit counts are packed on the smallest width that fits them all
+  int64_t lo = 0, hi = 0;
+
+  for (size_t i = 0; i < rows; ++i) {
+    lo = std::min(lo, t.hit_count[i]);
+    hi = std::max(hi, t.hit_count[i]);
+  }
+
+  uint8_t width = 8;
+
+  if (lo >= 0 && hi <= 0xFF)
+    width = 1;
+  else if (lo >= 0 && hi <= 0xFFFF)
+    width = 2;
+  else if (lo >= 0 && hi <= 0xFFFFFFFFLL)
+    width = 4;
+
+  out.write((const char *) &width, sizeof(width));
+
+  for (size_t i = 0; i < rows; ++i) {
+    uint64_t x = t.hit_count[i];
+
+    // Little endian, low bytes first
+    out.write((const char *) &x, width);
+  }
+
+  write_column(out, t.fail);
+  write_column(out, t.missing);
+
+  return out.good() ? 0 : -1;
+}
+
+/*
+ * @brief Loads a results file
+ * @param file Path to the file
+ * @param t Table to fill
+ * @return 0 on success, -1 on error
+ */
+int results_load(const string &file, results_table_t &t) {
+
+  ifstream in(file, ifstream::in | ifstream::binary);
+
+  char magic[sizeof(results_magic)];
+  uint64_t rows;
+  uint32_t dict_size;
+
+  in.read(magic, sizeof(magic));
+  in.read((char *) &t.created, sizeof(t.created));
+  in.read((char *) &rows, sizeof(rows));
+  in.read((char *) &dict_size, sizeof(dict_size));
+
+  if (!in || memcmp(magic, results_magic, sizeof(magic)))
+    return -1;
+
+  t.dict.resize(dict_size);
+
+  for (uint32_t i = 0; i < dict_size; ++i) {
+    uint32_t len;
+
+    if (!in.read((char *) &len, sizeof(len)))
+      return -1;
+
+    t.dict[i].resize(len);
+
+    if (len && !in.read(&t.dict[i][0], len))
+      return -1;
+  }
+
+  if (!read_column(in, t.kind, rows) || !read_column(in, t.type, rows)
+      || !read_column(in, t.name, rows) || !read_column(in, t.location, rows)
+      || !read_column(in, t.line, rows) || !read_column(in, t.status, rows)
+      || !read_column(in, t.generator, rows) || !read_column(in, t.generator_line, rows)
+      || !read_column(in, t.comment, rows))
+    return -1;
+
+  uint8_t width;
+  vector<uint8_t> packed;
+
+  if (!in.read((char *) &width, sizeof(width)) || !read_column(in, packed, rows * width))
+    return -1;
+
+  t.hit_count.assign(rows, 0);
+
+  for (size_t i = 0; i < rows; ++i)
+    memcpy(&t.hit_count[i], &packed[i * width], width);
+
+  if (!read_column(in, t.fail, nof_words(rows)) || !read_column(in, t.missing, nof_words(rows)))
+    return -1;
+
+  // Every id must point in the dictionary
+  const vector<uint32_t> *cols[] = { &t.type, &t.name, &t.location, &t.status, &t.generator,
+      &t.comment };
+
+  for (auto col : cols)
+    for (size_t i = 0; i < rows; ++i)
+      if ((*col)[i] >= dict_size)
+        return -1;
+
+  return 0;
+}
+
+/*
+ * @brief Orders the rows of a table by check identity.
+ * @brief Strings are ranked once, so rows are sorted on integers only.
+ * @return Row indexes, sorted
+ */
+static vector<uint32_t> sort_rows(const results_table_t &t) {
+
+  vector<uint32_t> ids(t.dict.size());
+  vector<uint32_t> rank(t.dict.size());
+
+  for (uint32_t i = 0; i < ids.size(); ++i)
+    ids[i] = i;
+
+  std::sort(ids.begin(), ids.end(), [&t](uint32_t a, uint32_t b) {
+    return t.dict[a] < t.dict[b];
+  });
+
+  for (uint32_t i = 0; i < ids.size(); ++i)
+    rank[ids[i]] = i;
+
+  vector<uint32_t> rows(results_rows(t));
+
+  for (uint32_t i = 0; i < rows.size(); ++i)
+    rows[i] = i;
+
+  // Stable, so duplicated checks are paired in report order
+  std::stable_sort(rows.begin(), rows.end(), [&t, &rank](uint32_t a, uint32_t b) {
+    if (t.kind[a] != t.kind[b])
+      return t.kind[a] < t.kind[b];
+    if (t.type[a] != t.type[b])
+      return rank[t.type[a]] < rank[t.type[b]];
+    if (t.location[a] != t.location[b])
+      return rank[t.location[a]] < rank[t.location[b]];
+    if (t.name[a] != t.name[b])
+      return rank[t.name[a]] < rank[t.name[b]];
+    return t.line[a] < t.line[b];
+  });
+
+  return rows;
+}
+
+/*
+ * @brief Compares the identities of row i of a and row j of b
+ * @return <0, 0 or >0, like strcmp
+ */
+static int compare_rows(const results_table_t &a, uint32_t i, const results_table_t &b, uint32_t j) {
+
+  int c;
+
+  if (a.kind[i] != b.kind[j])
+    return a.kind[i] < b.kind[j] ? -1 : 1;
+  if ((c = a.dict[a.type[i]].compare(b.dict[b.type[j]])))
+    return c;
+  if ((c = a.dict[a.location[i]].compare(b.dict[b.location[j]])))
+    return c;
+  if ((c = a.dict[a.name[i]].compare(b.dict[b.name[j]])))
+    return c;
+  if (a.line[i] != b.line[j])
+    return a.line[i] < b.line[j] ? -1 : 1;
+
+  return 0;
+}
+
+static inline bool get_bit(const vector<uint64_t> &bits, size_t i) {
+  return (bits[i / 64] >> (i % 64)) & 1;
+}
+
+/*
+ * @brief Short status of a row: "fail", "missing" or "pass"
+ */
+static const char *row_status(const results_table_t &t, uint32_t i) {
+
+  if (get_bit(t.fail, i))
+    return "fail";
+  else if (get_bit(t.missing, i))
+    return "missing";
+
+  return "pass";
+}
+
+static const char *kind_name(char kind) {
+
+  if (kind == 'd')
+    return "unit";
+  else if (kind == 's')
+    return "instance";
+
+  return "file";
+}
+
+/*
+ * @brief Writes one difference: what changed, the check and its hit counts
+ */
+static void put_change(out_buffer &b, const char *change, const results_table_t &t, uint32_t i,
+    const string &before, const string &after) {
+
+  b.put(change).put('\t').put(kind_name(t.kind[i])).put('\t').put(t.dict[t.type[i]]).put('\t');
+  b.put(t.dict[t.location[i]]).put('\t').put(t.dict[t.name[i]]).put('\t').put_int(t.line[i]);
+  b.put('\t').put(before).put(" -> ").put(after).put('\n');
+}
+
+/*
+ * @brief Compares the results of two runs, check by check.
+ * @brief Checks are matched on kind, type, location, name and line.
+ * @param prev Results of the previous run
+ * @param cur Results of this run
+ * @param file Where the differences are written
+ * @param silent Don't print the totals
+ * @return Number of newly failing checks
+ */
+uint64_t results_diff(const results_table_t &prev, const results_table_t &cur, const string &file,
+    bool silent) {
+
+  vector<uint32_t> a = sort_rows(prev);
+  vector<uint32_t> b = sort_rows(cur);
+
+  out_file report(file);
+  out_buffer out(&report);
+
+  // newly failing, newly passing, newly missing, hit count changes, added, removed
+  uint64_t counts[6] = { 0, 0, 0, 0, 0, 0 };
+  size_t i = 0, j = 0;
+
+  while (i < a.size() || j < b.size()) {
+    int c = (i == a.size()) ? 1 : (j == b.size()) ? -1 : compare_rows(prev, a[i], cur, b[j]);
+
+    if (c < 0) {
+      put_change(out, "removed", prev, a[i], row_status(prev, a[i]), "none");
+      counts[5]++;
+      i++;
+      continue;
+    }
+
+    if (c > 0) {
+      const char *now = row_status(cur, b[j]);
+
+      if (!strcmp(now, "fail")) {
+        put_change(out, "newly_failing", cur, b[j], "none", now);
+        counts[0]++;
+      } else {
+        put_change(out, "added", cur, b[j], "none", now);
+        counts[4]++;
+      }
+
+      j++;
+      continue;
+    }
+
+    const char *before = row_status(prev, a[i]);
+    const char *now = row_status(cur, b[j]);
+
+    if (strcmp(before, now)) {
+      const char *change = !strcmp(now, "fail") ? "newly_failing" :
+                           !strcmp(now, "missing") ? "newly_missing" : "newly_passing";
+
+      put_change(out, change, cur, b[j], before, now);
+      counts[!strcmp(now, "fail") ? 0 : !strcmp(now, "missing") ? 2 : 1]++;
+    } else if (prev.hit_count[a[i]] != cur.hit_count[b[j]]) {
+      put_change(out, "hits", cur, b[j], to_string(prev.hit_count[a[i]]),
+          to_string(cur.hit_count[b[j]]));
+      counts[3]++;
+    }
+
+    i++;
+    j++;
+  }
+
+  out.flush();
+
+  if (!silent)
+    cout << "Diff: " << counts[0] << " newly failing, " << counts[1] << " newly passing, "
+        << counts[2] << " newly missing, " << counts[3] << " hit count changes, " << counts[4]
+        << " added, " << counts[5] << " removed (" << file << ")\n";
+
+  return counts[0];
+}
+
+/*
+ * Query predicates, all of them must hold
+ */
+typedef struct {
+  string status;
+  string type;
+  string location;
+  string name;
+  string kind;
+  bool has_min;
+  int64_t min_hits;
+  bool has_max;
+  int64_t max_hits;
+} query_t;
+
+/*
+ * @brief ANDs sel with the rows whose dictionary column value is accepted
+ * @param ok One flag per dictionary entry
+ */
+static void select_dict(vector<uint64_t> &sel, const vector<uint32_t> &col,
+    const vector<uint8_t> &ok) {
+
+  size_t rows = col.size();
+
+  for (size_t w = 0; w < sel.size(); ++w) {
+    if (!sel[w])
+      continue;
+
+    uint64_t bits = 0;
+    size_t end = std::min(rows, w * 64 + 64);
+
+    for (size_t i = w * 64; i < end; ++i)
+      bits |= (uint64_t) ok[col[i]] << (i % 64);
+
+    sel[w] &= bits;
+  }
+}
+
+/*
+ * @brief Flags the dictionary entries that pass a string predicate
+ * @param how 'e' exact, 'p' prefix, 's' substring
+ */
+static vector<uint8_t> match_dict(const vector<string> &dict, const string &ref, char how) {
+
+  vector<uint8_t> ok(dict.size(), 0);
+
+  for (size_t i = 0; i < dict.size(); ++i) {
+    switch (how) {
+    case 'e':
+      ok[i] = dict[i] == ref;
+      break;
+    case 'p':
+      ok[i] = !dict[i].compare(0, ref.size(), ref);
+      break;
+    default:
+      ok[i] = dict[i].find(ref) != string::npos;
+      break;
+    }
+  }
+
+  return ok;
+}
+
+/*
+ * @brief Evaluates the query over the columns of a table
+ * @return One bit per selected row
+ */
+static vector<uint64_t> run_query(const results_table_t &t, const query_t &q) {
+
+  size_t rows = results_rows(t);
+  vector<uint64_t> sel(nof_words(rows), ~0ULL);
+
+  if (rows % 64)
+    sel.back() = (1ULL << (rows % 64)) - 1;
+
+  if (!q.status.empty()) {
+    if (q.status == "fail") {
+      for (size_t w = 0; w < sel.size(); ++w)
+        sel[w] &= t.fail[w];
+    } else if (q.status == "missing") {
+      for (size_t w = 0; w < sel.size(); ++w)
+        sel[w] &= t.missing[w];
+    } else if (q.status == "pass") {
+      for (size_t w = 0; w < sel.size(); ++w)
+        sel[w] &= ~(t.fail[w] | t.missing[w]);
+    } else {
+      select_dict(sel, t.status, match_dict(t.dict, q.status, 'e'));
+    }
+  }
+
+  if (!q.type.empty())
+    select_dict(sel, t.type, match_dict(t.dict, q.type, 'e'));
+
+  if (!q.location.empty())
+    select_dict(sel, t.location, match_dict(t.dict, q.location, 'p'));
+
+  if (!q.name.empty())
+    select_dict(sel, t.name, match_dict(t.dict, q.name, 's'));
+
+  if (!q.kind.empty()) {
+    char k = (q.kind == "unit") ? 'd' : (q.kind == "instance") ? 's' : 'f';
+
+    for (size_t w = 0; w < sel.size(); ++w) {
+      uint64_t bits = 0;
+      size_t end = std::min(rows, w * 64 + 64);
+
+      for (size_t i = w * 64; i < end; ++i)
+        bits |= (uint64_t) (t.kind[i] == k) << (i % 64);
+
+      sel[w] &= bits;
+    }
+  }
+
+  if (q.has_min || q.has_max) {
+    int64_t lo = q.has_min ? q.min_hits : INT64_MIN;
+    int64_t hi = q.has_max ? q.max_hits : INT64_MAX;
+
+    for (size_t w = 0; w < sel.size(); ++w) {
+      if (!sel[w])
+        continue;
+
+      uint64_t bits = 0;
+      size_t end = std::min(rows, w * 64 + 64);
+
+      for (size_t i = w * 64; i < end; ++i)
+        bits |= (uint64_t) (t.hit_count[i] >= lo && t.hit_count[i] <= hi) << (i % 64);
+
+      sel[w] &= bits;
+    }
+  }
+
+  return sel;
+}
+
+static void query_usage() {
+  cerr << "Usage: coverage_lens query [--status fail|missing|pass|<status>] [--type <type>]\n"
+      << "         [--location <prefix>] [--name <substring>] [--kind unit|instance|file]\n"
+      << "         [--min-hits <n>] [--max-hits <n>] [--distinct] [--count] <results file>...\n";
+}
+
+/*
+ * @brief Implements "coverage_lens query [predicates] <results files>"
+ * @param argc Number of arguments after "query"
+ * @param argv Arguments after "query"
+ * @return 0 on success
+ */
+int query_main(int argc, char **argv) {
+
+  query_t q;
+  vector<string> files;
+  bool distinct = false;
+  bool count_only = false;
+
+  q.has_min = q.has_max = false;
+
+  for (int i = 0; i < argc; ++i) {
+    string arg = argv[i];
+
+    if (arg == "--distinct") {
+      distinct = true;
+    } else if (arg == "--count") {
+      count_only = true;
+    } else if (arg.compare(0, 2, "--") == 0) {
+      if (i + 1 == argc) {
+        query_usage();
+        return 2;
+      }
+
+      string val = argv[++i];
+
+      if (arg == "--status")
+        q.status = val;
+      else if (arg == "--type")
+        q.type = val;
+      else if (arg == "--location")
+        q.location = val;
+      else if (arg == "--name")
+        q.name = val;
+      else if (arg == "--kind")
+        q.kind = val;
+      else if (arg == "--min-hits") {
+        q.has_min = true;
+        q.min_hits = atoll(val.c_str());
+      } else if (arg == "--max-hits") {
+        q.has_max = true;
+        q.max_hits = atoll(val.c_str());
+      } else {
+        query_usage();
+        return 2;
+      }
+    } else {
+      files.push_back(arg);
+    }
+  }
+
+  if (files.empty()) {
+    query_usage();
+    return 2;
+  }
+
+  // Check identity => (number of files in which it was selected, last of them)
+  map<string, pair<uint32_t, size_t> > seen;
+  uint64_t total = 0;
+
+  for (size_t f = 0; f < files.size(); ++f) {
+    const string &file = files[f];
+    results_table_t t;
+
+    if (results_load(file, t)) {
+      cerr << "*CL_ERR: Could not read results file " << file << "!\n";
+      return 1;
+    }
+
+    vector<uint64_t> sel = run_query(t, q);
+
+    for (size_t w = 0; w < sel.size(); ++w) {
+      uint64_t bits = sel[w];
+
+      while (bits) {
+        size_t i = w * 64 + __builtin_ctzll(bits);
+        bits &= bits - 1;
+        total++;
+
+        if (count_only)
+          continue;
+
+        string row = string(kind_name(t.kind[i])) + "\t" + t.dict[t.type[i]] + "\t"
+            + t.dict[t.location[i]] + "\t" + t.dict[t.name[i]] + "\t" + to_string(t.line[i]);
+
+        if (distinct) {
+          auto &x = seen[row];
+
+          if (!x.first || x.second != f) {
+            x.first++;
+            x.second = f;
+          }
+        } else
+          cout << file << "\t" << row << "\t" << t.hit_count[i] << "\t" << t.dict[t.status[i]]
+              << "\n";
+      }
+    }
+  }
+
+  if (count_only)
+    cout << total << "\n";
+  else if (distinct)
+    for (auto &x : seen)
+      cout << x.second.first << "\t" << x.first << "\n";
+
+  return 0;
+}
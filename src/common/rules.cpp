@@ -0,0 +1,410 @@
+/******************************************************************************
+ * (C) Copyright 2017 AMIQ Consulting
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *******************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "rules.hpp"
+
+using std::to_string;
+
+enum rule_opcode {
+  RULE_NUM,     // reg = <numeric field> <cmp> num
+  RULE_STR,     // reg = <string field> <cmp> strings[arg]
+  RULE_NOT,     // reg = !reg
+  RULE_JF,      // if (!reg) goto arg
+  RULE_JT       // if (reg) goto arg
+};
+
+enum rule_field {
+  RF_TYPE, RF_NAME, RF_LOCATION, RF_COMMENT, RF_GENERATOR,  // strings
+  RF_LINE, RF_HIT_COUNT, RF_GENERATOR_LINE, RF_FOUND, RF_NEGATED
+};
+
+enum rule_cmp {
+  RC_EQ, RC_NE, RC_LT, RC_LE, RC_GT, RC_GE, RC_CONTAINS
+};
+
+static const char *field_names[] = { "type", "name", "location", "comment", "generator", "line",
+    "hit_count", "generator_line", "found", "negated" };
+
+#define NOF_FIELDS (sizeof(field_names) / sizeof(field_names[0]))
+
+static inline bool is_string_field(int f) {
+  return f <= RF_GENERATOR;
+}
+
+static inline const string &string_field(const node_info_t &inf, int f) {
+  switch (f) {
+  case RF_TYPE:
+    return inf.type;
+  case RF_NAME:
+    return inf.name;
+  case RF_LOCATION:
+    return inf.location;
+  case RF_COMMENT:
+    return inf.comment;
+  default:
+    return inf.generator;
+  }
+}
+
+static inline int64_t num_field(const node_info_t &inf, int f) {
+  switch (f) {
+  case RF_LINE:
+    return inf.line;
+  case RF_HIT_COUNT:
+    return inf.hit_count;
+  case RF_GENERATOR_LINE:
+    return inf.generator_line;
+  case RF_FOUND:
+    return inf.found;
+  default:
+    return inf.negated;
+  }
+}
+
+/*
+ * Recursive descent parser, emits code while parsing:
+ *   rule  := or "=>" word
+ *   or    := and ("||" and)*
+ *   and   := unary ("&&" unary)*
+ *   unary := "!" unary | "(" or ")" | field [cmp value]
+ */
+class rule_parser {
+
+  const string &text;
+  size_t pos;
+
+  vector<rule_op_t> &code;
+  vector<string> &strings;
+
+public:
+
+  string err;
+
+  rule_parser(const string &text, vector<rule_op_t> &code, vector<string> &strings) :
+      text(text), pos(0), code(code), strings(strings) {
+  }
+
+  void skip_ws() {
+    while (pos < text.size() && isspace((unsigned char) text[pos]))
+      pos++;
+  }
+
+  bool eat(const char *tok) {
+    skip_ws();
+
+    size_t len = strlen(tok);
+
+    if (text.compare(pos, len, tok))
+      return false;
+
+    pos += len;
+    return true;
+  }
+
+  bool fail(const string &msg) {
+    if (err.empty())
+      err = msg + " at column " + to_string(pos + 1);
+    return false;
+  }
+
+  /*
+   * @brief Reads a bare word or a quoted string
+   */
+  bool word(string &w) {
+    skip_ws();
+    w.clear();
+
+    if (pos < text.size() && text[pos] == '"') {
+      size_t end = text.find('"', pos + 1);
+
+      if (end == string::npos)
+        return fail("unterminated string");
+
+      w = text.substr(pos + 1, end - pos - 1);
+      pos = end + 1;
+      return true;
+    }
+
+    while (pos < text.size() && !isspace((unsigned char) text[pos])
+        && !strchr("=!<>~&|()\"", text[pos]))
+      w += text[pos++];
+
+    return !w.empty() || fail("expected a word");
+  }
+
+  void emit(uint8_t op, uint8_t field = 0, uint8_t cmp = 0, uint32_t arg = 0, int64_t num = 0) {
+    rule_op_t o = { op, field, cmp, arg, num };
+    code.push_back(o);
+  }
+
+  bool condition() {
+    string f;
+
+    if (!word(f))
+      return false;
+
+    size_t field = 0;
+
+    while (field < NOF_FIELDS && f != field_names[field])
+      field++;
+
+    if (field == NOF_FIELDS)
+      return fail("unknown field \"" + f + "\"");
+
+    // Longest operators first
+    static const char *ops[] = { "==", "!=", "<=", ">=", "<", ">", "~" };
+    static const uint8_t cmps[] = { RC_EQ, RC_NE, RC_LE, RC_GE, RC_LT, RC_GT, RC_CONTAINS };
+    int op = -1;
+
+    for (int i = 0; i < 7 && op < 0; ++i) {
+      skip_ws();
+
+      // "=>" ends the condition, it is not a comparison
+      if (!text.compare(pos, 2, "=>"))
+        break;
+
+      if (eat(ops[i]))
+        op = i;
+    }
+
+    // A field alone is true when not 0 (e.g. "found")
+    if (op < 0) {
+      if (is_string_field(field))
+        return fail("\"" + f + "\" needs a comparison");
+
+      emit(RULE_NUM, field, RC_NE, 0, 0);
+      return true;
+    }
+
+    string value;
+
+    if (!word(value))
+      return false;
+
+    if (is_string_field(field)) {
+      if (cmps[op] != RC_EQ && cmps[op] != RC_NE && cmps[op] != RC_CONTAINS)
+        return fail("only ==, != and ~ apply to \"" + f + "\"");
+
+      strings.push_back(value);
+      emit(RULE_STR, field, cmps[op], strings.size() - 1);
+      return true;
+    }
+
+    if (cmps[op] == RC_CONTAINS)
+      return fail("~ does not apply to \"" + f + "\"");
+
+    char *end;
+    int64_t num = strtoll(value.c_str(), &end, 10);
+
+    if (*end)
+      return fail("\"" + value + "\" is not a number");
+
+    emit(RULE_NUM, field, cmps[op], 0, num);
+    return true;
+  }
+
+  bool unary() {
+    if (eat("!")) {
+      if (!unary())
+        return false;
+
+      emit(RULE_NOT);
+      return true;
+    }
+
+    if (eat("(")) {
+      if (!disjunction())
+        return false;
+
+      return eat(")") || fail("expected )");
+    }
+
+    return condition();
+  }
+
+  bool conjunction() {
+    if (!unary())
+      return false;
+
+    while (eat("&&")) {
+      size_t jump = code.size();
+
+      emit(RULE_JF);
+
+      if (!unary())
+        return false;
+
+      code[jump].arg = code.size();
+    }
+
+    return true;
+  }
+
+  bool disjunction() {
+    if (!conjunction())
+      return false;
+
+    while (eat("||")) {
+      size_t jump = code.size();
+
+      emit(RULE_JT);
+
+      if (!conjunction())
+        return false;
+
+      code[jump].arg = code.size();
+    }
+
+    return true;
+  }
+
+  /*
+   * @brief Parses a whole rule
+   * @param target Receives the class after "=>"
+   */
+  bool rule(string &target) {
+    if (!disjunction())
+      return false;
+
+    if (!eat("=>"))
+      return fail("expected =>");
+
+    if (!word(target))
+      return false;
+
+    skip_ws();
+
+    return pos == text.size() || fail("unexpected text");
+  }
+};
+
+/*
+ * @brief Compiles a rule and appends it to the set
+ * @param text The rule: <condition> => <class>
+ * @param err Receives a message if the rule is invalid
+ * @return 0 on success
+ */
+int rule_set::add(const string &text, string &err) {
+
+  size_t code_size = code.size();
+  size_t nof_strings = strings.size();
+
+  rule_parser p(text, code, strings);
+  string target;
+
+  if (!p.rule(target)) {
+    code.resize(code_size);
+    strings.resize(nof_strings);
+    err = p.err;
+    return 1;
+  }
+
+  rule_t r = { (uint32_t) code_size, (uint32_t) code.size(), 0 };
+
+  while (r.target < names.size() && names[r.target] != target)
+    r.target++;
+
+  if (r.target == names.size())
+    names.push_back(target);
+
+  rules.push_back(r);
+
+  return 0;
+}
+
+bool rule_set::eval(const rule_t &r, const node_info_t &inf) const {
+
+  bool reg = false;
+  uint32_t pc = r.begin;
+
+  while (pc < r.end) {
+    const rule_op_t &o = code[pc];
+
+    switch (o.op) {
+    case RULE_NUM: {
+      int64_t x = num_field(inf, o.field);
+
+      switch (o.cmp) {
+      case RC_EQ:
+        reg = x == o.num;
+        break;
+      case RC_NE:
+        reg = x != o.num;
+        break;
+      case RC_LT:
+        reg = x < o.num;
+        break;
+      case RC_LE:
+        reg = x <= o.num;
+        break;
+      case RC_GT:
+        reg = x > o.num;
+        break;
+      default:
+        reg = x >= o.num;
+        break;
+      }
+      break;
+    }
+    case RULE_STR: {
+      const string &s = string_field(inf, o.field);
+      const string &c = strings[o.arg];
+
+      if (o.cmp == RC_CONTAINS)
+        reg = s.find(c) != string::npos;
+      else
+        reg = (s == c) == (o.cmp == RC_EQ);
+      break;
+    }
+    case RULE_NOT:
+      reg = !reg;
+      break;
+    case RULE_JF:
+      if (!reg) {
+        pc = o.arg;
+        continue;
+      }
+      break;
+    case RULE_JT:
+      if (reg) {
+        pc = o.arg;
+        continue;
+      }
+      break;
+    }
+
+    pc++;
+  }
+
+  return reg;
+}
+
+/*
+ * @brief Finds the first rule that holds for an item
+ * @return Index of its class in targets(), -1 if no rule holds
+ */
+int rule_set::match(const node_info_t &inf) const {
+
+  for (size_t i = 0; i < rules.size(); ++i)
+    if (eval(rules[i], inf))
+      return rules[i].target;
+
+  return -1;
+}
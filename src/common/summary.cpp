@@ -0,0 +1,175 @@
+/******************************************************************************
+ * (C) Copyright 2017 AMIQ Consulting
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *******************************************************************************/
+
+#include <iostream>
+#include <fstream>
+
+#include "summary.hpp"
+#include "formatter.hpp"
+
+using std::cerr;
+using std::ifstream;
+
+/*
+ * @brief Adds b to a
+ */
+void summary_add(summary_count_t &a, const summary_count_t &b) {
+  a.passed += b.passed;
+  a.failed += b.failed;
+  a.missing += b.missing;
+  a.hits += b.hits;
+}
+
+/*
+ * @brief Counts one check result in a node
+ */
+void summary_count(summary_node_t &s, const string &type, const string &result, int64_t hits) {
+
+  summary_count_t one = { 0, 0, 0, hits };
+
+  if (!result.compare("fail"))
+    one.failed = 1;
+  else if (!result.compare("missing"))
+    one.missing = 1;
+  else
+    one.passed = 1;
+
+  summary_add(s.total, one);
+  summary_add(s.types[type], one);
+}
+
+static inline uint64_t nof_checks(const summary_count_t &c) {
+  return c.passed + c.failed + c.missing;
+}
+
+/*
+ * @brief Adds the totals of a child to its parent
+ * @param listed keep the child (if it is not empty) in the hierarchy
+ */
+void summary_add_child(summary_node_t &parent, summary_node_t &child, bool listed) {
+
+  if (!nof_checks(child.total))
+    return;
+
+  summary_add(parent.total, child.total);
+
+  for (auto &t : child.types)
+    summary_add(parent.types[t.first], t.second);
+
+  if (!listed)
+    return;
+
+  // A scope that only leads to another one is shown together with it
+  summary_node_t *kept = &child;
+  string name = child.name;
+
+  while (kept->children.size() == 1
+      && nof_checks(kept->children[0].total) == nof_checks(kept->total)) {
+    kept = &kept->children[0];
+    name += "/" + kept->name;
+  }
+
+  parent.children.push_back(summary_node_t());
+
+  summary_node_t &dst = parent.children.back();
+
+  dst.name.swap(name);
+  dst.total = kept->total;
+  dst.types.swap(kept->types);
+  dst.children.swap(kept->children);
+}
+
+static void put_counts(out_buffer &b, const summary_count_t &c) {
+  b.put("<td>").put_int(c.passed).put("</td><td>").put_int(c.failed).put("</td><td>");
+  b.put_int(c.missing).put("</td><td>").put_int(c.hits).put("</td>");
+}
+
+static const char *class_name(const summary_count_t &c) {
+  return c.failed ? "fail" : (c.missing ? "missing" : "default");
+}
+
+/*
+ * @brief Writes a node and its children, nested in <details> elements
+ */
+static void put_node(out_buffer &b, const summary_node_t &s, bool open) {
+
+  b.put(open ? "<details open>\n<summary class=\"" : "<details>\n<summary class=\"");
+  b.put(class_name(s.total)).put("\">").put_html(s.name.empty() ? "/" : s.name);
+  b.put(" &mdash; ").put_int(s.total.passed).put(" passed, ").put_int(s.total.failed);
+  b.put(" failed, ").put_int(s.total.missing).put(" missing, ").put_int(s.total.hits);
+  b.put(" hits</summary>\n");
+
+  b.put("<table>\n<tr><th>Type</th><th>Passed</th><th>Failed</th><th>Missing</th><th>Hits</th></tr>\n");
+
+  for (auto &t : s.types) {
+    b.put("<tr class=\"").put(class_name(t.second)).put("\"><td>").put_html(t.first).put("</td>");
+    put_counts(b, t.second);
+    b.put("</tr>\n");
+  }
+
+  b.put("</table>\n<div style=\"margin-left:20px\">\n");
+
+  for (auto &c : s.children)
+    put_node(b, c, false);
+
+  b.put("</div>\n</details>\n");
+}
+
+/*
+ * @brief Writes the summary as a collapsible HTML hierarchy
+ * @param file Output file
+ * @param testname Name of the test, may be empty
+ * @param trees One root per tree, named after the tree
+ * @return 0 on success
+ */
+int summary_html(const string &file, const string &testname, const vector<summary_node_t> &trees) {
+
+  out_file report(file);
+
+  if (!report.is_open()) {
+    cerr << "*CL_ERR: Could not write " << file << "!\n";
+    return 1;
+  }
+
+  out_buffer b(&report);
+  ifstream style_in("./includes/style.css");
+  string line;
+
+  b.put("<!DOCTYPE html>\n<html>\n<style>\n");
+
+  while (getline(style_in, line))
+    b.put(line).put('\n');
+
+  b.put("</style>\n<b><p style=\"font-size:25px\"><head>Coverage Lens summary");
+
+  if (!testname.empty())
+    b.put(" for test: \"").put_html(testname).put("\"");
+
+  b.put("</head></p></b>\n");
+
+  summary_count_t all = { 0, 0, 0, 0 };
+
+  for (auto &t : trees) {
+    summary_add(all, t.total);
+    put_node(b, t, true);
+  }
+
+  b.put("<br>\n<div class=\"topcorner\"> Failed checks: ").put_int(all.failed).put("</div>\n");
+  b.put("</html>\n");
+
+  return 0;
+}
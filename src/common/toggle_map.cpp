@@ -0,0 +1,469 @@
+/******************************************************************************
+ * (C) Copyright 2017 AMIQ Consulting
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *******************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include "toggle_map.hpp"
+
+/*
+ * @brief Splits the scope of a toggle bin into the location of the signal, its name
+ * @brief and the bit: "top/dut/data[3]" and "top/dut/data/data[3]" give "top/dut",
+ * @brief "data", 3; scalars ("top/dut/en") are bit 0.
+ * @return false if the scope has no location
+ */
+bool toggle_split(const string &hier, string &location, string &signal, int64_t &bit) {
+
+  size_t sep = hier.find_last_of('/');
+
+  if (sep == string::npos || sep == 0 || sep == hier.size() - 1)
+    return false;
+
+  location = hier.substr(0, sep);
+  signal = hier.substr(sep + 1);
+  bit = 0;
+
+  size_t lb = signal.find_last_of('[');
+
+  if (lb == string::npos || lb == 0 || signal[signal.size() - 1] != ']' || lb + 2 == signal.size()
+      || signal.find_first_not_of("0123456789", lb + 1) != signal.size() - 1)
+    return true;
+
+  bit = atoll(signal.c_str() + lb + 1);
+  signal.erase(lb);
+
+  // Bits of a vector can be scopes of their own, under the vector
+  sep = location.find_last_of('/');
+
+  if (sep != string::npos && sep > 0 && !location.compare(sep + 1, string::npos, signal))
+    location.erase(sep);
+
+  return true;
+}
+
+/*
+ * @brief Edge of a toggle bin, from its name: TOGGLE_RISE for 0->1 ("0L->1H", "0 -> 1",
+ * @brief "rise"), TOGGLE_FALL for 1->0 and 0 for the others (to or from Z and X)
+ */
+char toggle_edge(const char *name) {
+
+  if (name == NULL)
+    return 0;
+
+  if (!strncmp(name, "rise", 4))
+    return TOGGLE_RISE;
+
+  if (!strncmp(name, "fall", 4))
+    return TOGGLE_FALL;
+
+  const char *to = strstr(name, "->");
+
+  if (to == NULL)
+    return 0;
+
+  for (to += 2; *to == ' '; ++to)
+    ;
+
+  while (*name == ' ')
+    ++name;
+
+  if (*name == '0' && *to == '1')
+    return TOGGLE_RISE;
+
+  if (*name == '1' && *to == '0')
+    return TOGGLE_FALL;
+
+  return 0;
+}
+
+/*
+ * @brief Parses the signal of a toggle check: "data", "data_*", "data[3]", "data[7:0]"
+ * @param pattern the signal, with an optional bit or part select
+ * @param glob receives the name, '*' and '?' match any chars and any char
+ * @param first receives the first bit checked
+ * @param last receives the last bit checked, first > last to check all the bits
+ * @return true if the pattern is valid
+ */
+bool toggle_parse_pattern(const string &pattern, string &glob, int64_t &first, int64_t &last) {
+
+  size_t lb = pattern.find('[');
+
+  first = 0;
+  last = -1;
+
+  if (lb == string::npos) {
+    glob = pattern;
+
+    return !glob.empty() && glob.find(']') == string::npos;
+  }
+
+  if (lb == 0 || pattern[pattern.size() - 1] != ']')
+    return false;
+
+  glob = pattern.substr(0, lb);
+
+  string sel = pattern.substr(lb + 1, pattern.size() - lb - 2);
+  size_t colon = sel.find(':');
+  string msb = sel.substr(0, colon);
+  string lsb = (colon == string::npos) ? msb : sel.substr(colon + 1);
+
+  if (msb.empty() || lsb.empty() || msb.find_first_not_of("0123456789") != string::npos
+      || lsb.find_first_not_of("0123456789") != string::npos)
+    return false;
+
+  first = std::min(atoll(msb.c_str()), atoll(lsb.c_str()));
+  last = std::max(atoll(msb.c_str()), atoll(lsb.c_str()));
+
+  return last < TOGGLE_MAX_BIT;
+}
+
+/*
+ * @brief Matches a name against a pattern where '*' stands for any chars and '?'
+ * @brief for any char
+ */
+static bool toggle_glob(const string &glob, const string &name) {
+
+  size_t g = 0, n = 0;
+  size_t star = string::npos, resume = 0;
+
+  while (n < name.size()) {
+    if (g < glob.size() && (glob[g] == '?' || glob[g] == name[n])) {
+      g++;
+      n++;
+    } else if (g < glob.size() && glob[g] == '*') {
+      // Try the shortest match first, come back here on a mismatch
+      star = g++;
+      resume = n;
+    } else if (star != string::npos) {
+      g = star + 1;
+      n = ++resume;
+    } else {
+      return false;
+    }
+  }
+
+  while (g < glob.size() && glob[g] == '*')
+    g++;
+
+  return g == glob.size();
+}
+
+/*
+ * @brief Returns true if a bit of a signal rose and fell
+ */
+static bool toggle_bit(const toggle_bits_t &t, int64_t bit) {
+
+  if (bit < t.low || bit > t.high)
+    return false;
+
+  return ((t.words[bit >> 5] >> (2 * (bit & 31))) & 3) == 3;
+}
+
+/*
+ * @brief Records a toggle bin in the state of its signal
+ * @param t state of the signal
+ * @param bit bit of the signal
+ * @param edge TOGGLE_RISE or TOGGLE_FALL
+ * @param hit true if the bin was hit
+ */
+void toggle_mark(toggle_bits_t &t, int64_t bit, char edge, bool hit) {
+
+  if (bit < 0 || bit >= TOGGLE_MAX_BIT)
+    return;
+
+  if (t.high < t.low) {
+    t.low = bit;
+    t.high = bit;
+  } else {
+    t.low = std::min(t.low, bit);
+    t.high = std::max(t.high, bit);
+  }
+
+  if (t.words.size() <= (size_t) (bit >> 5))
+    t.words.resize((bit >> 5) + 1, 0);
+
+  if (hit)
+    t.words[bit >> 5] |= 1ULL << (2 * (bit & 31) + (edge == TOGGLE_FALL));
+}
+
+/*
+ * @brief Adds the toggles of b to a (as if both were seen in the same UCISDB)
+ */
+void toggle_merge(toggle_bits_t &a, const toggle_bits_t &b) {
+
+  if (b.high < b.low)
+    return;
+
+  if (a.high < a.low) {
+    a = b;
+    return;
+  }
+
+  a.low = std::min(a.low, b.low);
+  a.high = std::max(a.high, b.high);
+
+  if (a.words.size() < b.words.size())
+    a.words.resize(b.words.size(), 0);
+
+  for (size_t i = 0; i < b.words.size(); ++i)
+    a.words[i] |= b.words[i];
+}
+
+/*
+ * @brief Returns true for the queries of toggle checks (<signal>/o/, O/ for all the
+ * @brief signals under a location) and of toggle bins
+ */
+bool toggle_query(const string &query) {
+  size_t n = query.size();
+
+  return n >= 2 && query[n - 1] == '/' && (query[n - 2] == 'o' || query[n - 2] == 'O')
+      && (n == 2 || query[n - 3] == '/');
+}
+
+/*
+ * @brief Adds a toggle check
+ * @param tree 0 for instance, 1 for design unit and 2 for source file checks
+ * @param query query of the check, as given to top_tree::add
+ * @param node its node in the trie, where the results go
+ */
+void toggle_map::add(int tree, const string &query, excl_tree *node) {
+
+  if (tree < 0 || tree > 2 || !toggle_query(query))
+    return;
+
+  // The same check given twice
+  for (auto &c : checks)
+    if (c.node == node)
+      return;
+
+  toggle_check_t c;
+  string location;
+  size_t n = query.size();
+
+  c.node = node;
+  c.first = 0;
+  c.last = -1;
+
+  if (query[n - 2] == 'O') {
+    // <location>/O/: every signal under the location
+    location = query.substr(0, n - 2);
+  } else {
+    // <location>/<signal>/o/
+    size_t end = n - 3;
+    size_t sep = (end == 0) ? string::npos : query.find_last_of('/', end - 1);
+
+    location = (sep == string::npos) ? "" : query.substr(0, sep + 1);
+
+    string pattern = query.substr(location.size(), end - location.size());
+
+    if (!toggle_parse_pattern(pattern, c.glob, c.first, c.last))
+      return;
+  }
+
+  if (!location.empty() && location[location.size() - 1] == '/')
+    location.erase(location.size() - 1);
+
+  c.depth = location.size();
+
+  checks.push_back(c);
+  locations[tree][location].push_back(checks.size() - 1);
+
+  // No location ends in '/', so nothing is cached anymore
+  for (int i = 0; i < 3; ++i) {
+    last_location[i] = "/";
+    last_checks[i].clear();
+  }
+}
+
+/*
+ * @brief Finds the checks that can match the bins of a location: its own and the
+ * @brief checks on all the signals of the locations above
+ */
+void toggle_map::lookup(int tree, const string &location) {
+
+  if (location == last_location[tree])
+    return;
+
+  last_location[tree] = location;
+  last_checks[tree].clear();
+
+  const unordered_map<string, vector<size_t> > &index = locations[tree];
+  auto it = index.find(location);
+
+  if (it != index.end())
+    last_checks[tree] = it->second;
+
+  for (size_t pos = location.find_last_of('/'); pos != string::npos && pos > 0;
+      pos = location.find_last_of('/', pos - 1)) {
+
+    it = index.find(location.substr(0, pos));
+
+    if (it == index.end())
+      continue;
+
+    for (size_t i : it->second)
+      if (checks[i].glob.empty())
+        last_checks[tree].push_back(i);
+  }
+}
+
+/*
+ * @brief Passes a toggle bin to the checks that match it
+ * @param tree 0 for instance, 1 for design unit and 2 for source file queries
+ * @param query <location>/<signal>/<bit>/<edge>/o/
+ * @param cov_val hit count of the bin
+ * @param attribution tests of the bin, if hits are attributed
+ * @param hit if set, receives the nodes of the checks the bin matched
+ */
+void toggle_map::run(int tree, const string &query, int64_t cov_val,
+    test_attribution *attribution, vector<excl_tree*> *hit) {
+
+  size_t n = query.size();
+
+  if (tree < 0 || tree > 2 || n < 10 || query[n - 2] != 'o' || query[n - 5] != '/')
+    return;
+
+  char edge = query[n - 4];
+  size_t bit_end = n - 5;
+  size_t sig_end = query.find_last_of('/', bit_end - 1);
+
+  if (sig_end == string::npos || sig_end == 0)
+    return;
+
+  size_t loc_end = query.find_last_of('/', sig_end - 1);
+
+  if (loc_end == string::npos)
+    return;
+
+  string location = query.substr(0, loc_end);
+
+  lookup(tree, location);
+
+  if (last_checks[tree].empty())
+    return;
+
+  string signal = query.substr(loc_end + 1, sig_end - loc_end - 1);
+  int64_t bit = atoll(query.c_str() + sig_end + 1);
+
+  for (size_t i : last_checks[tree]) {
+    toggle_check_t &c = checks[i];
+
+    if (!c.glob.empty() && !toggle_glob(c.glob, signal))
+      continue;
+
+    if (c.first <= c.last && (bit < c.first || bit > c.last))
+      continue;
+
+    // Signals below the location of the check are named from there
+    node_info_t *inf = c.node->inf;
+
+    if (c.depth < location.size())
+      toggle_mark(inf->toggle_bits[location.substr(c.depth + (c.depth > 0)) + "/" + signal], bit,
+          edge, cov_val > 0);
+    else
+      toggle_mark(inf->toggle_bits[signal], bit, edge, cov_val > 0);
+
+    c.node->found = true;
+    c.node->times_hit += cov_val;
+
+    inf->found = true;
+    inf->hit_count += cov_val;
+
+    const vector<uint32_t> *tests;
+
+    if (attribution && (tests = attribution->current_tests()))
+      merge_tests(inf->tests, *tests);
+
+    if (hit)
+      hit->push_back(c.node);
+  }
+}
+
+/*
+ * @brief Sets the result of each check once all UCISDBs were searched: it is hit
+ * @brief only if every bit of its signals rose and fell. The number of toggled bits
+ * @brief and the untoggled ones are added to the name.
+ */
+void toggle_map::close() {
+
+  for (auto &c : checks) {
+    node_info_t *inf = c.node->inf;
+
+    if (!inf || inf->toggle_bits.empty())
+      continue;
+
+    int64_t nof_bits = 0;
+    int64_t nof_toggled = 0;
+    size_t nof_runs = 0;
+    string untoggled;
+
+    for (auto &s : inf->toggle_bits) {
+      const toggle_bits_t &t = s.second;
+      bool ranged = c.first <= c.last;
+
+      // A part select checks its bits even if some were not in the UCISDB
+      int64_t first = ranged ? c.first : t.low;
+      int64_t last = ranged ? c.last : t.high;
+      bool scalar = !ranged && t.low == 0 && t.high == 0;
+
+      for (int64_t b = first; b <= last; ++b) {
+        nof_bits++;
+
+        if (toggle_bit(t, b)) {
+          nof_toggled++;
+          continue;
+        }
+
+        // Extend to the end of the run of untoggled bits
+        int64_t e = b;
+
+        while (e < last && !toggle_bit(t, e + 1))
+          ++e;
+
+        nof_bits += e - b;
+
+        if (nof_runs++ < TOGGLE_MAX_LISTED) {
+          if (!untoggled.empty())
+            untoggled += ", ";
+
+          untoggled += s.first;
+
+          if (!scalar)
+            untoggled += "[" + (e > b ? to_string(e) + ":" : "") + to_string(b) + "]";
+        }
+
+        b = e;
+      }
+    }
+
+    inf->name += " (" + to_string(nof_toggled) + " of " + to_string(nof_bits) + " bits toggled";
+
+    if (nof_runs) {
+      inf->name += ", not toggled: " + untoggled;
+
+      if (nof_runs > TOGGLE_MAX_LISTED)
+        inf->name += ", ...";
+    }
+
+    inf->name += ")";
+
+    if (nof_toggled < nof_bits && !inf->negated)
+      inf->hit_count = 0;
+  }
+}
@@ -33,21 +33,128 @@ static ofstream top_tree_log;
  */
 void top_tree::add(const string &query, const char query_t, const node_info_t& inf, bool expanded) {
   // Select the tree and add it
+  excl_tree* leaf = NULL;
+  int tree = 0;
+
   excl_count++;
+  du_memo.clear();
+
+  for (int i = 0; i < 3; ++i)
+    record_location[i] = "/";
 
   switch (query_t) {
   case 'f':
-    this->src_tr->add(query, inf, expanded);
+    leaf = this->src_tr->add(query, inf, expanded);
+    tree = 2;
     break;
   case 'd':
-    this->du_tr->add(query, inf, expanded);
+    leaf = this->du_tr->add(query, inf, expanded);
+    tree = 1;
     break;
   case 's':
-    this->scope_tr->add(query, inf, expanded);
+    leaf = this->scope_tr->add(query, inf, expanded);
+    tree = 0;
     break;
   default:
     break;
   }
+
+  // Toggle checks are also indexed by location, their node gets the results
+  if (leaf && toggle_query(query))
+    toggles.add(tree, query, leaf);
+}
+
+/*
+ * @brief Searches the DU tree, through the results of the previous searches
+ * @param query DU query of an item
+ * @return the node of the check, NULL if none matches
+ */
+excl_tree* top_tree::find_du(const string &query) {
+
+  // No type checks: nothing to look up or to remember
+  if (du_tr->empty())
+    return NULL;
+
+  auto it = du_memo.find(query);
+
+  if (it != du_memo.end())
+    return it->second;
+
+  excl_tree *ret = du_tr->find(query);
+
+  du_memo[query] = ret;
+
+  return ret;
+}
+
+/*
+ * @brief Location of the item of a query: the query without the components that
+ * @brief name the item, e.g. <instance> for <instance>/<line>/b/
+ */
+static string query_location(const string &query) {
+  size_t n = query.size();
+  int item = 2;
+
+  if (n >= 3 && query[n - 1] == '/' && query[n - 3] == '/') {
+    switch (query[n - 2]) {
+    case 'm':   // <line>/<index>/m/
+    case 'v':   // <bin>/<index>/v/
+      item = 3;
+      break;
+    case 'o':   // <signal>/<bit>/<edge>/o/
+    case 's':   // <fsm>/states/<state>/s/
+      item = 4;
+      break;
+    case 't':   // <fsm>/trans/<from>/<to>/t/
+      item = 5;
+      break;
+    default:
+      break;
+    }
+  }
+
+  size_t end = n ? n - 1 : 0;
+
+  for (int i = 0; i < item && end > 0 && end != string::npos; ++i)
+    end = query.find_last_of('/', end - 1);
+
+  return (end == string::npos) ? "" : query.substr(0, end);
+}
+
+/*
+ * @brief Appends an item to the recorder if it can reach a check of one of the trees
+ * @brief it is searched in. Otherwise, its locations are kept: checks added later
+ * @brief under them can't be evaluated from the recorded items.
+ */
+void top_tree::record(const check_item_t &item) {
+
+  string locations[3];
+  bool reach = false;
+
+  for (int tree = 0; tree < 3; ++tree) {
+    const string &query = item.select ? item.queries[0] : item.queries[tree];
+
+    if ((item.select && !(item.select & (1 << tree))) || query.empty())
+      continue;
+
+    locations[tree] = query_location(query);
+
+    if (locations[tree] != record_location[tree]) {
+      record_location[tree] = locations[tree];
+      record_reaches[tree] = reaches(tree, locations[tree]);
+    }
+
+    reach |= record_reaches[tree];
+  }
+
+  if (reach) {
+    recorder->items.push_back(item);
+    return;
+  }
+
+  for (int tree = 0; tree < 3; ++tree)
+    if (!locations[tree].empty())
+      recorder->skipped[tree].insert(locations[tree]);
 }
 
 /*
@@ -60,9 +167,31 @@ void top_tree::run_check(const string &query, int64_t cov_val, const node_info_t
   if (query.empty())
     return;
 
+  if (recorder) {
+    check_item_t item;
+
+    item.select = select;
+    item.queries[0] = query;
+    item.cov_val = cov_val;
+    item.name = inf.name;
+    item.line = inf.line;
+    item.type = inf.type;
+
+    record(item);
+  }
+
   top_tree_log << "\n\n";
   top_tree_log << "\n query = [" << query << "]\n";
 
+  // Toggle bins go to the checks of their location
+  if (toggle_query(query)) {
+    for (int tree = 0; tree < 3; ++tree)
+      if (select & (1 << tree))
+        toggles.run(tree, query, cov_val, cov_val > 0 ? attribution : NULL);
+
+    return;
+  }
+
   excl_tree* ret;
 
   if (select & 1) {
@@ -77,6 +206,8 @@ void top_tree::run_check(const string &query, int64_t cov_val, const node_info_t
         ret->inf->name = inf.name;
       ret->inf->found = true;
       ret->inf->hit_count += cov_val;
+      ret->count_bin(query, cov_val);
+      attribute(ret->inf, cov_val);
 
       top_tree_log << "\t==> SCOPE HIT\n";
 
@@ -85,7 +216,7 @@ void top_tree::run_check(const string &query, int64_t cov_val, const node_info_t
   }
 
   if (select & 2) {
-    ret = this->du_tr->find(query);
+    ret = find_du(query);
 
     if (ret != NULL) {
       ret->times_hit += cov_val;
@@ -95,6 +226,8 @@ void top_tree::run_check(const string &query, int64_t cov_val, const node_info_t
       ret->inf->line = inf.line;
       ret->inf->found = true;
       ret->inf->hit_count += cov_val;
+      ret->count_bin(query, cov_val);
+      attribute(ret->inf, cov_val);
 
       top_tree_log << "\t==> DU HIT\n";
 
@@ -113,6 +246,8 @@ void top_tree::run_check(const string &query, int64_t cov_val, const node_info_t
       ret->inf->line = inf.line;
       ret->inf->found = true;
       ret->inf->hit_count += cov_val;
+      ret->count_bin(query, cov_val);
+      attribute(ret->inf, cov_val);
 
       top_tree_log << "\t==> SRC HIT\n";
 
@@ -124,7 +259,7 @@ void top_tree::run_check(const string &query, int64_t cov_val, const node_info_t
 
 /*
  * @brief Gets all the needed info from the UCISDB and searches in all trees
- * @param params all the info from UCISDB
+ * @param params a query for each tree, then the instance of the item, if it is known
  * @param cov_val hitcount of the item
  * @param other info from the UCISDB
  */
@@ -133,9 +268,42 @@ void top_tree::run_check(const vector<string> &params, const int64_t cov_val,
   top_tree_log << "\n\n";
   PRINT_ARR(params);
 
+  if (recorder) {
+    check_item_t item;
+
+    item.select = 0;
+    item.queries[0] = params[0];
+    item.queries[1] = params[1];
+    item.queries[2] = params[2];
+    item.cov_val = cov_val;
+    item.name = inf.name;
+    item.line = inf.line;
+    item.type = inf.type;
+
+    record(item);
+  }
+
   string query;
   excl_tree* ret;
 
+  // Hits of DU checks also go to the instance of the item
+  const string *instance = du_instances && params.size() > 3 ? &params[3] : NULL;
+
+  // Toggle bins go to the checks of their location, in each tree
+  if (toggle_query(params[0])) {
+    vector<excl_tree*> hit;
+
+    for (int tree = 0; tree < 3; ++tree)
+      if (!params[tree].empty())
+        toggles.run(tree, params[tree], cov_val, cov_val > 0 ? attribution : NULL,
+            tree == 1 && instance ? &hit : NULL);
+
+    for (excl_tree *leaf : hit)
+      count_instance(leaf, *instance, cov_val);
+
+    return;
+  }
+
   // ROUND 1: scope
   query = params[0];
 
@@ -154,13 +322,15 @@ void top_tree::run_check(const vector<string> &params, const int64_t cov_val,
     ret->inf->line = inf.line;
     ret->inf->found = true;
     ret->inf->hit_count += cov_val;
+    ret->count_bin(query, cov_val);
+    attribute(ret->inf, cov_val);
   }
 
-  // ROUND 2: du
+  // ROUND 2: du (no query if the design unit has no checks)
   query = params[1];
 
   top_tree_log << "du query = [" << query << "]\n";
-  ret = this->du_tr->find(query);
+  ret = query.empty() ? NULL : find_du(query);
 
   if (ret) {
     top_tree_log << "\t==> DU HIT\n";
@@ -173,7 +343,11 @@ void top_tree::run_check(const vector<string> &params, const int64_t cov_val,
     ret->inf->line = inf.line;
     ret->inf->found = true;
     ret->inf->hit_count += cov_val;
+    ret->count_bin(query, cov_val);
+    attribute(ret->inf, cov_val);
 
+    if (instance)
+      count_instance(ret, *instance, cov_val);
   }
 
   // ROUND 3: src_file
@@ -192,6 +366,8 @@ void top_tree::run_check(const vector<string> &params, const int64_t cov_val,
     ret->inf->line = inf.line;
     ret->inf->found = true;
     ret->inf->hit_count += cov_val;
+    ret->count_bin(query, cov_val);
+    attribute(ret->inf, cov_val);
 
     top_tree_log << "\t==> SRC HIT\n";
 
@@ -245,48 +421,144 @@ void top_tree::print_hit_map(std::ofstream &out) {
 }
 
 /*
- * @brief Generates a report using the given function and reporter
- * @param r Reporter class
- * @param f Function applied on exclusions
+ * @brief Collects the checks of all trees. Paths are prefixed with the
+ * @brief tree kind ('f', 'd' or 's').
+ * @param out pairs of path, node
  */
-void top_tree::gen_report(reporter &r, checker f) {
+void top_tree::get_leaves(vector<pair<string, excl_tree*> > &out) {
 
-  r.start();
-  r.title();
+  const char kinds[3] = { 'f', 'd', 's' };
+  excl_tree *trees[3] = { src_tr, du_tr, scope_tr };
 
-  if (!this->src_tr->empty()) {
+  for (int i = 0; i < 3; ++i) {
+    size_t first = out.size();
 
-    r.kind = 'f';
-    r.tree_title("Tests based on source files:");
-    r.tree_start();
-    // iterate tree
-    this->src_tr->iterate(f, r);
-    r.tree_end();
+    trees[i]->get_leaves(out);
 
+    for (size_t j = first; j < out.size(); ++j)
+      out[j].first.insert(out[j].first.begin(), kinds[i]);
   }
+}
 
-  if (!this->du_tr->empty()) {
+/*
+ * @brief Lists the hits of each design unit check per instance, as collected
+ * @brief in du_instances
+ * @param out where to print
+ */
+void top_tree::print_du_instances(out_buffer &out) {
+  vector<pair<string, excl_tree*> > leaves;
 
-    r.kind = 'd';
-    r.tree_title("Tests based on instance types:");
-    r.tree_start();
-    // iterate tree
-    this->du_tr->iterate(f, r);
-    r.tree_end();
+  du_tr->get_leaves(leaves);
+
+  out.put("type\tlocation\tname\tline\thit_count\tinstance\tinstance_hit_count\n");
 
+  for (auto &x : leaves) {
+    const node_info_t *inf = x.second->inf;
+    auto it = du_instances->find(x.second);
+
+    if (it == du_instances->end())
+      continue;
+
+    for (auto &i : it->second) {
+      out.put(inf->type).put('\t').put(inf->location).put('\t').put(inf->name).put('\t');
+      out.put_int(inf->line).put('\t').put_int(inf->hit_count).put('\t');
+      out.put(i.first).put('\t').put_int(i.second).put('\n');
+    }
   }
+}
+
+/*
+ * @brief Sets the results of the checks that depend on all their hits (ranges,
+ * @brief thresholds, toggles), once all UCISDBs were searched
+ */
+void top_tree::close_checks() {
+  vector<pair<string, excl_tree*> > leaves;
+
+  get_leaves(leaves);
+
+  for (auto &x : leaves)
+    x.second->close();
+
+  toggles.close();
+}
+
+/*
+ * @brief Evaluates the checks of a tree
+ * @param tr The tree
+ * @param c Checker
+ * @param infos Receives the checks, in get_checks order
+ * @param results Receives their results
+ */
+static void run_checks(const excl_tree *tr, batch_checker &c, vector<const node_info_t*> &infos,
+    vector<const string*> &results) {
 
-  if (!this->scope_tr->empty()) {
+  infos.clear();
+  tr->get_checks(infos);
 
-    r.kind = 's';
-    r.tree_title("Tests based on instances:");
+  results.resize(infos.size());
+  c.run(infos.data(), infos.size(), results.data());
+}
+
+/*
+ * @brief Generates a report using the given checker and reporter
+ * @param r Reporter class
+ * @param c Checker applied on exclusions
+ */
+void top_tree::gen_report(reporter &r, batch_checker &c) {
+
+  excl_tree *trees[] = { this->src_tr, this->du_tr, this->scope_tr };
+  const char kinds[] = { 'f', 'd', 's' };
+  const char *titles[] = { "Tests based on source files:", "Tests based on instance types:",
+      "Tests based on instances:" };
+
+  vector<const node_info_t*> infos;
+  vector<const string*> results;
+
+  r.start();
+  r.title();
+
+  for (int i = 0; i < 3; ++i) {
+
+    if (trees[i]->empty())
+      continue;
+
+    run_checks(trees[i], c, infos, results);
+
+    r.kind = kinds[i];
+    r.tree_title(titles[i]);
     r.tree_start();
-    // iterate tree
-    this->scope_tr->iterate(f, r);
+
+    r.format_batch(infos.data(), results.data(), infos.size());
+
     r.tree_end();
   }
 
   r.end();
-
 }
 
+/*
+ * @brief Aggregates the results per scope and per type, without formatting each check
+ * @param c Checker applied on exclusions
+ * @param out One root per non empty tree, named after it
+ */
+void top_tree::gen_summary(batch_checker &c, vector<summary_node_t> &out) {
+
+  excl_tree *trees[] = { this->src_tr, this->du_tr, this->scope_tr };
+  const char *titles[] = { "Tests based on source files", "Tests based on instance types",
+      "Tests based on instances" };
+
+  vector<const node_info_t*> infos;
+  vector<const string*> results;
+
+  for (int i = 0; i < 3; ++i) {
+
+    if (trees[i]->empty())
+      continue;
+
+    run_checks(trees[i], c, infos, results);
+
+    out.push_back(summary_node_t());
+    trees[i]->summarize(results.data(), out.back());
+    out.back().name = titles[i];
+  }
+}
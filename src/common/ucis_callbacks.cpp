@@ -39,6 +39,7 @@ static void print_red(const string &text, ostream &stream) {
 
 static vector<string> blocks;
 static vector<int64_t> times_hit;
+static vector<pair<ucisScopeT, int> > block_bins;   // scope and coverindex, to attribute the hits
 
 /*
  * @brief Extracts source line for a block type entry
@@ -71,9 +72,10 @@ static int64_t get_block_line(const string &hier_name) {
  * @param v Ordered vector of unique chunks start_line, index pairs
  * @param lines Associated start_line for each block
  * @param real_lines Line of blocks in src files
+ * @param db UCISDB the blocks come from
  */
 static void run_query(top_tree* excl_trie, const vector<pair<int, int> > &v,
-    const vector<int> &lines, const vector<int> &real_lines) {
+    const vector<int> &lines, const vector<int> &real_lines, ucisT db) {
   if (!v.size())
     return;
 
@@ -121,6 +123,10 @@ static void run_query(top_tree* excl_trie, const vector<pair<int, int> > &v,
       query.push_back('b');
       query.push_back('/');
 
+      if (excl_trie->attribution)
+        excl_trie->attribution->set_bin(times_hit[blk_index] > 0 ? db : NULL,
+            block_bins[blk_index].first, block_bins[blk_index].second);
+
       excl_trie->run_check(query, times_hit[blk_index], blk_info);
     }
 
@@ -142,8 +148,9 @@ static void run_query(top_tree* excl_trie, const vector<pair<int, int> > &v,
  * @brief Performs the check/ordering mentioned above on blocks.
  * @brief Only called when there's a scope switch
  * @param excl_trie Storage for the checks
+ * @param db UCISDB the blocks come from, still open
  */
-static void index_blocks(top_tree* excl_trie) {
+static void index_blocks(top_tree* excl_trie, ucisT db) {
 
   if (!blocks.size())
     return;
@@ -182,9 +189,23 @@ static void index_blocks(top_tree* excl_trie) {
       });
 
   // Finally get info about the blocks
-  run_query(excl_trie, breaking_points, min_lines, lines_simple);
+  run_query(excl_trie, breaking_points, min_lines, lines_simple, db);
+
+}
 
+#ifdef NCSIM
+/*
+ * @brief Sends an assertion counter to the checks of its assertion
+ * @param query Query of the assertion
+ * @param counter Key of the counter (see assert_counter_key)
+ */
+static void run_counter_check(top_tree* excl_trie, const string &query, int64_t cov_val,
+    node_info_t &inf, char counter) {
+  inf.type = "Assertion";
+  inf.name += string(" ") + assert_counter_name(counter);
+  excl_trie->run_check(query + counter + "/", static_cast<long int>(cov_val), inf, 1);
 }
+#endif
 
 /*
  * @brief Callback that searches for code entities in the UCISDB
@@ -196,6 +217,8 @@ ucisCBReturnT search_callback(void* userdata, ucisCBDataT* cbdata) {
   char* name;
   ucisCoverDataT coverdata;
   ucisSourceInfoT sourceinfo;
+  ucisCoverDataT query_data;
+  char counter;
   static std::vector<string> cvg_queries;
   static int num_crt;
 
@@ -223,9 +246,11 @@ ucisCBReturnT search_callback(void* userdata, ucisCBDataT* cbdata) {
    * otherwise impossible to distinguish those objects by name.
    */
   case UCIS_REASON_ENDDB:
-    index_blocks(excl_trie);
+    index_blocks(excl_trie, db);
     times_hit.clear();
     blocks.clear();
+    block_bins.clear();
+    reset_query_cache();
     break;
   case UCIS_REASON_DU:
     du->underneath = 1;
@@ -251,19 +276,41 @@ ucisCBReturnT search_callback(void* userdata, ucisCBDataT* cbdata) {
     ucis_GetCoverData(db, scope, cbdata->coverindex, &name, &coverdata, &sourceinfo);
 
     if (!(coverdata.type & UCIS_CODE_COV || coverdata.type == UCIS_CVGBIN
-        || coverdata.type == UCIS_ASSERTBIN))
+        || assert_counter_key(coverdata.type)))
       return UCIS_SCAN_CONTINUE;
 
-    if (coverdata.type == UCIS_TOGGLEBIN)
+    // Toggle bins are the bulk of a UCISDB: only look at them if they are checked
+    if (coverdata.type == UCIS_TOGGLEBIN && excl_trie->toggles.empty())
       return UCIS_SCAN_CONTINUE;
 
+    // Tests behind the hits of the bin, read only if it reaches a check
+    if (excl_trie->attribution)
+      excl_trie->attribution->set_bin(coverdata.data.int64 > 0 ? db : NULL, scope,
+          cbdata->coverindex);
+
+    // Assertion counters are searched under the query of their assertion
+    counter = assert_counter_key(coverdata.type);
+    query_data = coverdata;
+
+    if (counter)
+      query_data.type = UCIS_ASSERTBIN;
+
     if (name != NULL && name[0] != '\0') {
 
 #ifdef QUESTA
 // Questa needs all the data
       {
         node_info_t inf;
-        vector < string > queries = get_query_array(cbdata, sourceinfo, coverdata, name, inf);
+
+        if (coverdata.type == UCIS_TOGGLEBIN) {
+          vector < string > queries = get_toggle_queries(cbdata, name, inf);
+
+          if (!queries[0].empty())
+            excl_trie->run_check(queries, static_cast<long int>(coverdata.data.int64), inf);
+          break;
+        }
+
+        vector < string > queries = get_query_array(cbdata, sourceinfo, query_data, name, inf, excl_trie);
 
         if (coverdata.type == UCIS_CVGBIN) {
           inf.type = "Coverbin";
@@ -295,7 +342,7 @@ ucisCBReturnT search_callback(void* userdata, ucisCBDataT* cbdata) {
 
         }
 
-        if (coverdata.type == UCIS_ASSERTBIN) {
+        if (counter) {
           inf.type = "Assertbin";
 
           inf.name = queries[0].substr(queries[0].find("/") + 1);
@@ -303,6 +350,16 @@ ucisCBReturnT search_callback(void* userdata, ucisCBDataT* cbdata) {
 
           inf.name = inf.name.substr(0, inf.name.find_last_of("/") - 1);
           inf.name = inf.name.substr(0, inf.name.find_last_of("/"));
+
+          if (coverdata.type == UCIS_ASSERTBIN)
+            excl_trie->run_check(queries, static_cast<long int>(coverdata.data.int64), inf);
+
+          inf.type = "Assertion";
+          inf.name += string(" ") + assert_counter_name(counter);
+
+          for (auto &q : queries)
+            if (!q.empty())
+              q += string(1, counter) + "/";
         }
 
         excl_trie->run_check(queries, static_cast<long int>(coverdata.data.int64), inf);
@@ -326,14 +383,24 @@ ucisCBReturnT search_callback(void* userdata, ucisCBDataT* cbdata) {
         else
         select = 1;
 
+        // Toggles don't take part in the scope tracking below
+        if (coverdata.type == UCIS_TOGGLEBIN) {
+          vector<string> queries = get_toggle_queries(cbdata, name, inf);
+
+          if (!queries[0].empty())
+            excl_trie->run_check(queries, static_cast<long int>(coverdata.data.int64), inf);
+          break;
+        }
+
         // Get our query
-        string query = get_query(cbdata, coverdata, name, reset, inf, refinement_flag);
+        string query = get_query(cbdata, query_data, name, reset, inf, refinement_flag);
 
         // Check the blocks from the previous scope
         if (reset && refinement_flag) {
-          index_blocks(excl_trie);
+          index_blocks(excl_trie, db);
           blocks.clear();
           times_hit.clear();
+          block_bins.clear();
         }
 
         switch (coverdata.type) {
@@ -360,6 +427,19 @@ ucisCBReturnT search_callback(void* userdata, ucisCBDataT* cbdata) {
 
           excl_trie->run_check(query, static_cast<long int>(coverdata.data.int64), inf, 1);
 
+          // Failures are also counted under the assertion
+          if (counter)
+          run_counter_check(excl_trie, query, coverdata.data.int64, inf, counter);
+
+          break;
+          case UCIS_PASSBIN:
+          case UCIS_VACUOUSBIN:
+          case UCIS_DISABLEDBIN:
+          case UCIS_ATTEMPTBIN:
+          if (query[0] == '/')
+          query = query.substr(1);
+
+          run_counter_check(excl_trie, query, coverdata.data.int64, inf, counter);
           break;
           case UCIS_BLOCKBIN:
           case UCIS_BRANCHBIN:
@@ -369,6 +449,7 @@ ucisCBReturnT search_callback(void* userdata, ucisCBDataT* cbdata) {
             blocks.push_back(
                 string(ucis_GetStringProperty(db, scope, -1, UCIS_STR_SCOPE_HIER_NAME)));
             times_hit.push_back(static_cast<long int>(coverdata.data.int64));
+            block_bins.push_back(make_pair(scope, cbdata->coverindex));
             break;
           }
 
@@ -398,38 +479,96 @@ ucisCBReturnT search_callback(void* userdata, ucisCBDataT* cbdata) {
 }
 
 /**
- * @brief Callback that returns different information for functional coverage
+ * @brief Reads the weight, goal and at_least options of a covergroup, coverpoint
+ * @brief or cross. The ones that are not set in the UCISDB are taken from parent.
  */
-ucisCBReturnT functional_callback(void* userdata, ucisCBDataT* cbdata) {
+static cov_options_t get_cov_options(ucisT db, ucisScopeT scope, const cov_options_t &parent) {
+  cov_options_t o = parent;
 
-  ucisScopeT scope = (ucisScopeT) (cbdata->obj);
-  ucisT db = cbdata->db;
-  char* name;
-  ucisCoverDataT coverdata;
-  ucisSourceInfoT sourceinfo;
-  struct dustate* du = &((struct dustate*) (userdata))[3];
+  int weight = ucis_GetIntProperty(db, scope, -1, UCIS_INT_SCOPE_WEIGHT);
+  int goal = ucis_GetIntProperty(db, scope, -1, UCIS_INT_SCOPE_GOAL);
+  int at_least = ucis_GetIntProperty(db, scope, -1, UCIS_INT_CVG_ATLEAST);
 
-  static int current_bin_hits;
-  static int current_cvg_count;
-  static int current_cvp_count;
-  static int current_bin_count;
+  if (weight >= 0)
+    o.weight = weight;
 
-  static int desired_cvg_index = -1;
-  static int desired_cvp_index = -1;
-  static int desired_bin_index = -1;
+  if (goal >= 0)
+    o.goal = goal;
 
-  static int bin_count;
-  static int hit_bins;
+  if (at_least > 0)
+    o.at_least = at_least;
 
-  static int total_cvps;
-  static int hit_count;
+  return o;
+}
 
-  static string found_name;
+/**
+ * @brief Updates the options of the scopes above the bins as the scan enters a scope.
+ * @brief Bins under a cross (as items or as subscopes) know what it crosses.
+ * @brief Coverpoints and crosses get at_least from their covergroup.
+ */
+static void enter_cov_scope(ucisT db, ucisScopeT scope, cov_scope_t &s) {
 
-  static bool found_target = false;
+  switch (ucis_GetScopeType(db, scope)) {
+  case UCIS_CROSS: {
+    ucisScopeT cvp;
+    cov_options_t parent = cov_default_options();
 
-  static string old_cvg;
-  static string old_cvp;
+    s.crossed.clear();
+
+    for (int i = 0; !ucis_GetIthCrossedCvp(db, scope, i, &cvp); ++i)
+      s.crossed.push_back(ucis_GetStringProperty(db, cvp, -1, UCIS_STR_SCOPE_NAME));
+
+    parent.at_least = s.group.at_least;
+    s.point = get_cov_options(db, scope, parent);
+    break;
+  }
+  case UCIS_COVERPOINT: {
+    cov_options_t parent = cov_default_options();
+
+    s.crossed.clear();
+
+    parent.at_least = s.group.at_least;
+    s.point = get_cov_options(db, scope, parent);
+    break;
+  }
+  case UCIS_COVERGROUP:
+  case UCIS_COVERINSTANCE:
+    s.crossed.clear();
+    s.group = get_cov_options(db, scope, cov_default_options());
+    s.point = cov_default_options();
+    s.point.at_least = s.group.at_least;
+    break;
+  default:
+    break;
+  }
+}
+
+/**
+ * @brief Tells if a bin was hit at least at_least times, or its own goal if it has one
+ */
+static bool bin_covered(const ucisCoverDataT &coverdata, int64_t at_least) {
+
+  if ((coverdata.flags & UCIS_HAS_GOAL) && coverdata.goal > 0)
+    at_least = coverdata.goal;
+
+  if (at_least < 1)
+    at_least = 1;
+
+  return coverdata.data.int64 >= (uint64_t) at_least;
+}
+
+/**
+ * @brief Callback that adds the covergroup bins to a cov_index
+ */
+ucisCBReturnT index_callback(void* userdata, ucisCBDataT* cbdata) {
+
+  ucisScopeT scope = (ucisScopeT) (cbdata->obj);
+  ucisT db = cbdata->db;
+  char* name;
+  ucisCoverDataT coverdata;
+  ucisSourceInfoT sourceinfo;
+  cov_scan_t *scan = (cov_scan_t *) userdata;
+  struct dustate* du = &scan->du;
 
   switch (cbdata->reason) {
   case UCIS_REASON_DU:
@@ -439,7 +578,10 @@ ucisCBReturnT functional_callback(void* userdata, ucisCBDataT* cbdata) {
   case UCIS_REASON_SCOPE:
     if (du->underneath) {
       du->subscope_counter++;
+      break;
     }
+
+    enter_cov_scope(db, scope, scan->scope);
     break;
   case UCIS_REASON_ENDSCOPE:
     if (du->underneath) {
@@ -474,175 +616,127 @@ ucisCBReturnT functional_callback(void* userdata, ucisCBDataT* cbdata) {
     hier_str = hier_str.substr(0, hier_str.find_last_of('/'));
 #endif
 
-    int last = hier_str.find_last_of('/');
-    int almost_last = hier_str.find_last_of('/', last - 1);
-
-    string cvg_name = hier_str.substr(0, last);
-    string cvp_name = hier_str.substr(last + 1);
-    string bin_name = name;
-
-    if (cvg_name != old_cvg) {
-
-      if (desired_cvg_index != 0 && !found_target && current_cvg_count == desired_cvg_index) {
-        found_name = old_cvg;
-        hit_bins = current_bin_hits;
-        bin_count = current_bin_count;
-        found_target = true;
-      } else if (!found_target && total_cvps != 0 && total_cvps == desired_cvp_index
-          && desired_bin_index == -1) {
-        found_name = cvg_name + "/" + old_cvp;
-        hit_bins = current_bin_hits;
-        bin_count = current_bin_count;
-        found_target = true;
-      }
-
-      old_cvg = cvg_name;
-      old_cvp = cvp_name;
-
-      current_bin_count = 0;
-      current_bin_hits = 0;
+    size_t last = hier_str.find_last_of('/');
 
-      current_cvp_count = 1;
-      current_cvg_count++;
+    scan->index->add_bin(hier_str.substr(0, last), hier_str.substr(last + 1), name,
+        coverdata.data.int64, bin_covered(coverdata, scan->scope.point.at_least), scan->scope);
 
-      total_cvps++;
+    break;
+  }
+  default:
+    break;
+  }
+  return UCIS_SCAN_CONTINUE;
+}
 
-    } else if (cvp_name != old_cvp) {
+/**
+ * @brief Callback that adds the assertion counts to an assert_census
+ */
+ucisCBReturnT census_callback(void* userdata, ucisCBDataT* cbdata) {
 
-      if (!found_target && total_cvps == desired_cvp_index && desired_bin_index == -1) {
-        found_name = cvg_name + "/" + old_cvp;
-        hit_bins = current_bin_hits;
-        bin_count = current_bin_count;
-        found_target = true;
-      }
+  ucisScopeT scope = (ucisScopeT) (cbdata->obj);
+  ucisT db = cbdata->db;
+  char* name;
+  ucisCoverDataT coverdata;
+  ucisSourceInfoT sourceinfo;
+  census_scan_t *scan = (census_scan_t *) userdata;
+  struct dustate* du = &scan->du;
 
-      old_cvp = cvp_name;
+  switch (cbdata->reason) {
+  case UCIS_REASON_DU:
+    du->underneath = 1;
+    du->subscope_counter = 0;
+    break;
+  case UCIS_REASON_SCOPE:
+    if (du->underneath)
+      du->subscope_counter++;
+    break;
+  case UCIS_REASON_ENDSCOPE:
+    if (du->underneath) {
+      if (du->subscope_counter)
+        du->subscope_counter--;
+      else
+        du->underneath = 0;
+    }
+    break;
+  case UCIS_REASON_CVBIN: {
 
-      current_bin_count = 0;
-      current_bin_hits = 0;
+    // Instances hold the counts, design units would count them twice
+    if (du->underneath)
+      return UCIS_SCAN_PRUNE;
 
-      current_cvp_count++;
-      total_cvps++;
-    }
+    ucis_GetCoverData(db, scope, cbdata->coverindex, &name, &coverdata, &sourceinfo);
 
-    current_bin_count++;
+    if (!assert_counter_key(coverdata.type))
+      return UCIS_SCAN_CONTINUE;
 
-    if ((int) coverdata.data.int64)
-      current_bin_hits++;
+    string hier_str(ucis_GetStringProperty(db, scope, -1, UCIS_STR_SCOPE_HIER_NAME));
 
-    if (!found_target && desired_bin_index == current_bin_count
-        && total_cvps == desired_cvp_index) {
-      found_name = bin_name;
-      hit_count = (int) coverdata.data.int64;
-      found_target = true;
-    }
+    if (!hier_str.empty() && hier_str[0] == '/')
+      hier_str.erase(0, 1);
 
+    scan->census->add(hier_str, coverdata.type, coverdata.data.int64);
     break;
   }
-  case UCIS_REASON_INITDB: {
-
-    char *cmd = ((char **) userdata)[0];
-    char *arg1 = ((char **) userdata)[1];
-    char *arg2 = ((char **) userdata)[2];
-
-    if (!strcmp(cmd, "cvg_name")) {
-      desired_cvg_index = atoi(arg1);
-    } else if (!strcmp(cmd, "cvp_name")) {
-      desired_cvp_index = atoi(arg1);
-    } else if (!strcmp(cmd, "bin_name")) {
-      desired_cvp_index = atoi(arg1);
-      desired_bin_index = atoi(arg2);
-    } else if (!strcmp(cmd, "cvg_res")) {
-      desired_cvg_index = atoi(arg1);
-    } else if (!strcmp(cmd, "cvp_res")) {
-      desired_cvp_index = atoi(arg1);
-    } else if (!strcmp(cmd, "nof_hits")) {
-      desired_cvp_index = atoi(arg1);
-      desired_bin_index = atoi(arg2);
-    } else if (!strcmp(cmd, "nof_bins")) {
-      desired_cvp_index = atoi(arg1);
-    }
-
+  default:
     break;
   }
-  case UCIS_REASON_ENDDB: {
-
-    char *cmd = ((char **) userdata)[0];
+  return UCIS_SCAN_CONTINUE;
+}
 
-    // Treat some corner cases
-    if (desired_cvg_index == current_cvg_count) {
-      found_name = old_cvg;
+/**
+ * @brief Callback that collects the names of the hit code and functional coverage bins
+ */
+ucisCBReturnT rank_callback(void* userdata, ucisCBDataT* cbdata) {
 
-      hit_bins = current_bin_hits;
-      bin_count = current_bin_count;
-      found_target = true;
-    }
+  ucisScopeT scope = (ucisScopeT) (cbdata->obj);
+  ucisT db = cbdata->db;
+  char* name;
+  ucisCoverDataT coverdata;
+  ucisSourceInfoT sourceinfo;
+  rank_scan_t *scan = (rank_scan_t *) userdata;
 
-    if (!found_target && desired_bin_index == -1 && desired_cvp_index == total_cvps) {
-      hit_bins = current_bin_hits;
-      bin_count = current_bin_count;
-      found_name = old_cvp;
-      found_target = true;
-    }
+  switch (cbdata->reason) {
+  case UCIS_REASON_DU:
+    /* Instances hold the counts, design units would count them twice */
+    return UCIS_SCAN_PRUNE;
+  case UCIS_REASON_SCOPE:
+    enter_cov_scope(db, scope, scan->scope);
+    break;
+  case UCIS_REASON_CVBIN: {
 
-    if (!strcmp(cmd, "nof_cvgs") || !strcmp(cmd, "nof_cvps")) {
-      found_target = true;
-    }
+    ucis_GetCoverData(db, scope, cbdata->coverindex, &name, &coverdata, &sourceinfo);
 
-    cout << "\t";
+    if (!(coverdata.type & (UCIS_CODE_COV | UCIS_CVGBIN | UCIS_COVERBIN)))
+      return UCIS_SCAN_CONTINUE;
 
-    if (!found_target) {
-      print_red("Not found", cout);
-      cout << "\n";
-      return UCIS_SCAN_STOP;
-    }
+    if (scope != scan->last) {
+      const char *hier = ucis_GetStringProperty(db, scope, -1, UCIS_STR_SCOPE_HIER_NAME);
 
-    if (!strcmp(cmd, "nof_cvgs")) {
-      cout << "Number of covergroups is [";
-      print_red(to_string(current_cvg_count), cout);
-      cout << "]\n";
-    } else if (!strcmp(cmd, "cvg_name") || !strcmp(cmd, "cvp_name") || !strcmp(cmd, "bin_name")) {
-      cout << "Name is [";
-      print_red(found_name, cout);
-      cout << "]\n";
-    } else if (!strcmp(cmd, "cvg_res") || !strcmp(cmd, "cvp_res")) {
-      cout << "Percent of hit bins [";
-      print_red(to_string(100.0 * hit_bins / bin_count), cout);
-      cout << "]\n";
-    } else if (!strcmp(cmd, "nof_cvps")) {
-      cout << "Number of coverpoints is [";
-      print_red(to_string(total_cvps), cout);
-      cout << "]\n";
-    } else if (!strcmp(cmd, "nof_hits")) {
-      cout << "The bin was hit [";
-      print_red(to_string(hit_count), cout);
-      cout << "] times\n";
-    } else if (!strcmp(cmd, "nof_bins")) {
-      cout << "The number of bins is [";
-      print_red(to_string(bin_count), cout);
-      cout << "]\n";
-    }
+      scan->last = scope;
+      scan->hier = hier ? hier : "";
 
-    current_cvg_count = 0;
-    current_cvp_count = 0;
-    current_bin_count = 0;
+      if (!scan->hier.empty() && scan->hier[0] == '/')
+        scan->hier.erase(0, 1);
 
-    desired_cvg_index = -1;
-    desired_cvp_index = -1;
-    desired_bin_index = -1;
+      scan->wanted = scan->scopes->empty();
 
-    bin_count = 0;
-    hit_bins = 0;
+      for (auto &s : *scan->scopes)
+        scan->wanted |= !scan->hier.compare(0, s.size(), s)
+            && (scan->hier.size() == s.size() || scan->hier[s.size()] == '/');
+    }
 
-    total_cvps = 0;
-    hit_count = 0;
+    if (!scan->wanted)
+      return UCIS_SCAN_CONTINUE;
 
-    found_name = "";
+    // Covergroup bins are covered as -g scores counts them
+    int64_t at_least = coverdata.type == UCIS_CVGBIN ? scan->scope.point.at_least : 1;
 
-    bool found_target = false;
+    scan->nof_bins++;
 
-    string old_cvg = "";
-    string old_cvp = "";
+    // Bins of a scope may share a name: their index tells them apart
+    if (bin_covered(coverdata, at_least))
+      scan->hits.push_back(scan->hier + "/" + (name ? name : "") + "#" + to_string(cbdata->coverindex));
 
     break;
   }
@@ -677,13 +771,19 @@ ucisCBReturnT map_callback(void* userdata, ucisCBDataT* cbdata) {
         || coverdata.type == UCIS_ASSERTBIN))
       return UCIS_SCAN_CONTINUE;
 
-    if (coverdata.type == UCIS_TOGGLEBIN)
-      return UCIS_SCAN_CONTINUE;
-
     string hier_str(ucis_GetStringProperty(db, scope, -1, UCIS_STR_SCOPE_HIER_NAME));
     string target((char *) userdata);
     int cov_type = -1;
 
+    // Toggles are listed by the scope that holds their signal
+    if (coverdata.type == UCIS_TOGGLEBIN) {
+      string location, signal;
+      int64_t bit;
+
+      if (toggle_split(hier_str, location, signal, bit))
+        hier_str = location;
+    }
+
     if (target == "cov")
       cov_type = UCIS_CVGBIN;
     if (target == "assert")
@@ -791,14 +891,39 @@ ucisCBReturnT map_callback(void* userdata, ucisCBDataT* cbdata) {
  * @param db_file Path to the UCISDB
  * @param iter Callback function
  * @param data Data to be passed to the callback
+ * @return 0 on success, 1 if the UCISDB can't be opened
  */
-void iterate_db(const string &db_file, ucis_CBFuncT iter, void *data) {
+int iterate_db(const string &db_file, ucis_CBFuncT iter, void *data) {
 
   ucisT db = ucis_Open(db_file.c_str());
   if (db == NULL)
-    return;
+    return 1;
 
   ucis_CallBack(db, NULL, iter, data);
   ucis_Close(db);
+
+  return 0;
 }
 
+/**
+ * @brief Searches a UCISDB for the checks of a trie (see search_callback)
+ * @param trie Checks
+ * @param db_file Path to the UCISDB
+ * @param refinement_flag How items are indexed
+ * @return 0 on success, 1 if the UCISDB can't be opened
+ */
+int search_db(top_tree *trie, const string &db_file, bool refinement_flag) {
+
+  // Pass data to UCIS through 3 pointers
+  // 1 -> dustate structure
+  // 2 -> check storage tree
+  // 3 -> switch for refinement/checkfile
+  struct dustate du = { 0, 0 };
+  char *data[3];
+
+  data[0] = (char *) &du;
+  data[1] = (char *) trie;
+  data[2] = (char *) &refinement_flag;
+
+  return iterate_db(db_file, search_callback, (void *) data);
+}
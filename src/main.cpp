@@ -35,6 +35,7 @@ string custom_checker(node_info_t inf) {
 int main(int argc, char** argv) {
 
 // Uncomment to register the check defined above
+// (a checker can also be loaded at runtime, see --checker and cl_checker.h)
 //  register_check(custom_checker);
 
 // Pass it to the ucis iterator to populate it
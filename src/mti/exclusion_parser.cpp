@@ -144,19 +144,19 @@ string bracket_handler(string &line, size_t &pos) {
 
 /**
  * @brief Adds a statement/branch to the storage
- * @param cmd Map of flags and their args
+ * @param cmd Flags of the command and their args
  * @param query Partial string to be added
  * @param query_t Type of exclusion
  * @param excl_tree Storage for exclusions
  * @param q Debug information (line in file)
  * @param negate Marker to negate the check
  */
-void assemble_st_br(map<string, vector<string>> cmd, string query, char query_t,
+void assemble_st_br(const pu_cmd &cmd, string query, char query_t,
     top_tree* &excl_tree, int q, bool negate) {
 
   // Setup
   bool expanded = false;
-  vector<int> expanded_lines = expand_lines(cmd["line"], expanded);
+  vector<int> expanded_lines = expand_lines(cmd.args("line"), expanded);
 
   node_info_t inf;
 
@@ -165,11 +165,11 @@ void assemble_st_br(map<string, vector<string>> cmd, string query, char query_t,
   inf.type = "Block";
   inf.hit_count = 0;
   inf.line = q;
-  inf.negated = negate ^ (cmd.find("n") != cmd.end());
+  inf.negated = negate ^ (cmd.has("n"));
 
   // If it's commented, add the comment
-  if (!cmd["comment"].empty()) {
-    inf.comment = cmd["comment"][0];
+  if (!cmd.args("comment").empty()) {
+    inf.comment = cmd.args("comment")[0];
     inf.generator_line = 0;
   }
 
@@ -182,7 +182,7 @@ void assemble_st_br(map<string, vector<string>> cmd, string query, char query_t,
 
       string aux_query = query + to_string(expanded_lines[i]) + "/";
 
-      if (cmd.find("allfalse") != cmd.end())
+      if (cmd.has("allfalse"))
         aux_query += "all_false_branch/";
 
       aux_query += "b/";
@@ -196,19 +196,19 @@ void assemble_st_br(map<string, vector<string>> cmd, string query, char query_t,
 
 /**
  * @brief Adds a condition/expression to the storage
- * @param cmd Map of flags and their args
+ * @param cmd Flags of the command and their args
  * @param query Partial string to be added
  * @param query_t Type of exclusion
  * @param excl_tree Storage for exclusions
  * @param q Debug information (line in file)
  * @param negate Marker to negate the check
  */
-void assemble_cd_ex(map<string, vector<string>> cmd, string query, char query_t,
+void assemble_cd_ex(const pu_cmd &cmd, string query, char query_t,
     top_tree* &excl_tree, int q, bool negate) {
 
   // Setup
-  vector<string> opt = cmd["feccondrow"];
-  vector<string> lines = cmd["line"];
+  const vector<string> *opt = &cmd.args("feccondrow");
+  const vector<string> &lines = cmd.args("line");
   bool expanded = false;
   bool min_terms = true;
 
@@ -218,30 +218,30 @@ void assemble_cd_ex(map<string, vector<string>> cmd, string query, char query_t,
   inf.type = "Expression";
   inf.hit_count = 0;
   inf.line = q;
-  inf.negated = negate ^ (cmd.find("n") != cmd.end());
-  if (!cmd["comment"].empty()) {
-    inf.comment = cmd["comment"][0];
+  inf.negated = negate ^ (cmd.has("n"));
+  if (!cmd.args("comment").empty()) {
+    inf.comment = cmd.args("comment")[0];
     inf.generator_line = 0;
   }
 
   // Get min-term list
-  if (opt.empty())
-    opt = cmd["fecexprrow"];
+  if (opt->empty())
+    opt = &cmd.args("fecexprrow");
 
-  if (opt.empty())
-    opt = cmd["udpexprrow"];
+  if (opt->empty())
+    opt = &cmd.args("udpexprrow");
 
-  if (opt.empty())
-    opt = cmd["udpcondrow"];
+  if (opt->empty())
+    opt = &cmd.args("udpcondrow");
 
   // Whole expression table is excluded
-  if (opt.empty()) {
+  if (opt->empty()) {
     min_terms = false;
-    opt = lines;
+    opt = &lines;
   }
 
   // All expressions in that location
-  if (opt.empty()) {
+  if (opt->empty()) {
     PRINT_LINE(query + "X/");
     excl_tree->add(query + "X/", query_t, inf);
     return;
@@ -249,23 +249,23 @@ void assemble_cd_ex(map<string, vector<string>> cmd, string query, char query_t,
 
   if (min_terms) {
     // Add expression line to query
-    query += opt[0] + "/";
+    query += (*opt)[0] + "/";
 
     // Add each table row
-    for (int i = 1; i < opt.size(); ++i) {
-      PRINT_LINE(query + opt[i] + "/m/");
-      excl_tree->add(query + opt[i] + "/m/", query_t, inf);
+    for (int i = 1; i < opt->size(); ++i) {
+      PRINT_LINE(query + (*opt)[i] + "/m/");
+      excl_tree->add(query + (*opt)[i] + "/m/", query_t, inf);
     }
 
     // Whole expression table
-    if (opt.size() <= 1) {
+    if (opt->size() <= 1) {
       PRINT_LINE(query + "X/");
       excl_tree->add(query + "X/", query_t, inf);
     }
   } else {
 
     // Multiple expressions excluded
-    vector<int> expanded_lines = expand_lines(opt, expanded);
+    vector<int> expanded_lines = expand_lines(*opt, expanded);
     for (int i = 0; i < expanded_lines.size(); ++i) {
       PRINT_LINE(query + to_string(expanded_lines[i]) + "/X/");
       excl_tree->add(query + to_string(expanded_lines[i]) + "/X/", query_t, inf, expanded);
@@ -275,25 +275,21 @@ void assemble_cd_ex(map<string, vector<string>> cmd, string query, char query_t,
 
 /**
  * @brief Adds a FSM state/transition to the storage
- * @param cmd Map of flags and their args
+ * @param cmd Flags of the command and their args
  * @param query Partial string to be added
  * @param query_t Type of exclusion
  * @param excl_tree Storage for exclusions
  * @param q Debug information (line in file)
  * @param negate Marker to negate the check
  */
-void assemble_fsm(map<string, vector<string>> cmd, string query, char query_t, top_tree* &excl_tree,
+void assemble_fsm(const pu_cmd &cmd, string query, char query_t, top_tree* &excl_tree,
     int q, bool negate) {
 
   // Transitions
-  vector<string> tr = cmd["ftrans"];
-  if (tr.empty())
-    tr = cmd["ft"];
+  const vector<string> &tr = cmd.has("ftrans") ? cmd.args("ftrans") : cmd.args("ft");
 
   // States
-  vector<string> st = cmd["fstate"];
-  if (st.empty())
-    st = cmd["fs"];
+  const vector<string> &st = cmd.has("fstate") ? cmd.args("fstate") : cmd.args("fs");
 
   // Get FSM name
   string fsm_name;
@@ -309,10 +305,10 @@ void assemble_fsm(map<string, vector<string>> cmd, string query, char query_t, t
   inf.name = fsm_name;
   inf.hit_count = 0;
   inf.line = q;
-  inf.negated = negate ^ (cmd.find("n") != cmd.end());
+  inf.negated = negate ^ (cmd.has("n"));
 
-  if (!cmd["comment"].empty()) {
-    inf.comment = cmd["comment"][0];
+  if (!cmd.args("comment").empty()) {
+    inf.comment = cmd.args("comment")[0];
     inf.generator_line = 0;
   }
 
@@ -348,14 +344,65 @@ void assemble_fsm(map<string, vector<string>> cmd, string query, char query_t, t
 
 }
 
+/**
+ * @brief Adds a toggle to the storage
+ * @param cmd Flags of the command and their args
+ * @param query Partial string to be added
+ * @param query_t Type of exclusion
+ * @param excl_tree Storage for exclusions
+ * @param q Debug information (line in file)
+ * @param negate Marker to negate the check
+ */
+void assemble_toggle(const pu_cmd &cmd, string query, char query_t, top_tree* &excl_tree,
+    int q, bool negate) {
+
+  const vector<string> &nodes = cmd.args("togglenode");
+
+  // Fill up info structure
+  node_info_t inf;
+  inf.location = query;
+  inf.type = "Toggle";
+  inf.hit_count = 0;
+  inf.line = q;
+  inf.negated = negate ^ (cmd.has("n"));
+
+  if (!cmd.args("comment").empty()) {
+    inf.comment = cmd.args("comment")[0];
+    inf.generator_line = 0;
+  }
+
+  // Every toggle from that location
+  if (nodes.empty()) {
+    inf.name = "*";
+    PRINT_LINE(query + "O/");
+    excl_tree->add(query + "O/", query_t, inf);
+    return;
+  }
+
+  // Each node, with its bit or part select if any
+  for (int i = 0; i < nodes.size(); ++i) {
+    string glob;
+    int64_t first, last;
+
+    if (!toggle_parse_pattern(nodes[i], glob, first, last)) {
+      debug_log << "Invalid toggle node " << nodes[i] << "\n";
+      continue;
+    }
+
+    inf.name = nodes[i];
+    PRINT_LINE(query + nodes[i] + "/o/");
+    excl_tree->add(query + nodes[i] + "/o/", query_t, inf);
+  }
+}
+
 /**
  * @brief Adds a new exclusion to the storage
- * @param cmd Map of flags and their args
+ * @param cmd Flags of the command and their args
  * @param excl_tree Storage for exclusions
  * @param q Debug information (line in file)
  * @param negate Marker to negate the check
  */
-void assemble_command(map<string, vector<string>> cmd, top_tree* &excl_tree, int q, bool negate) {
+void assemble_command(const pu_cmd &cmd, top_tree* &excl_tree, int q, bool negate) {
 
   // Setup
   string query;
@@ -363,8 +410,8 @@ void assemble_command(map<string, vector<string>> cmd, top_tree* &excl_tree, int
   bool expanded = false;
 
   // Scope exclusion
-  if (cmd.find("scope") != cmd.end()) {
-    query += cmd["scope"][0];
+  if (cmd.has("scope")) {
+    query += cmd.args("scope")[0];
 
     size_t colon = query.find_last_of(':');
     if (colon != string::npos)
@@ -373,8 +420,8 @@ void assemble_command(map<string, vector<string>> cmd, top_tree* &excl_tree, int
     // Set query type
     query_t = 's';
   } // Design unit exclusion
-  else if (cmd.find("du") != cmd.end()) {
-    query += cmd["du"][0];
+  else if (cmd.has("du")) {
+    query += cmd.args("du")[0];
 
     size_t dot = query.find_last_of('.');
     if (dot != string::npos)
@@ -383,8 +430,8 @@ void assemble_command(map<string, vector<string>> cmd, top_tree* &excl_tree, int
     // Set query type
     query_t = 'd';
   } // Source file exclusion
-  else if (cmd.find("src") != cmd.end()) {
-    query += cmd["src"][0].substr(1);
+  else if (cmd.has("src")) {
+    query += cmd.args("src")[0].substr(1);
 
     // Set query type
     query_t = 'f';
@@ -401,19 +448,12 @@ void assemble_command(map<string, vector<string>> cmd, top_tree* &excl_tree, int
 
   // Questa let's you exclude items of multiple types in one go
   // Handle it separately
-  vector<string> types;
-  vector<string> lines;
+  const vector<string> &types = cmd.args("code");
   vector<int> expanded_lines;
 
   // Have lines specified
-  if (cmd.find("line") != cmd.end()) {
-    lines = cmd["line"];
-    expanded_lines = expand_lines(lines, expanded);
-  }
-
-  // Have types specified
-  if (cmd.find("code") != cmd.end())
-    types = cmd["code"];
+  if (cmd.has("line"))
+    expanded_lines = expand_lines(cmd.args("line"), expanded);
 
   if (!types.empty() && types[0].size() > 1) {
 
@@ -423,10 +463,10 @@ void assemble_command(map<string, vector<string>> cmd, top_tree* &excl_tree, int
       // Setup and fill a info structure
       node_info_t inf;
       inf.hit_count = 0;
-      inf.negated = negate ^ (cmd.find("n") != cmd.end());
+      inf.negated = negate ^ (cmd.has("n"));
 
-      if (!cmd["comment"].empty()) {
-        inf.comment = cmd["comment"][0];
+      if (!cmd.args("comment").empty()) {
+        inf.comment = cmd.args("comment")[0];
         inf.generator_line = 0;
       }
 
@@ -466,10 +506,21 @@ void assemble_command(map<string, vector<string>> cmd, top_tree* &excl_tree, int
       case 'v':
         inf.type = "Coverbin";
         break;
+      case 't':
+        inf.type = "Toggle";
+        break;
       default:
         break;
       }
 
+      // Toggles have no lines
+      if (types[0][i] == 't') {
+        inf.name = "*";
+        PRINT_LINE(query + "O/");
+        excl_tree->add(query + "O/", query_t, inf);
+        continue;
+      }
+
       // Exclude types from that location
       if (type && expanded_lines.empty()) {
         PRINT_LINE(query + type + "/");
@@ -488,18 +539,26 @@ void assemble_command(map<string, vector<string>> cmd, top_tree* &excl_tree, int
   if (!types.empty())
     excl_type = types[0][0];
 
+  // Toggle exclusion
+  // Queries will look like this:
+  //  for a node:           <location>/<node>/o/
+  //  for every node:       <location>/O/
+  if (cmd.has("togglenode") || excl_type == 't') {
+    assemble_toggle(cmd, query, query_t, excl_tree, q, negate);
+    return;
+  }
+
   // FSM exclusion
   // Queries will look like this:
   //  for a state:          <location>/<fsm_name>/<state>/s/
   //  for a transition:     <location>/<fsm_name>/<source_state>/<destination_state>/t/
   //  for a whole FSM:      <location>/<fsm_name>/F/
   bool fsm_excl = false;
-  fsm_excl |= cmd.find("ftrans") != cmd.end();
-  fsm_excl |= cmd.find("fstate") != cmd.end();
-  fsm_excl |= cmd.find("ft") != cmd.end();
-  fsm_excl |= cmd.find("fs") != cmd.end();
+  fsm_excl |= cmd.has("ftrans");
+  fsm_excl |= cmd.has("fstate");
+  fsm_excl |= cmd.has("ft");
+  fsm_excl |= cmd.has("fs");
   fsm_excl |= (excl_type == 'f');
-  fsm_excl |= (excl_type == 't');
 
   if (fsm_excl) {
     assemble_fsm(cmd, query, query_t, excl_tree, q, negate);
@@ -511,10 +570,10 @@ void assemble_command(map<string, vector<string>> cmd, top_tree* &excl_tree, int
   // for a row: <location>/<line>/<row_index>/m/
   // for an expression: <location>/<line>/X/
   bool logic_excl = 0;
-  logic_excl |= cmd.find("feccondrow") != cmd.end();
-  logic_excl |= cmd.find("fecexprrow") != cmd.end();
-  logic_excl |= cmd.find("udpcondrow") != cmd.end();
-  logic_excl |= cmd.find("udpexprrow") != cmd.end();
+  logic_excl |= cmd.has("feccondrow");
+  logic_excl |= cmd.has("fecexprrow");
+  logic_excl |= cmd.has("udpcondrow");
+  logic_excl |= cmd.has("udpexprrow");
   logic_excl |= excl_type == 'c';
   logic_excl |= excl_type == 'e';
 
@@ -530,6 +589,49 @@ void assemble_command(map<string, vector<string>> cmd, top_tree* &excl_tree, int
   assemble_st_br(cmd, query, query_t, excl_tree, q, negate);
 }
 
+/*
+ * State shared by exclusion_consumer calls
+ */
+typedef struct {
+  top_tree *excl_tree;
+  const filters_t *fil;
+  int index;
+} exclusion_ctx_t;
+
+/**
+ * @brief Filters an exclusion command and assembles it as soon as it was parsed
+ */
+static void exclusion_consumer(const pu_cmd &cmd, uint line, void *data) {
+
+  exclusion_ctx_t *ctx = (exclusion_ctx_t *) data;
+  const filters_t &fil = *ctx->fil;
+  int q = ctx->index++;
+
+  debug_log << "For cmd #" << q << ":\n";
+
+  int acc = 1;
+  // If the exclusion has a comment, check comment filters
+  if (cmd.args("comment").size()) {
+
+    acc = fil.comments.run_check(cmd.args("comment")[0]);
+
+    if (!acc) {
+      debug_log << "Failed comment check!\n";
+      return;
+    }
+  } else if (!fil.comments.empty())
+    acc = 0;
+
+  if (cmd.has("assertpath") || cmd.has("cvgpath")) {
+    debug_log << "Functional coverage!\n";
+    return;
+  }
+
+  // Assume command is valid
+  if (acc == 1)
+    assemble_command(cmd, ctx->excl_tree, q, fil.negate);
+}
+
 /**
  *  @brief Gets commands and passes them to the do_line function.
  *  @brief Combines multiple lines in a command (if comments contain \n for example) and removes comments
@@ -557,39 +659,11 @@ void parse_rules(std::ifstream & vp_ref, top_tree* &excl_tree, const filters_t&
 
   parser = new pu(questa_conf, args, vp_ref);
 
-  parser->pu_main();
-
-  pu_results x = parser->pu_get_results();
-
-  // Assemble each command and pass it to the tree
-  for (size_t q = 0; q < x.size(); ++q) {
-
-    debug_log << "For cmd #" << q << ":\n";
-
-    int acc = 1;
-    // If the exclusion has a comment, check comment filters
-    if (x[q].find("comment") != x[q].end() && x[q]["comment"].size()) {
-
-      for (uint i = 0; i < fil.comment_workers.size(); ++i) {
-        acc = acc & fil.comment_workers[i]->run_check(x[q]["comment"][0]);
-      }
+  // Exclusions go straight into the tree, without building a result map
+  exclusion_ctx_t ctx = { excl_tree, &fil, 0 };
+  parser->pu_set_consumer(exclusion_consumer, &ctx);
 
-      if (!acc) {
-        debug_log << "Failed comment check!\n";
-        continue;
-      }
-    } else if (fil.comment_workers.size())
-      acc = 0;
-
-    if (x[q].find("assertpath") != x[q].end() || x[q].find("cvgpath") != x[q].end()) {
-      debug_log << "Functional coverage!\n";
-      continue;
-    }
-
-    // Assume command is valid
-    if (acc == 1)
-      assemble_command(x[q], excl_tree, q, fil.negate);
-  }
+  parser->pu_main();
 
   delete parser;
 